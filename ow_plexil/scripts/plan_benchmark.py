@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+
+#The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+#Research and Simulation can be found in README.md in the root directory of
+#this repository.
+
+#Plan execution performance regression suite.  Runs each of a list of plans
+#through ow_exec_node against mock lander action servers and telemetry, collects
+#the exec statistics published on /plexil_plan_statistics, and compares them
+#with a stored baseline.  Exits with status 1 if any plan regressed or failed.
+#Launched by launch/plan_benchmark.launch.
+
+import json
+import os
+import sys
+import threading
+import rospy
+import actionlib
+from std_msgs.msg import Empty, Float64, Int16, String
+from sensor_msgs.msg import Image, JointState, PointCloud2
+from ow_lander.msg import (UnstowAction, UnstowResult, StowAction, StowResult,
+                           GrindAction, GrindResult,
+                           GuardedMoveAction, GuardedMoveResult,
+                           DigCircularAction, DigCircularResult,
+                           DigLinearAction, DigLinearResult,
+                           DeliverAction, DeliverResult)
+from ow_plexil.msg import IdentifyLocationAction, IdentifyLocationResult
+from ow_plexil.srv import PlanSelection
+
+DEFAULT_PLANS = ['TestActions', 'TestGuardedMoves', 'TestPanTilt', 'TorqueTest',
+                 'FaultHandlingPattern1', 'FaultHandlingPattern2',
+                 'FaultHandlingPattern3', 'FaultHandlingPattern4',
+                 'FaultHandlingPattern5', 'FaultHandlingPattern6']
+
+#statistics compared with the baseline; wall time is compared separately since
+#it depends on the mock latency and the machine
+COUNTED = ['steps', 'commands', 'lookups', 'notifications']
+
+JOINTS = ['j_shou_yaw', 'j_shou_pitch', 'j_prox_pitch', 'j_dist_pitch',
+          'j_hand_yaw', 'j_scoop_yaw', 'j_ant_pan', 'j_ant_tilt', 'j_grinder']
+
+
+class MockActionServer:
+  '''Action server that succeeds every goal after a fixed latency.'''
+
+  def __init__(self, name, action, result_type, latency):
+    self.result_type = result_type
+    self.latency = latency
+    self.server = actionlib.SimpleActionServer(name, action, self.execute, False)
+    self.server.start()
+
+  def execute(self, goal):
+    if self.latency > 0:
+      rospy.sleep(self.latency)
+    result = self.result_type()
+    if hasattr(result, 'success'):
+      result.success = True
+    self.server.set_succeeded(result)
+
+
+class MockLander:
+  '''Lander telemetry: echoes antenna commands in the joint states, answers
+  image triggers, and reports a full battery.'''
+
+  def __init__(self, latency):
+    self.latency = latency
+    self.positions = dict((joint, 0.0) for joint in JOINTS)
+    self.lock = threading.Lock()
+    self.joint_states = rospy.Publisher('/joint_states', JointState, queue_size=3)
+    self.image = rospy.Publisher('/StereoCamera/left/image_raw', Image, queue_size=3)
+    self.points = rospy.Publisher('/StereoCamera/points2', PointCloud2, queue_size=3)
+    self.soc = rospy.Publisher('/power_system_node/state_of_charge', Float64, queue_size=3)
+    self.rul = rospy.Publisher('/power_system_node/remaining_useful_life', Int16, queue_size=3)
+    self.temperature = rospy.Publisher('/power_system_node/battery_temperature', Float64, queue_size=3)
+    rospy.Subscriber('/ant_pan_position_controller/command', Float64,
+                     lambda msg: self.move('j_ant_pan', msg.data))
+    rospy.Subscriber('/ant_tilt_position_controller/command', Float64,
+                     lambda msg: self.move('j_ant_tilt', msg.data))
+    rospy.Subscriber('/StereoCamera/left/image_trigger', Empty, self.trigger)
+    rospy.Timer(rospy.Duration(0.05), self.publish)
+
+  def move(self, joint, position):
+    threading.Timer(self.latency, self.set_position, (joint, position)).start()
+
+  def set_position(self, joint, position):
+    with self.lock:
+      self.positions[joint] = position
+
+  def trigger(self, msg):
+    def answer():
+      stamp = rospy.Time.now()
+      image = Image()
+      image.header.stamp = stamp
+      self.image.publish(image)
+      points = PointCloud2()
+      points.header.stamp = stamp
+      self.points.publish(points)
+    threading.Timer(self.latency, answer).start()
+
+  def publish(self, event):
+    msg = JointState()
+    msg.header.stamp = rospy.Time.now()
+    msg.name = JOINTS
+    with self.lock:
+      msg.position = [self.positions[joint] for joint in JOINTS]
+    msg.velocity = [0.0] * len(JOINTS)
+    msg.effort = [0.0] * len(JOINTS)
+    self.joint_states.publish(msg)
+    self.soc.publish(Float64(1.0))
+    self.rul.publish(Int16(1000))
+    self.temperature.publish(Float64(20.0))
+
+
+class PlanBenchmark:
+
+  def __init__(self):
+    self.plans = rospy.get_param('~plans', DEFAULT_PLANS)
+    self.latency = rospy.get_param('~latency', 0.0)
+    self.plan_timeout = rospy.get_param('~plan_timeout', 300.0)
+    self.baseline_path = os.path.expanduser(
+      rospy.get_param('~baseline', '~/.ros/plan_benchmark_baseline.json'))
+    self.update_baseline = rospy.get_param('~update_baseline', False)
+    self.count_tolerance = rospy.get_param('~count_tolerance', 0.1)
+    self.wall_tolerance = rospy.get_param('~wall_tolerance', 0.25)
+
+    self.servers = [
+      MockActionServer('Unstow', UnstowAction, UnstowResult, self.latency),
+      MockActionServer('Stow', StowAction, StowResult, self.latency),
+      MockActionServer('Grind', GrindAction, GrindResult, self.latency),
+      MockActionServer('GuardedMove', GuardedMoveAction, GuardedMoveResult,
+                       self.latency),
+      MockActionServer('DigCircular', DigCircularAction, DigCircularResult,
+                       self.latency),
+      MockActionServer('DigLinear', DigLinearAction, DigLinearResult,
+                       self.latency),
+      MockActionServer('Deliver', DeliverAction, DeliverResult, self.latency),
+      MockActionServer('IdentifySampleLocation', IdentifyLocationAction,
+                       IdentifyLocationResult, self.latency)]
+    self.lander = MockLander(self.latency)
+
+    self.statistics = None
+    self.condition = threading.Condition()
+    rospy.Subscriber('/plexil_plan_statistics', String, self.statistics_callback)
+
+  def statistics_callback(self, msg):
+    fields = dict(pair.split('=', 1) for pair in msg.data.split())
+    with self.condition:
+      self.statistics = fields
+      self.condition.notify_all()
+
+  def run_plan(self, plan):
+    '''Runs the plan and returns its statistics, or None if it did not run.'''
+    with self.condition:
+      self.statistics = None
+    select = rospy.ServiceProxy('/plexil_plan_selection', PlanSelection)
+    if not select('ADD', [plan + '.plx']).success:
+      return None
+    deadline = rospy.get_time() + self.plan_timeout
+    with self.condition:
+      while not rospy.is_shutdown():
+        if self.statistics is not None and self.statistics['plan'] == plan + '.plx':
+          break
+        remaining = deadline - rospy.get_time()
+        if remaining <= 0:
+          rospy.logerr('Plan %s did not finish within %.0f s', plan, self.plan_timeout)
+          return None
+        self.condition.wait(min(remaining, 1.0))
+      fields = self.statistics
+    if fields is None or fields['ran'] != '1':
+      return None
+    result = dict((key, int(fields[key])) for key in COUNTED)
+    result['wall'] = float(fields['wall'])
+    return result
+
+  def compare(self, result, baseline):
+    '''Returns the list of regressions of the plan relative to its baseline.'''
+    regressions = []
+    for key in COUNTED:
+      limit = baseline[key] * (1 + self.count_tolerance)
+      if result[key] > limit:
+        regressions.append('%s %d > %d' % (key, result[key], baseline[key]))
+    if result['wall'] > baseline['wall'] * (1 + self.wall_tolerance):
+      regressions.append('wall %.3f s > %.3f s' % (result['wall'], baseline['wall']))
+    return regressions
+
+  def run(self):
+    rospy.wait_for_service('/plexil_plan_selection')
+
+    results = {}
+    failed = []
+    for plan in self.plans:
+      if rospy.is_shutdown():
+        break
+      rospy.loginfo('Running %s...', plan)
+      result = self.run_plan(plan)
+      if result is None:
+        failed.append(plan)
+        continue
+      results[plan] = result
+      rospy.loginfo('%s: %.3f s, %d steps, %d commands, %d lookups, '
+                    '%d notifications', plan, result['wall'], result['steps'],
+                    result['commands'], result['lookups'], result['notifications'])
+
+    baseline = None
+    if os.path.exists(self.baseline_path) and not self.update_baseline:
+      with open(self.baseline_path) as f:
+        baseline = json.load(f)
+      if baseline.get('latency') != self.latency:
+        rospy.logwarn('Baseline was recorded with latency %s, not %s',
+                      baseline.get('latency'), self.latency)
+
+    regressed = []
+    if baseline is None:
+      with open(self.baseline_path, 'w') as f:
+        json.dump({'latency': self.latency, 'plans': results}, f,
+                  indent=2, sort_keys=True)
+      rospy.loginfo('Baseline written to %s', self.baseline_path)
+    else:
+      for plan, result in sorted(results.items()):
+        if plan not in baseline['plans']:
+          rospy.logwarn('%s: not in baseline', plan)
+          continue
+        regressions = self.compare(result, baseline['plans'][plan])
+        if regressions:
+          regressed.append(plan)
+          rospy.logerr('%s regressed: %s', plan, ', '.join(regressions))
+
+    for plan in failed:
+      rospy.logerr('%s failed to run', plan)
+    rospy.loginfo('%d plans run, %d regressed, %d failed',
+                  len(results), len(regressed), len(failed))
+    return not regressed and not failed
+
+
+if __name__ == '__main__':
+  rospy.init_node('plan_benchmark')
+  ok = PlanBenchmark().run()
+  rospy.signal_shutdown('benchmark finished')
+  sys.exit(0 if ok else 1)
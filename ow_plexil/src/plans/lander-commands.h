@@ -16,6 +16,17 @@ Command tilt_antenna (Real degrees);
 Command pan_antenna (Real degrees);
 Command take_picture();
 
+// Take a panorama, as the TakePanorama library plan does but as one command run
+// by the lander interface, which moves the antenna to each next frame while the
+// last is still being processed.  All values in degrees.  Progress is reported
+// by the PanoramaFramesTaken lookup.
+Command take_panorama (Real tilt_lo,
+                       Real tilt_hi,
+                       Real pan_lo,
+                       Real pan_hi,
+                       Real vert_overlap,
+                       Real horiz_overlap);
+
 Command dig_circular (Real x,
                       Real y,
                       Real depth,
@@ -52,13 +52,25 @@ LibraryAction Deliver (In Real X,
                        In Real Y,
                        In Real Z);
 
+LibraryAction Panorama (In Real TiltLo,
+                        In Real TiltHi,
+                        In Real PanLo,
+                        In Real PanHi,
+                        In Real VertOverlap,
+                        In Real HorizOverlap);
+
 // Lander queries
 
 Real Lookup StateOfCharge;
 Real Lookup RemainingUsefulLife;
 Real Lookup BatteryTemperature;
+Real Lookup ProjectedRemainingUsefulLife;  // seconds, at the charge's trend
+Boolean Lookup PowerBudgetOK;  // energy-heavy operations are admitted
+Real Lookup JointTelemetryTime;   // time of the latest joint values (seconds)
+Real Lookup PowerTelemetryTime;   // time of the latest power values (seconds)
 Boolean Lookup HardTorqueLimitReached (String joint_name);
 Boolean Lookup SoftTorqueLimitReached (String joint_name);
+Real Lookup PanoramaFramesTaken;  // by the running or last take_panorama
 
 // Faults
 Boolean Lookup SystemFault;
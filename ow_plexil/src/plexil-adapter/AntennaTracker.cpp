@@ -0,0 +1,173 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "AntennaTracker.h"
+#include "PlexilInterface.h"  // IDLE_ID
+#include <cmath>
+
+using std::mutex;
+using std::string;
+using std::unique_lock;
+
+const double DegreeTolerance = 0.4;    // made up, degrees
+
+// The axis is taken as still below this speed, which is above the noise of
+// the simulated joint velocity.
+const double VelocityTolerance = 0.2;  // made up, degrees per second
+
+// The move succeeds when this many consecutive samples are within tolerance
+// of the goal, whether or not the axis has come to rest, so that one that
+// jitters or hunts about the goal finishes.
+const int SettleSamples = 3;           // made up
+
+// Speed assumed until the axis is seen moving, and the slowest speed allowed
+// for the whole move.
+const double NominalSpeed = 10.0;      // made up, degrees per second
+const double MinimumSpeed = 2.0;       // made up, degrees per second
+
+// A move times out when it outlasts its ETA by this factor plus margin.  The
+// deadline is moved only by more than the rearm threshold, to spare timers,
+// and never past the limit set at the start from the minimum speed, so that
+// an axis that creeps or hunts toward its goal still times out.
+const double TimeoutFactor = 2.0;
+const double TimeoutMargin = 3.0;      // seconds
+const double RearmThreshold = 1.0;     // seconds
+
+// How long the axis may stand still short of its goal, after it has moved,
+// before the move fails.
+const double StallTime = 1.0;          // seconds
+
+// Difference between two angles in degrees, in [-180, 180], so that e.g. -180
+// and 180 are the same angle.
+static double angle_difference (double a, double b)
+{
+  return std::remainder (a - b, 360.0);
+}
+
+AntennaTracker::AntennaTracker (const string& opname, FinishCallback finish)
+  : m_opname (opname),
+    m_finish (finish),
+    m_nodeHandle (nullptr),
+    m_id (IDLE_ID),
+    m_goal (0),
+    m_startPosition (0),
+    m_moved (false),
+    m_settledSamples (0)
+{ }
+
+void AntennaTracker::initialize (ros::NodeHandle& nh)
+{
+  m_nodeHandle = &nh;
+}
+
+void AntennaTracker::start (int id, double goal, double current)
+{
+  // The timeout of a previous move is replaced by armTimeout, which always
+  // rearms with the deadline cleared, and is stopped only after the lock is
+  // released, since its callback may be waiting for the lock.
+  ros::Timer previous;
+  unique_lock<mutex> lock (m_mutex);
+  m_id = id;
+  m_goal = goal;
+  m_startPosition = current;
+  m_moved = false;
+  m_settledSamples = 0;
+  m_stillSince = ros::Time();
+  m_deadline = ros::Time();
+  ros::Time now = ros::Time::now();
+  double distance = fabs (angle_difference (goal, current));
+  m_limit = now + ros::Duration (distance / MinimumSpeed * TimeoutFactor +
+                                 TimeoutMargin);
+  armTimeout (distance / NominalSpeed, now, previous);
+  lock.unlock();
+  previous.stop();
+}
+
+void AntennaTracker::update (double position, double velocity,
+                             const ros::Time& stamp)
+{
+  unique_lock<mutex> lock (m_mutex);
+  if (m_id == IDLE_ID) return;
+
+  double error = fabs (angle_difference (position, m_goal));
+  bool still = fabs (velocity) <= VelocityTolerance;
+
+  m_settledSamples = error <= DegreeTolerance ? m_settledSamples + 1 : 0;
+  if (m_settledSamples >= SettleSamples ||
+      (still && error <= DegreeTolerance)) {
+    finish (true, position, lock);
+    return;
+  }
+
+  if (! m_moved) {
+    m_moved = fabs (angle_difference (position, m_startPosition)) >
+      DegreeTolerance;
+  }
+
+  ros::Timer replaced;
+  if (! still) {
+    m_stillSince = ros::Time();
+    armTimeout (error / fabs (velocity), stamp, replaced);
+  }
+  else if (m_moved) {
+    if (m_stillSince.isZero()) m_stillSince = stamp;
+    else if ((stamp - m_stillSince).toSec() >= StallTime) {
+      ROS_ERROR ("%s stopped short of its goal", m_opname.c_str());
+      finish (false, position, lock);
+      return;
+    }
+  }
+  lock.unlock();
+  replaced.stop();
+}
+
+void AntennaTracker::armTimeout (double eta, const ros::Time& now,
+                                 ros::Timer& replaced)
+{
+  // Call with m_mutex held.  Replaces the pending timeout, if its deadline
+  // differs enough, handing back the old timer to be stopped once the lock is
+  // released, since its callback may be waiting for the lock.
+  ros::Time deadline = now + ros::Duration (eta * TimeoutFactor + TimeoutMargin);
+  if (deadline > m_limit) deadline = m_limit;
+  if (! m_deadline.isZero() &&
+      fabs ((deadline - m_deadline).toSec()) < RearmThreshold) {
+    return;
+  }
+  m_deadline = deadline;
+  if (! m_nodeHandle) return;
+  int id = m_id;
+  const bool oneshot = true;
+  std::swap (replaced, m_timer);
+  m_timer = m_nodeHandle->createTimer
+    (std::max (deadline - now, ros::Duration (0)),
+     [this, id] (const ros::TimerEvent&) { timeout (id); },
+     oneshot);
+}
+
+void AntennaTracker::timeout (int id)
+{
+  unique_lock<mutex> lock (m_mutex);
+  if (m_id != id) return;  // finished already
+  ROS_ERROR ("%s timed out", m_opname.c_str());
+  finish (false, NAN, lock);
+}
+
+void AntennaTracker::finish (bool success, double position,
+                             unique_lock<mutex>& lock)
+{
+  // The timer is stopped once the lock is released, as above; it needs no
+  // stopping if this is its own callback.
+  int id = m_id;
+  double goal = m_goal;
+  m_id = IDLE_ID;
+  ros::Timer timer;
+  std::swap (timer, m_timer);
+  lock.unlock();
+  timer.stop();
+  if (! success) {
+    ROS_ERROR ("%s failed. Ended at %f degrees, goal was %f.",
+               m_opname.c_str(), position, goal);
+  }
+  m_finish (id, success);
+}
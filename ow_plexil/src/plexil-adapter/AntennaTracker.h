@@ -0,0 +1,65 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Antenna_Tracker_H
+#define Antenna_Tracker_H
+
+// Tracks one antenna axis (pan or tilt) through a commanded move.  The move
+// succeeds as soon as the axis is within tolerance of its goal and has stopped
+// moving, or has stayed within tolerance for a few samples, and fails if the
+// axis stops short of the goal or outlasts its timeout.  The timeout is a ROS
+// timer, armed from an estimate of the time to arrive (ETA) and refined from
+// the axis velocity as it moves, up to a limit set at the start, so that it
+// does not depend on telemetry arriving.
+
+#include <ros/ros.h>
+#include <functional>
+#include <mutex>
+#include <string>
+
+class AntennaTracker
+{
+ public:
+  // Called once per move, with the operation's command ID and whether the
+  // goal was reached.  Not called with the tracker's lock held.
+  using FinishCallback = std::function<void (int id, bool success)>;
+
+  AntennaTracker (const std::string& opname, FinishCallback finish);
+  AntennaTracker (const AntennaTracker&) = delete;
+  AntennaTracker& operator= (const AntennaTracker&) = delete;
+
+  // Timers are created through the given node handle, which should be the one
+  // whose callbacks call update(), so that the two are serialized.
+  void initialize (ros::NodeHandle& nh);
+
+  // Track a move to the goal from the current position, in degrees.
+  void start (int id, double goal, double current);
+
+  // New telemetry of the axis, in degrees and degrees per second, stamped with
+  // the (ROS) time of the sample.
+  void update (double position, double velocity, const ros::Time& stamp);
+
+ private:
+  void armTimeout (double eta, const ros::Time& now, ros::Timer& replaced);
+  void timeout (int id);
+  void finish (bool success, double position, std::unique_lock<std::mutex>&);
+
+  const std::string m_opname;
+  const FinishCallback m_finish;
+  ros::NodeHandle* m_nodeHandle;
+
+  // State of the move in progress, if m_id is not IDLE_ID.
+  std::mutex m_mutex;
+  int m_id;
+  double m_goal;
+  double m_startPosition;
+  bool m_moved;          // has left the start position
+  int m_settledSamples;  // consecutive samples within tolerance of the goal
+  ros::Time m_stillSince; // when the axis stopped short of the goal, or zero
+  ros::Time m_deadline;
+  ros::Time m_limit;     // the latest the deadline may be
+  ros::Timer m_timer;
+};
+
+#endif
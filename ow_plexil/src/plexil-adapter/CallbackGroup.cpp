@@ -0,0 +1,28 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "CallbackGroup.h"
+
+CallbackGroup::CallbackGroup (const std::string& name, int threads)
+  : m_name (name),
+    m_spinner (threads, &m_queue)
+{
+  m_nodeHandle.setCallbackQueue (&m_queue);
+}
+
+CallbackGroup::~CallbackGroup ()
+{
+  m_spinner.stop();
+}
+
+ros::NodeHandle& CallbackGroup::nodeHandle ()
+{
+  return m_nodeHandle;
+}
+
+void CallbackGroup::start ()
+{
+  m_spinner.start();
+  ROS_INFO ("Started %s callback group.", m_name.c_str());
+}
@@ -0,0 +1,39 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Callback_Group_H
+#define Callback_Group_H
+
+// A ROS callback queue serviced by its own spinner thread(s).  Subscribers,
+// services and timers created through its node handle have their callbacks run
+// on those threads, isolated from the global queue and from other groups.
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <memory>
+#include <string>
+
+class CallbackGroup
+{
+ public:
+  // The name is for logging only.  With more than one thread, callbacks of
+  // different subscriptions in the group may run concurrently.
+  CallbackGroup (const std::string& name, int threads = 1);
+  ~CallbackGroup ();
+  CallbackGroup (const CallbackGroup&) = delete;
+  CallbackGroup& operator= (const CallbackGroup&) = delete;
+
+  ros::NodeHandle& nodeHandle ();
+
+  // Start servicing the queue.
+  void start ();
+
+ private:
+  std::string m_name;
+  ros::CallbackQueue m_queue;
+  ros::NodeHandle m_nodeHandle;
+  ros::AsyncSpinner m_spinner;
+};
+
+#endif
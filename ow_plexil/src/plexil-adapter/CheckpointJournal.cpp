@@ -0,0 +1,733 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "CheckpointJournal.h"
+#include <ros/ros.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+using PLEXIL::Value;
+using std::lock_guard;
+using std::map;
+using std::mutex;
+using std::string;
+using std::vector;
+
+CheckpointJournal g_checkpoints;
+
+// How much of the journal's end is read at first in looking for the last
+// snapshot; made up.  The window grows until one is found.
+static const long TailWindow = 64 * 1024;
+
+static const char* SnapshotBegin = "{\"type\":\"snapshot\"}";
+static const char* SnapshotEnd = "{\"type\":\"snapshot_end\"}";
+
+static double now ()
+{
+  // Seconds since the epoch, as PLEXIL's own checkpoints were kept.
+  return std::chrono::duration<double>
+    (std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void append_json (string& out, const string& s)
+{
+  out += '"';
+  for (unsigned char c : s) {
+    switch (c) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\n': out += "\\n"; break;
+    case '\r': out += "\\r"; break;
+    case '\t': out += "\\t"; break;
+    default:
+      if (c < 0x20) {
+        char escape[8];
+        snprintf (escape, sizeof (escape), "\\u%04x", c);
+        out += escape;
+      }
+      else out += c;
+    }
+  }
+  out += '"';
+}
+
+// A journal record under construction: a flat JSON object whose first field
+// is its type.
+class Record
+{
+ public:
+  explicit Record (const char* type) : m_text ("{")
+  {
+    key ("type");
+    append_json (m_text, type);
+  }
+
+  Record& text (const char* name, const string& value)
+  {
+    key (name);
+    append_json (m_text, value);
+    return *this;
+  }
+
+  Record& flag (const char* name, bool value)
+  {
+    key (name);
+    m_text += value ? "true" : "false";
+    return *this;
+  }
+
+  Record& integer (const char* name, long long value)
+  {
+    key (name);
+    m_text += std::to_string (value);
+    return *this;
+  }
+
+  Record& number (const char* name, double value)
+  {
+    char buffer[32];
+    snprintf (buffer, sizeof (buffer), "%.6f", value);
+    key (name);
+    m_text += buffer;
+    return *this;
+  }
+
+  string str () const { return m_text + "}"; }
+
+ private:
+  void key (const char* name)
+  {
+    if (m_text.size() > 1) m_text += ',';
+    append_json (m_text, name);
+    m_text += ':';
+  }
+
+  string m_text;
+};
+
+// Parse a JSON string starting at the quote, leaving pos after its end.
+static bool parse_json_string (const string& line, size_t& pos, string& out)
+{
+  out.clear();
+  if (pos >= line.size() || line[pos] != '"') return false;
+  for (pos++; pos < line.size(); pos++) {
+    char c = line[pos];
+    if (c == '"') {
+      pos++;
+      return true;
+    }
+    if (c != '\\') {
+      out += c;
+      continue;
+    }
+    if (++pos >= line.size()) return false;
+    switch (line[pos]) {
+    case 'n': out += '\n'; break;
+    case 'r': out += '\r'; break;
+    case 't': out += '\t'; break;
+    case 'b': out += '\b'; break;
+    case 'f': out += '\f'; break;
+    case 'u': {
+      if (pos + 4 >= line.size()) return false;
+      unsigned long code = strtoul (line.substr (pos + 1, 4).c_str(), nullptr,
+                                    16);
+      pos += 4;
+      // Only control characters are escaped here; others are kept as UTF-8.
+      if (code < 0x80) out += static_cast<char>(code);
+      else if (code < 0x800) {
+        out += static_cast<char>(0xc0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+      }
+      else {
+        out += static_cast<char>(0xe0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+      }
+      break;
+    }
+    default: out += line[pos];  // quote, backslash or slash
+    }
+  }
+  return false;
+}
+
+// The fields of a record, as written by Record: strings unescaped, and other
+// values as they were written.  False if the line is not a whole record, as
+// when the last one was cut short by a crash.
+static bool parse_record (const string& line, map<string, string>& fields)
+{
+  fields.clear();
+  size_t pos = 0;
+  auto skip_space = [&] () {
+    while (pos < line.size() && isspace (static_cast<unsigned char>(line[pos])))
+      pos++;
+  };
+  skip_space();
+  if (pos >= line.size() || line[pos++] != '{') return false;
+  while (true) {
+    skip_space();
+    if (pos < line.size() && line[pos] == '}') return true;
+    string key, value;
+    if (! parse_json_string (line, pos, key)) return false;
+    skip_space();
+    if (pos >= line.size() || line[pos++] != ':') return false;
+    skip_space();
+    if (pos < line.size() && line[pos] == '"') {
+      if (! parse_json_string (line, pos, value)) return false;
+    }
+    else {
+      size_t end = line.find_first_of (",}", pos);
+      if (end == string::npos) return false;
+      value = line.substr (pos, end - pos);
+      while (! value.empty() && isspace (static_cast<unsigned char>
+                                         (value.back()))) {
+        value.pop_back();
+      }
+      pos = end;
+    }
+    fields[key] = value;
+    skip_space();
+    if (pos >= line.size()) return false;
+    if (line[pos] == ',') pos++;
+    else if (line[pos] != '}') return false;
+  }
+}
+
+static const string& field (const map<string, string>& fields,
+                            const char* name)
+{
+  static const string none;
+  auto it = fields.find (name);
+  return it == fields.end() ? none : it->second;
+}
+
+static uint64_t integer_field (const map<string, string>& fields,
+                               const char* name)
+{
+  return strtoull (field (fields, name).c_str(), nullptr, 10);
+}
+
+static double number_field (const map<string, string>& fields,
+                            const char* name)
+{
+  return strtod (field (fields, name).c_str(), nullptr);
+}
+
+// The lines of the journal from the start of its last complete snapshot, or
+// all of them if there is none.  Torn is set if the journal does not end with
+// a newline.  False if the journal cannot be read.
+static bool read_tail (const string& path, vector<string>& lines, bool& torn)
+{
+  lines.clear();
+  torn = false;
+  FILE* file = fopen (path.c_str(), "r");
+  if (! file) return false;
+  fseek (file, 0, SEEK_END);
+  long size = ftell (file);
+
+  for (long window = TailWindow; ; window *= 4) {
+    long start = std::max (0L, size - window);
+    string buffer (size - start, '\0');
+    fseek (file, start, SEEK_SET);
+    buffer.resize (fread (&buffer[0], 1, buffer.size(), file));
+    torn = ! buffer.empty() && buffer.back() != '\n';
+
+    lines.clear();
+    size_t pos = 0;
+    if (start > 0) {
+      // The first line may be partial.
+      pos = buffer.find ('\n');
+      pos = pos == string::npos ? buffer.size() : pos + 1;
+    }
+    while (pos < buffer.size()) {
+      size_t end = buffer.find ('\n', pos);
+      if (end == string::npos) end = buffer.size();
+      lines.push_back (buffer.substr (pos, end - pos));
+      pos = end + 1;
+    }
+
+    // The last snapshot that was finished.
+    bool ended = false;
+    for (size_t i = lines.size(); i-- > 0; ) {
+      if (lines[i] == SnapshotEnd) ended = true;
+      else if (lines[i] == SnapshotBegin && ended) {
+        lines.erase (lines.begin(), lines.begin() + i);
+        fclose (file);
+        return true;
+      }
+    }
+    if (start == 0) break;
+  }
+  fclose (file);
+  if (! lines.empty()) {
+    ROS_WARN ("No complete snapshot in %s, reading all of it.", path.c_str());
+  }
+  return true;
+}
+
+CheckpointJournal::~CheckpointJournal ()
+{
+  close (false);
+}
+
+bool CheckpointJournal::started () const
+{
+  return m_started;
+}
+
+void CheckpointJournal::open (const CheckpointConfig& config)
+{
+  if (m_started.exchange (true)) return;
+  m_config = config;
+  m_config.maxBoots = std::max<size_t> (m_config.maxBoots, 1);
+  m_path = m_config.directory;
+  if (! m_path.empty() && m_path.back() != '/') m_path += '/';
+  m_path += m_config.file;
+
+  vector<string> lines;
+  bool torn = false;
+  if (read_tail (m_path, lines, torn)) replay (lines);
+
+  size_t previous;
+  {
+    lock_guard<mutex> lock (m_stateMutex);
+    previous = m_boots.size();
+    uint64_t serial = m_boots.empty() ? 1 : m_boots.back().serial + 1;
+    m_boots.push_back ({ serial, now(), false, {} });
+    while (m_boots.size() > m_config.maxBoots) m_boots.pop_front();
+    m_serial = serial;
+  }
+
+  m_file = fopen (m_path.c_str(), "a");
+  if (! m_file) {
+    ROS_ERROR ("Cannot open checkpoint journal %s: %s.  Checkpoints will not "
+               "outlast this boot.", m_path.c_str(), strerror (errno));
+  }
+  else {
+    fseek (m_file, 0, SEEK_END);
+    m_fileSize = ftell (m_file);
+    // The new boot is in the snapshot, and so recorded before anything else.
+    if (! write ((torn ? "\n" : "") + snapshot()) || ! sync()) {
+      ROS_ERROR ("Cannot write checkpoint journal %s: %s", m_path.c_str(),
+                 strerror (errno));
+    }
+    if (m_fileSize > m_config.maxFileSize) rotate();
+    m_writeFailed = false;
+    {
+      lock_guard<mutex> lock (m_queueMutex);
+      m_writing = true;
+    }
+    m_writer = std::thread (&CheckpointJournal::writerLoop, this);
+  }
+
+  // Fault transitions, as published to the exec.
+  if (! m_faultStates) {
+    m_faultStates =
+      std::make_unique<std::atomic<uint8_t>[]> (StateHandle::MaxStates);
+    for (size_t i = 0; i < StateHandle::MaxStates; i++) {
+      m_faultStates[i].store (0);
+    }
+  }
+  m_faults = BoolStates::subscribe
+    ([this] (const StateHandle& state, bool active) {
+      if (! isFaultState (state)) return;
+      append (Record ("fault").integer ("boot", m_serial)
+              .text ("name", state.name()).flag ("active", active)
+              .number ("t", now()).str(), false);
+    });
+
+  ROS_INFO ("Checkpoints in %s: boot %llu, %zu previous boots kept.",
+            m_path.c_str(), (unsigned long long) m_serial, previous);
+}
+
+void CheckpointJournal::close (bool clean)
+{
+  if (! m_started || m_closed.exchange (true)) return;
+  m_faults.cancel();
+  if (clean && m_config.okOnExit) setBootOK (0);
+  {
+    lock_guard<mutex> lock (m_queueMutex);
+    m_stopping = true;
+  }
+  m_queueCondition.notify_one();
+  if (m_writer.joinable()) m_writer.join();
+  if (! m_file) return;
+  sync();
+  fclose (m_file);
+  m_file = nullptr;
+  ROS_INFO ("Checkpoint journal: %llu records written, %llu dropped.",
+            (unsigned long long) m_written, (unsigned long long) m_dropped);
+}
+
+void CheckpointJournal::replay (const vector<string>& lines)
+{
+  // Only checkpoints are restored.  The commands and plan the last boot left
+  // unfinished are reported.
+  lock_guard<mutex> lock (m_stateMutex);
+  uint64_t last = 0;
+  map<long long, string> commands;
+  string plan;
+  map<string, string> fields;
+
+  auto find_boot = [this] (uint64_t serial) -> Boot* {
+    for (auto it = m_boots.rbegin(); it != m_boots.rend(); ++it) {
+      if (it->serial == serial) return &*it;
+    }
+    return nullptr;
+  };
+
+  for (const string& line : lines) {
+    if (! parse_record (line, fields)) continue;
+    const string& type = field (fields, "type");
+    uint64_t serial = integer_field (fields, "boot");
+    if (type == "boot") {
+      // Boots recur in each snapshot, so each is added once.
+      if (! find_boot (serial)) {
+        m_boots.push_back ({ serial, number_field (fields, "t"), false, {} });
+      }
+      if (serial > last) {
+        last = serial;
+        commands.clear();
+        plan.clear();
+      }
+    }
+    else if (type == "boot_ok") {
+      Boot* boot = find_boot (serial);
+      if (boot) boot->ok = true;
+    }
+    else if (type == "checkpoint") {
+      Boot* boot = find_boot (serial);
+      if (boot) {
+        boot->checkpoints[field (fields, "name")] =
+          { field (fields, "state") == "true", number_field (fields, "t"),
+            field (fields, "info") };
+      }
+    }
+    else if (serial != last) continue;
+    else if (type == "command") {
+      long long id = integer_field (fields, "id");
+      const string& event = field (fields, "event");
+      if (event == "issued") commands[id] = field (fields, "name");
+      else if (event == "finished") commands.erase (id);
+    }
+    else if (type == "plan") {
+      if (field (fields, "event") == "start") plan = field (fields, "name");
+      else plan.clear();
+    }
+  }
+
+  std::sort (m_boots.begin(), m_boots.end(),
+             [] (const Boot& a, const Boot& b) { return a.serial < b.serial; });
+  if (m_boots.empty() || m_boots.back().ok) return;
+  ROS_WARN ("Boot %llu did not end cleanly.",
+            (unsigned long long) m_boots.back().serial);
+  if (! plan.empty()) ROS_WARN ("Plan %s was running.", plan.c_str());
+  for (const auto& command : commands) {
+    ROS_WARN ("Command %s (%lld) was in execution.", command.second.c_str(),
+              command.first);
+  }
+}
+
+string CheckpointJournal::snapshot () const
+{
+  lock_guard<mutex> lock (m_stateMutex);
+  string out = string (SnapshotBegin) + "\n";
+  for (const Boot& boot : m_boots) {
+    out += Record ("boot").integer ("boot", boot.serial)
+      .number ("t", boot.time).str() + "\n";
+    if (boot.ok) out += Record ("boot_ok").integer ("boot", boot.serial).str()
+                   + "\n";
+    for (const auto& entry : boot.checkpoints) {
+      out += Record ("checkpoint").integer ("boot", boot.serial)
+        .text ("name", entry.first).flag ("state", entry.second.state)
+        .number ("t", entry.second.time).text ("info", entry.second.info)
+        .str() + "\n";
+    }
+  }
+  out += string (SnapshotEnd) + "\n";
+  return out;
+}
+
+void CheckpointJournal::append (string record, bool essential)
+{
+  {
+    lock_guard<mutex> lock (m_queueMutex);
+    if (! m_writing) return;
+    if (! essential && m_queue.size() >= m_config.queueSize) {
+      m_dropped++;
+      return;
+    }
+    m_queue.push_back (std::move (record));
+  }
+  m_queueCondition.notify_one();
+}
+
+void CheckpointJournal::flush (std::function<void (bool)> done)
+{
+  {
+    lock_guard<mutex> lock (m_queueMutex);
+    if (m_writing) {
+      m_flushes.push_back (std::move (done));
+      m_queueCondition.notify_one();
+      return;
+    }
+  }
+  done (false);
+}
+
+void CheckpointJournal::writerLoop ()
+{
+  std::unique_lock<mutex> lock (m_queueMutex);
+  while (true) {
+    m_queueCondition.wait (lock, [this] {
+      return ! m_queue.empty() || ! m_flushes.empty() || m_stopping;
+    });
+    if (m_queue.empty() && m_flushes.empty()) {
+      m_writing = false;  // stopping, and everything is written
+      return;
+    }
+    std::deque<string> records;
+    records.swap (m_queue);
+    vector<std::function<void (bool)>> flushes;
+    flushes.swap (m_flushes);
+    lock.unlock();
+
+    string text;
+    uint64_t dropped = m_dropped - m_droppedReported;
+    if (dropped > 0) {
+      m_droppedReported += dropped;
+      text += Record ("dropped").integer ("boot", m_serial)
+        .integer ("count", dropped).str() + "\n";
+    }
+    for (const string& record : records) text += record + "\n";
+    if (write (text)) m_written += records.size();
+
+    // A flush reports on everything since the one before it.
+    if (! flushes.empty()) {
+      bool ok = sync() && ! m_writeFailed;
+      m_writeFailed = false;
+      for (auto& done : flushes) done (ok);
+    }
+    if (m_fileSize > m_config.maxFileSize) rotate();
+    lock.lock();
+  }
+}
+
+bool CheckpointJournal::write (const string& text)
+{
+  if (m_file && fwrite (text.data(), 1, text.size(), m_file) == text.size()) {
+    m_fileSize += text.size();
+    return true;
+  }
+  m_writeFailed = true;
+  return false;
+}
+
+bool CheckpointJournal::sync ()
+{
+  if (m_file && fflush (m_file) == 0 && fsync (fileno (m_file)) == 0) {
+    return true;
+  }
+  m_writeFailed = true;
+  return false;
+}
+
+bool CheckpointJournal::rotate ()
+{
+  // The journal is replaced by a snapshot of it, written aside so that a crash
+  // meanwhile leaves the old one.  Records already taken into the snapshot may
+  // be written again after it, which is harmless as they are replayed by
+  // value.
+  string temporary = m_path + ".tmp";
+  string text = snapshot();
+  FILE* file = fopen (temporary.c_str(), "w");
+  bool ok = file && fwrite (text.data(), 1, text.size(), file) == text.size()
+    && fflush (file) == 0 && fsync (fileno (file)) == 0;
+  if (file) fclose (file);
+  if (! ok || ::rename (temporary.c_str(), m_path.c_str()) != 0) {
+    ROS_ERROR ("Cannot rewrite checkpoint journal %s: %s", m_path.c_str(),
+               strerror (errno));
+    ::remove (temporary.c_str());
+    return false;
+  }
+  fclose (m_file);
+  m_file = fopen (m_path.c_str(), "a");
+  m_fileSize = text.size();
+  if (! m_file) {
+    ROS_ERROR ("Cannot reopen checkpoint journal %s: %s", m_path.c_str(),
+               strerror (errno));
+    m_writeFailed = true;
+    return false;
+  }
+  return true;
+}
+
+void CheckpointJournal::setCheckpoint (const string& name, bool state,
+                                       const string& info)
+{
+  string record;
+  {
+    lock_guard<mutex> lock (m_stateMutex);
+    if (m_boots.empty()) return;
+    Boot& boot = m_boots.back();
+    Checkpoint& checkpoint = boot.checkpoints[name];
+    checkpoint = { state, now(), info };
+    record = Record ("checkpoint").integer ("boot", boot.serial)
+      .text ("name", name).flag ("state", state)
+      .number ("t", checkpoint.time).text ("info", info).str();
+  }
+  append (std::move (record), true);
+}
+
+bool CheckpointJournal::isFaultState (const StateHandle& state)
+{
+  std::atomic<uint8_t>& kind = m_faultStates[state.index()];
+  uint8_t known = kind.load (std::memory_order_relaxed);
+  if (known) return known == 1;
+
+  static const string suffix = "Fault";
+  const string& name = state.name();
+  bool fault = ! state.arg() && name.size() >= suffix.size() &&
+    name.compare (name.size() - suffix.size(), string::npos, suffix) == 0;
+  kind.store (fault ? 1 : 2, std::memory_order_relaxed);
+  return fault;
+}
+
+bool CheckpointJournal::setBootOK (int32_t back)
+{
+  uint64_t serial;
+  {
+    lock_guard<mutex> lock (m_stateMutex);
+    if (back < 0 || static_cast<size_t>(back) >= m_boots.size()) return false;
+    Boot& boot = m_boots[m_boots.size() - 1 - back];
+    boot.ok = true;
+    serial = boot.serial;
+  }
+  append (Record ("boot_ok").integer ("boot", serial).str(), true);
+  return true;
+}
+
+const CheckpointJournal::Boot* CheckpointJournal::boot (int32_t back) const
+{
+  if (back < 0 || static_cast<size_t>(back) >= m_boots.size()) return nullptr;
+  return &m_boots[m_boots.size() - 1 - back];
+}
+
+const CheckpointJournal::Checkpoint*
+CheckpointJournal::checkpoint (const string& name, int32_t back) const
+{
+  const Boot* b = boot (back);
+  if (! b) return nullptr;
+  auto it = b->checkpoints.find (name);
+  return it == b->checkpoints.end() ? nullptr : &it->second;
+}
+
+Value CheckpointJournal::didCrash () const
+{
+  lock_guard<mutex> lock (m_stateMutex);
+  const Boot* previous = boot (1);
+  return Value (previous && ! previous->ok);
+}
+
+Value CheckpointJournal::unhandledBoots () const
+{
+  // The boots that crashed since the last one that was OK.
+  lock_guard<mutex> lock (m_stateMutex);
+  int32_t count = 0;
+  for (const Boot* b = boot (1); b && ! b->ok; b = boot (count + 1)) count++;
+  return Value (count);
+}
+
+Value CheckpointJournal::totalBoots () const
+{
+  lock_guard<mutex> lock (m_stateMutex);
+  return Value (static_cast<int32_t>(m_boots.size()));
+}
+
+Value CheckpointJournal::isBootOK (int32_t back) const
+{
+  lock_guard<mutex> lock (m_stateMutex);
+  const Boot* b = boot (back);
+  return b ? Value (b->ok) : Value();
+}
+
+Value CheckpointJournal::bootTime (int32_t back) const
+{
+  lock_guard<mutex> lock (m_stateMutex);
+  const Boot* b = boot (back);
+  return b ? Value (b->time) : Value();
+}
+
+Value CheckpointJournal::checkpointState (const string& name,
+                                          int32_t back) const
+{
+  lock_guard<mutex> lock (m_stateMutex);
+  const Checkpoint* c = checkpoint (name, back);
+  return c ? Value (c->state) : Value();
+}
+
+Value CheckpointJournal::checkpointTime (const string& name,
+                                         int32_t back) const
+{
+  lock_guard<mutex> lock (m_stateMutex);
+  const Checkpoint* c = checkpoint (name, back);
+  return c ? Value (c->time) : Value();
+}
+
+Value CheckpointJournal::checkpointInfo (const string& name,
+                                         int32_t back) const
+{
+  lock_guard<mutex> lock (m_stateMutex);
+  const Checkpoint* c = checkpoint (name, back);
+  return c ? Value (c->info) : Value();
+}
+
+Value CheckpointJournal::checkpointWhen (const string& name) const
+{
+  // The most recent boot in which the checkpoint was set.
+  lock_guard<mutex> lock (m_stateMutex);
+  for (int32_t back = 0; static_cast<size_t>(back) < m_boots.size(); back++) {
+    const Checkpoint* c = checkpoint (name, back);
+    if (c && c->state) return Value (back);
+  }
+  return Value();
+}
+
+void CheckpointJournal::commandIssued (int id, const string& name)
+{
+  append (Record ("command").integer ("boot", m_serial).integer ("id", id)
+          .text ("event", "issued").text ("name", name)
+          .number ("t", now()).str(), false);
+}
+
+void CheckpointJournal::commandAcked (int id)
+{
+  append (Record ("command").integer ("boot", m_serial).integer ("id", id)
+          .text ("event", "acked").number ("t", now()).str(), false);
+}
+
+void CheckpointJournal::commandFinished (int id, bool success)
+{
+  append (Record ("command").integer ("boot", m_serial).integer ("id", id)
+          .text ("event", "finished").flag ("success", success)
+          .number ("t", now()).str(), false);
+}
+
+void CheckpointJournal::planStarted (const string& name)
+{
+  append (Record ("plan").integer ("boot", m_serial).text ("event", "start")
+          .text ("name", name).number ("t", now()).str(), false);
+}
+
+void CheckpointJournal::planFinished (const string& name, bool ran)
+{
+  append (Record ("plan").integer ("boot", m_serial).text ("event", "finish")
+          .text ("name", name).flag ("ran", ran).number ("t", now()).str(),
+          false);
+}
@@ -0,0 +1,172 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Checkpoint_Journal_H
+#define Checkpoint_Journal_H
+
+// Checkpoints that let plans resume after a reboot, in place of the PLEXIL
+// CheckpointAdapter, kept in a journal which also records the commands, fault
+// transitions and plans of each boot.
+//
+// The journal is a file of JSON objects, one per line.  Records are appended
+// by a background thread from a bounded queue, so the exec never waits on the
+// disk; when the queue is full, command, fault and plan records are dropped
+// (and counted), but checkpoints never are.  A snapshot of the checkpoints of
+// the boots kept is appended at the start of each boot, and the file is
+// rewritten as a single snapshot when it grows too large, so that a restart
+// reads only the journal after the last complete snapshot.
+//
+// Boots are numbered back from the current one, which is 0, as in the plans'
+// checkpoint interface (see plan-interface.h).
+
+#include "subscriber.h"
+
+// PLEXIL API
+#include <Value.hh>
+
+// C++
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// From the adapter's configuration, e.g.
+//   <Checkpoints Directory="./" MaxBoots="16" MaxFileSize="1048576"/>
+struct CheckpointConfig
+{
+  std::string directory = "./";
+  std::string file = "ow_checkpoints.jsonl";
+  size_t maxBoots = 16;             // boots whose checkpoints are kept
+  size_t maxFileSize = 1 << 20;     // bytes, before the journal is rewritten
+  size_t queueSize = 1024;          // records awaiting the writer
+  bool okOnExit = true;             // a clean shutdown marks the boot OK
+};
+
+class CheckpointJournal
+{
+ public:
+  CheckpointJournal () = default;
+  ~CheckpointJournal ();
+  CheckpointJournal (const CheckpointJournal&) = delete;
+  CheckpointJournal& operator= (const CheckpointJournal&) = delete;
+
+  // Read the previous boots from the journal, start a new boot and the
+  // writer.  If the journal cannot be written, checkpoints are kept for this
+  // boot only and flushes fail.  Only the first call has any effect.
+  void open (const CheckpointConfig&);
+
+  // Write what is queued and stop the writer.  A clean close marks the boot
+  // OK if so configured.
+  void close (bool clean);
+
+  bool started () const;
+
+  // Checkpoint commands.  setBootOK is false if there is no such boot.
+  void setCheckpoint (const std::string& name, bool state,
+                      const std::string& info);
+  bool setBootOK (int32_t boot);
+
+  // Call done from the writer once everything recorded before the call is on
+  // disk, with false if any of it could not be written.
+  void flush (std::function<void (bool)> done);
+
+  // Checkpoint lookups.  They are Unknown for a boot or checkpoint not kept.
+  PLEXIL::Value didCrash () const;
+  PLEXIL::Value unhandledBoots () const;
+  PLEXIL::Value totalBoots () const;
+  PLEXIL::Value isBootOK (int32_t boot) const;
+  PLEXIL::Value bootTime (int32_t boot) const;
+  PLEXIL::Value checkpointState (const std::string& name, int32_t boot) const;
+  PLEXIL::Value checkpointTime (const std::string& name, int32_t boot) const;
+  PLEXIL::Value checkpointInfo (const std::string& name, int32_t boot) const;
+  PLEXIL::Value checkpointWhen (const std::string& name) const;
+
+  // Journal only; these may be dropped.
+  void commandIssued (int id, const std::string& name);
+  void commandAcked (int id);
+  void commandFinished (int id, bool success);
+  void planStarted (const std::string& name);
+  void planFinished (const std::string& name, bool ran);
+
+  // Metrics
+  uint64_t recordsWritten () const { return m_written; }
+  uint64_t recordsDropped () const { return m_dropped; }
+
+ private:
+  struct Checkpoint
+  {
+    bool state;
+    double time;
+    std::string info;
+  };
+
+  struct Boot
+  {
+    uint64_t serial;
+    double time;
+    bool ok;
+    std::map<std::string, Checkpoint> checkpoints;
+  };
+
+  // The boot the given number of boots back, or null.  Call with m_stateMutex
+  // held.
+  const Boot* boot (int32_t back) const;
+  const Checkpoint* checkpoint (const std::string& name, int32_t back) const;
+
+  void replay (const std::vector<std::string>& lines);
+  std::string snapshot () const;
+  void append (std::string record, bool essential);
+  void writerLoop ();
+  bool write (const std::string& text);
+  bool sync ();
+  bool rotate ();
+
+  CheckpointConfig m_config;
+  std::string m_path;
+
+  // Boots oldest first, the current one last.
+  std::deque<Boot> m_boots;
+  mutable std::mutex m_stateMutex;
+  std::atomic<uint64_t> m_serial {0};   // of the current boot
+  std::atomic<bool> m_started {false};
+  std::atomic<bool> m_closed {false};
+
+  // Records awaiting the writer, and the flushes waiting on them.
+  std::deque<std::string> m_queue;
+  std::vector<std::function<void (bool)>> m_flushes;
+  std::mutex m_queueMutex;
+  std::condition_variable m_queueCondition;
+  bool m_writing = false;
+  bool m_stopping = false;
+  std::thread m_writer;
+
+  // Used by the writer only, once started.
+  FILE* m_file = nullptr;
+  size_t m_fileSize = 0;
+  bool m_writeFailed = false;
+
+  std::atomic<uint64_t> m_written {0};
+  std::atomic<uint64_t> m_dropped {0};
+  uint64_t m_droppedReported = 0;
+
+  // Fault states, i.e. Boolean ones named *Fault, which are journaled.  Each
+  // state's kind is found from its name the first time it is published, and
+  // then kept by handle index: 0 not yet known, 1 fault, 2 other.
+  bool isFaultState (const StateHandle&);
+  std::unique_ptr<std::atomic<uint8_t>[]> m_faultStates;
+  Subscription m_faults;
+};
+
+// The journal of this process, opened by the first adapter initialized.
+extern CheckpointJournal g_checkpoints;
+
+#endif
@@ -0,0 +1,216 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Command_Binder_H
+#define Command_Binder_H
+
+// PLEXIL command handlers generated from the testbed interface's member
+// functions.  A lander command is a member function taking the command's
+// arguments, in the order the plans declare them (see lander-commands.h),
+// followed by the command ID, e.g.
+//
+//   void OwInterface::deliver (double x, double y, double z, int id);
+//
+// whose handler, found by the interface of the command (see CommandBinding),
+// is registered as
+//
+//   g_configuration->registerCommandHandler
+//     ("deliver", COMMAND_BINDING (lander_of, &OwInterface::deliver));
+//
+// The handler unpacks the arguments by the member function's parameter types,
+// and fails the command, without calling the interface, if their number or
+// types differ, so that a change to either the function or the plans'
+// declaration shows at its first use.  Strings and Real arrays are passed in
+// place, without copying.  Otherwise the handler does what the hand-written
+// ones did: create the command's record, call the interface and acknowledge
+// the command.
+
+#include "adapter_support.h"
+
+// ROS
+#include <ros/ros.h>
+
+// PLEXIL API
+#include <ArrayImpl.hh>
+#include <AdapterExecInterface.hh>
+#include <Command.hh>
+#include <Value.hh>
+
+// C++
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Conversion of a command argument to a parameter type.  Each specialization
+// gets the argument into a Type, false if it is unknown or of another type,
+// and passes it on as the parameter.
+template <class Param>
+struct CommandArgument;
+
+template <>
+struct CommandArgument<double>
+{
+  using Type = double;
+  static const char* typeName () { return "Real"; }
+  static bool get (const PLEXIL::Value& arg, Type& out)
+  {
+    return arg.getValue (out);
+  }
+  static double pass (Type value) { return value; }
+};
+
+template <>
+struct CommandArgument<int>
+{
+  using Type = int32_t;
+  static const char* typeName () { return "Integer"; }
+  static bool get (const PLEXIL::Value& arg, Type& out)
+  {
+    return arg.getValue (out);
+  }
+  static int pass (Type value) { return value; }
+};
+
+template <>
+struct CommandArgument<bool>
+{
+  using Type = bool;
+  static const char* typeName () { return "Boolean"; }
+  static bool get (const PLEXIL::Value& arg, Type& out)
+  {
+    return arg.getValue (out);
+  }
+  static bool pass (Type value) { return value; }
+};
+
+template <>
+struct CommandArgument<std::string>
+{
+  using Type = const std::string*;
+  static const char* typeName () { return "String"; }
+  static bool get (const PLEXIL::Value& arg, Type& out)
+  {
+    return arg.getValuePointer (out) && out;
+  }
+  static const std::string& pass (Type value) { return *value; }
+};
+
+template <>
+struct CommandArgument<std::vector<double>>
+{
+  using Type = const std::vector<double>*;
+  static const char* typeName () { return "Real array"; }
+  static bool get (const PLEXIL::Value& arg, Type& out)
+  {
+    const PLEXIL::RealArray* array = nullptr;
+    if (! arg.getValuePointer (array) || ! array) return false;
+    out = nullptr;
+    array->getContentsVector (out);
+    return out;
+  }
+  static const std::vector<double>& pass (Type value) { return *value; }
+};
+
+// The arguments of a command, unpacked into Values for parameters of the
+// given types.  Unpacking fails, and logs why, if the arguments' number or
+// types differ from the parameters'.  Strings and Real arrays are unpacked as
+// pointers into the arguments.
+template <class... Params>
+struct CommandArguments
+{
+  using Values = std::tuple<typename CommandArgument<Params>::Type...>;
+
+  static bool unpack (const std::string& name,
+                      const std::vector<PLEXIL::Value>& args, Values& values)
+  {
+    return unpack (name, args, values,
+                   std::make_index_sequence<sizeof... (Params)>());
+  }
+
+ private:
+  template <size_t... I>
+  static bool unpack (const std::string& name,
+                      const std::vector<PLEXIL::Value>& args, Values& values,
+                      std::index_sequence<I...>)
+  {
+    if (args.size() != sizeof... (I)) {
+      ROS_ERROR ("%s: expected %zu arguments, got %zu.",
+                 name.c_str(), sizeof... (I), args.size());
+      return false;
+    }
+    const bool ok[] = {
+      true, CommandArgument<Params>::get (args[I], std::get<I> (values))...
+    };
+    const char* types[] = { "", CommandArgument<Params>::typeName()... };
+    for (size_t i = 0; i < sizeof... (I); i++) {
+      if (! ok[i + 1]) {
+        ROS_ERROR ("%s: argument %zu should be a known %s.",
+                   name.c_str(), i + 1, types[i + 1]);
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// The handler of the commands bound to an interface member function, whose
+// interface is given by locate, a function of the command.  The function's
+// last parameter is the command ID.
+template <class Interface, Interface* (*locate) (PLEXIL::Command*),
+          class Method, Method method>
+struct CommandBinding;
+
+template <class Interface, Interface* (*locate) (PLEXIL::Command*),
+          class... Params, void (Interface::*method) (Params...)>
+struct CommandBinding<Interface, locate, void (Interface::*) (Params...),
+                      method>
+{
+  static_assert (sizeof... (Params) > 0, "a command takes its ID last");
+
+  static void handle (PLEXIL::Command* cmd, PLEXIL::AdapterExecInterface* intf)
+  {
+    handle (cmd, intf, std::make_index_sequence<sizeof... (Params) - 1>());
+  }
+
+ private:
+  template <size_t I>
+  using Param = std::decay_t<std::tuple_element_t<I, std::tuple<Params...>>>;
+
+  static_assert (std::is_same<Param<sizeof... (Params) - 1>, int>::value,
+                 "a command takes its ID last");
+
+  template <size_t... I>
+  static void handle (PLEXIL::Command* cmd, PLEXIL::AdapterExecInterface* intf,
+                      std::index_sequence<I...>)
+  {
+    using Arguments = CommandArguments<Param<I>...>;
+    typename Arguments::Values values;
+    if (! Arguments::unpack (cmd->getName(), cmd->getArgValues(), values)) {
+      reject (cmd, intf);
+      return;
+    }
+
+    std::shared_ptr<CommandRecord> cr = new_command_record (cmd, intf);
+    (locate (cmd)->*method)
+      (CommandArgument<Param<I>>::pass (std::get<I> (values))..., cr->id);
+    send_ack_once (*cr);
+  }
+
+  static void reject (PLEXIL::Command* cmd, PLEXIL::AdapterExecInterface* intf)
+  {
+    std::shared_ptr<CommandRecord> cr = new_command_record (cmd, intf);
+    command_status_callback (cr->id, false);
+  }
+};
+
+// The command handler for the member function, an ExecuteCommandHandler.
+#define COMMAND_BINDING(locate, method)                                   \
+  (&CommandBinding<std::remove_pointer_t<decltype (locate (nullptr))>,    \
+                   locate, decltype (method), method>::handle)
+
+#endif
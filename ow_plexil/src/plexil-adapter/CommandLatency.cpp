@@ -0,0 +1,73 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "CommandLatency.h"
+#include <ros/ros.h>
+#include <algorithm>
+
+using std::lock_guard;
+using std::mutex;
+using std::string;
+
+static const char* StageNames[NumCommandStages] = {
+  "dispatched", "acknowledged", "started", "goal sent", "active", "finished"
+};
+
+void LatencyHistogram::add (int64_t nanoseconds)
+{
+  if (nanoseconds < 0) nanoseconds = 0;
+  int64_t microseconds = nanoseconds / 1000;
+  size_t bucket = 0;
+  while (bucket < NumBuckets - 1 && (int64_t(1) << bucket) <= microseconds) {
+    bucket++;
+  }
+  m_buckets[bucket]++;
+  m_count++;
+  if (nanoseconds > m_max) m_max = nanoseconds;
+}
+
+double LatencyHistogram::percentile (double fraction) const
+{
+  if (m_count == 0) return 0;
+  size_t rank = static_cast<size_t>(fraction * (m_count - 1)) + 1;
+  size_t seen = 0;
+  for (size_t bucket = 0; bucket < NumBuckets; bucket++) {
+    seen += m_buckets[bucket];
+    if (seen >= rank) {
+      // Bucket b holds durations below 2^b microseconds.
+      double bound = double(int64_t(1) << bucket) * 1e-6;
+      return std::min (bound, max());
+    }
+  }
+  return max();
+}
+
+void CommandLatencyStats::record (const string& command_name,
+                                  const CommandTimestamps& timestamps)
+{
+  int64_t dispatched = timestamps[0];
+  if (dispatched == 0) return;
+  lock_guard<mutex> lock (m_mutex);
+  StageHistograms& histograms = m_histograms[command_name];
+  for (size_t stage = 1; stage < NumCommandStages; stage++) {
+    if (timestamps[stage] != 0) {
+      histograms[stage].add (timestamps[stage] - dispatched);
+    }
+  }
+}
+
+void CommandLatencyStats::log () const
+{
+  lock_guard<mutex> lock (m_mutex);
+  for (const auto& entry : m_histograms) {
+    for (size_t stage = 1; stage < NumCommandStages; stage++) {
+      const LatencyHistogram& h = entry.second[stage];
+      if (h.count() == 0) continue;
+      ROS_INFO ("%s, dispatched to %s: %zu samples, p50 %.6f s, p90 %.6f s, "
+                "p99 %.6f s, max %.6f s", entry.first.c_str(),
+                StageNames[stage], h.count(), h.percentile (0.5),
+                h.percentile (0.9), h.percentile (0.99), h.max());
+    }
+  }
+}
@@ -0,0 +1,76 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Command_Latency_H
+#define Command_Latency_H
+
+// Latency of the stages of PLEXIL commands, from dispatch by the adapter to
+// the final status, aggregated per command name into histograms.
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Stages of a command's life, in order.  Not every command passes through
+// all of them: only actions have GoalSent and Active.
+enum class CommandStage {
+  Dispatched,    // handed to the testbed interface by the adapter
+  Acknowledged,  // COMMAND_SENT_TO_SYSTEM sent to the exec
+  Started,       // operation admitted, possibly after waiting in its queue
+  GoalSent,      // action goal sent to its server
+  Active,        // action server accepted the goal
+  Finished       // final status sent to the exec
+};
+
+const size_t NumCommandStages = static_cast<size_t>(CommandStage::Finished) + 1;
+
+// Monotonic time of each stage in nanoseconds, or 0 if not reached.
+using CommandTimestamps = std::array<int64_t, NumCommandStages>;
+
+inline int64_t command_timestamp ()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Histogram of durations with power-of-two buckets of microseconds, from 1 us
+// to about 1 hour; longer durations go in the last bucket.
+class LatencyHistogram
+{
+ public:
+  void add (int64_t nanoseconds);
+  size_t count () const { return m_count; }
+
+  // Upper bound of the bucket holding the given fraction of the samples, in
+  // seconds.
+  double percentile (double fraction) const;
+  double max () const { return m_max * 1e-9; }
+
+ private:
+  static const size_t NumBuckets = 32;
+  std::array<size_t, NumBuckets> m_buckets {};
+  size_t m_count = 0;
+  int64_t m_max = 0;
+};
+
+class CommandLatencyStats
+{
+ public:
+  // Add the latencies of a finished command, measured from its dispatch.
+  void record (const std::string& command_name,
+               const CommandTimestamps& timestamps);
+
+  // Log the percentiles of every stage of every command seen.
+  void log () const;
+
+ private:
+  // Histograms of the time from dispatch to each later stage.
+  using StageHistograms = std::array<LatencyHistogram, NumCommandStages>;
+  std::map<std::string, StageHistograms> m_histograms;
+  mutable std::mutex m_mutex;
+};
+
+#endif
@@ -0,0 +1,50 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "CommandRegistry.h"
+
+using std::lock_guard;
+using std::mutex;
+using std::shared_ptr;
+
+void CommandRegistry::insert (int id, shared_ptr<CommandRecord> record)
+{
+  Shard& s = shard (id);
+  {
+    lock_guard<mutex> lock (s.mutex);
+    shared_ptr<CommandRecord>& slot = s.records[id];
+    bool replaced = (slot != nullptr);
+    slot = std::move (record);
+    // IDs are not reused while live, but keep the counts honest regardless.
+    if (replaced) return;
+  }
+  m_total++;
+  size_t live = ++m_live;
+  size_t peak = m_peak.load();
+  while (live > peak && ! m_peak.compare_exchange_weak (peak, live)) { }
+}
+
+shared_ptr<CommandRecord> CommandRegistry::find (int id) const
+{
+  const Shard& s = shard (id);
+  lock_guard<mutex> lock (s.mutex);
+  auto it = s.records.find (id);
+  if (it == s.records.end()) return nullptr;
+  return it->second;
+}
+
+shared_ptr<CommandRecord> CommandRegistry::remove (int id)
+{
+  shared_ptr<CommandRecord> record;
+  Shard& s = shard (id);
+  {
+    lock_guard<mutex> lock (s.mutex);
+    auto it = s.records.find (id);
+    if (it == s.records.end()) return nullptr;
+    record = std::move (it->second);
+    s.records.erase (it);
+  }
+  m_live--;
+  return record;
+}
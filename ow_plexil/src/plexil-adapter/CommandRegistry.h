@@ -0,0 +1,106 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Command_Registry_H
+#define Command_Registry_H
+
+// Registry of the PLEXIL commands currently in execution by the testbed, keyed
+// by command ID.  Records are added by the exec thread and found, and finally
+// removed, by whichever thread reports the command's status.  The table is
+// split into shards, each with its own lock, so that concurrent lookups of
+// different commands rarely contend.  Records are shared, so a caller holding
+// one may keep using it after it has been removed.
+
+// PLEXIL API
+#include <Command.hh>
+#include <AdapterExecInterface.hh>
+
+#include "CommandLatency.h"
+
+// C++
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// A Plexil command instance with its ID and executive interface, whether its
+// COMMAND_SENT_TO_SYSTEM acknowledgment has been given, and when it reached
+// each stage.  The mutex orders the acknowledgments of the command.
+struct CommandRecord
+{
+  CommandRecord (int cmd_id, PLEXIL::Command* cmd,
+                 PLEXIL::AdapterExecInterface* intf)
+    : id (cmd_id), command (cmd), adapter (intf), ackSent (false)
+  {
+    for (auto& time : stageTimes) time = 0;
+  }
+  CommandRecord (const CommandRecord&) = delete;
+  CommandRecord& operator= (const CommandRecord&) = delete;
+
+  // Record that the command reached the given stage now.  A stage reached
+  // more than once keeps its first time.
+  void markStage (CommandStage stage)
+  {
+    int64_t unset = 0;
+    stageTimes[static_cast<size_t>(stage)].compare_exchange_strong
+      (unset, command_timestamp());
+  }
+
+  CommandTimestamps timestamps () const
+  {
+    CommandTimestamps result;
+    for (size_t i = 0; i < NumCommandStages; i++) result[i] = stageTimes[i];
+    return result;
+  }
+
+  const int id;
+  PLEXIL::Command* const command;
+  PLEXIL::AdapterExecInterface* const adapter;
+  std::mutex ackMutex;
+  bool ackSent;
+  std::array<std::atomic<int64_t>, NumCommandStages> stageTimes;
+};
+
+class CommandRegistry
+{
+ public:
+  CommandRegistry () = default;
+  CommandRegistry (const CommandRegistry&) = delete;
+  CommandRegistry& operator= (const CommandRegistry&) = delete;
+
+  void insert (int id, std::shared_ptr<CommandRecord> record);
+
+  // Return the record, or null if there is none.
+  std::shared_ptr<CommandRecord> find (int id) const;
+
+  // Remove and return the record, or null if there is none.
+  std::shared_ptr<CommandRecord> remove (int id);
+
+  // Metrics
+  size_t liveCount () const { return m_live; }   // commands in execution
+  size_t peakCount () const { return m_peak; }   // high-water mark of the above
+  size_t totalCount () const { return m_total; } // commands ever registered
+
+ private:
+  static const size_t NumShards = 16;
+
+  struct Shard
+  {
+    mutable std::mutex mutex;
+    std::unordered_map<int, std::shared_ptr<CommandRecord>> records;
+  };
+
+  Shard& shard (int id) { return m_shards[static_cast<unsigned>(id) % NumShards]; }
+  const Shard& shard (int id) const
+  {
+    return m_shards[static_cast<unsigned>(id) % NumShards];
+  }
+
+  Shard m_shards[NumShards];
+  std::atomic<size_t> m_live {0};
+  std::atomic<size_t> m_peak {0};
+  std::atomic<size_t> m_total {0};
+};
+
+#endif
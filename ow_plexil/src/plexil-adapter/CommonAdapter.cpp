@@ -7,6 +7,8 @@
 // ow_plexil
 #include "CommonAdapter.h"
 #include "adapter_support.h"
+#include "CheckpointJournal.h"
+#include "FlightRecorder.h"
 #include "subscriber.h"
 
 // ROS
@@ -23,31 +25,422 @@
 #include <StateCacheEntry.hh>
 using namespace PLEXIL;
 
-void CommonAdapter::propagateValueChange (const State& state,
-                                          const std::vector<Value>& vals) const
+// C++
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+// Per-thread state of PublishBatch scopes (see subscriber.h), for each adapter
+// that has seen one on the thread.
+struct BatchState
+{
+  const CommonAdapter* adapter;
+  int depth;
+  bool pending;
+};
+static thread_local std::vector<BatchState> BatchStates;
+
+static BatchState* batch_state (const CommonAdapter* adapter, bool create)
 {
-  if (! isStateSubscribed (state)) {
-    debugMsg("CommonAdapter:propagateValueChange", " ignoring " << state);
+  for (BatchState& state : BatchStates) {
+    if (state.adapter == adapter) return &state;
+  }
+  if (! create) return nullptr;
+  BatchStates.push_back ({ adapter, 0, false });
+  return &BatchStates.back();
+}
+
+// A value as the flight recorder keeps it: numbers and Booleans as such,
+// anything else as NaN.
+static double flight_value (const Value& value)
+{
+  if (value.isKnown()) {
+    switch (value.valueType()) {
+    case REAL_TYPE: {
+      double real;
+      if (value.getValue (real)) return real;
+      break;
+    }
+    case INTEGER_TYPE: {
+      int32_t integer;
+      if (value.getValue (integer)) return integer;
+      break;
+    }
+    case BOOLEAN_TYPE: {
+      bool boolean;
+      if (value.getValue (boolean)) return boolean;
+      break;
+    }
+    default:
+      break;
+    }
+  }
+  return std::numeric_limits<double>::quiet_NaN();
+}
+
+// See CommonAdapter::adapters().
+static std::mutex AdaptersMutex;
+static std::vector<CommonAdapter*> Adapters;
+
+std::vector<CommonAdapter*> CommonAdapter::adapters ()
+{
+  std::lock_guard<std::mutex> lock (AdaptersMutex);
+  return Adapters;
+}
+
+void CommonAdapter::propagateValueChange (StateRegistry::Entry& entry,
+                                          const Value& value)
+{
+  if (! entry.subscribed) {
+    debugMsg("CommonAdapter:propagateValueChange", " ignoring " << entry.state);
+    return;
+  }
+
+  switch (entry.admit (value)) {
+  case Admission::Send:
+    break;
+  case Admission::Hold:
+    debugMsg("CommonAdapter:propagateValueChange", " holding " << entry.state);
+    holdValueChange (entry);
+    return;
+  case Admission::Drop:
+    debugMsg("CommonAdapter:propagateValueChange", " filtered " << entry.state);
     return;
   }
 
-  debugMsg("CommonAdapter:propagateValueChange", " sending " << state);
-  m_execInterface.handleValueChange (state, vals.front());
+  debugMsg("CommonAdapter:propagateValueChange", " sending " << entry.state);
+  sendValueChange (entry, value);
+}
+
+void CommonAdapter::sendValueChange (StateRegistry::Entry& entry,
+                                     const Value& value)
+{
+  if (g_flightRecorder.enabled()) {
+    flight_record (FlightEventType::ValueChange, entry.state.name(), 0,
+                   flight_value (value));
+  }
+  m_execInterface.handleValueChange (entry.state, value);
+  notifyExec();
+}
+
+void CommonAdapter::notifyExec ()
+{
+  m_eventsReceived++;
+  BatchState* batch = batch_state (this, false);
+  if (batch && batch->depth > 0) batch->pending = true;
+  else signalExec();
+}
+
+void CommonAdapter::notifyExecNow ()
+{
+  m_eventsReceived++;
+  {
+    std::lock_guard<std::mutex> lock (m_notifyMutex);
+    m_notifyPending = false;
+  }
+  sendNotification();
+}
+
+void CommonAdapter::beginBatch ()
+{
+  batch_state (this, true)->depth++;
+}
+
+void CommonAdapter::endBatch ()
+{
+  BatchState* batch = batch_state (this, false);
+  if (batch && batch->depth > 0 && --batch->depth == 0 && batch->pending) {
+    batch->pending = false;
+    signalExec();
+  }
+}
+
+void CommonAdapter::receiveBatchEvent (BatchEvent event)
+{
+  if (event == BatchEvent::Begin) beginBatch();
+  else endBatch();
+}
+
+void CommonAdapter::subscribeTelemetry ()
+{
+  // The receivers find the state's entry by its handle, and build the value
+  // on the stack only if the exec is subscribed to it, so that publishing
+  // telemetry takes no lock and, but for arrays, does not allocate.  Array
+  // values are copied straight from the array.
+
+  auto receive = [this] (const StateHandle& state, const auto& val) {
+    StateRegistry::Entry& entry = m_states.entry (state);
+    if (entry.subscribed) propagateValueChange (entry, Value (val));
+  };
+  m_subscriptions.push_back (BoolStates::subscribe (receive));
+  m_subscriptions.push_back (DoubleStates::subscribe (receive));
+  m_subscriptions.push_back (StringStates::subscribe (receive));
+  m_subscriptions.push_back (DoubleVectorStates::subscribe (receive));
+  m_subscriptions.push_back (RealArrayStates::subscribe (receive));
+
+  m_subscriptions.push_back (Batches::subscribe
+    ([this] (BatchEvent event) { receiveBatchEvent (event); }));
+}
+
+void CommonAdapter::signalExec ()
+{
+  {
+    std::lock_guard<std::mutex> lock (m_notifyMutex);
+    if (m_notifierRunning) {
+      m_notifyPending = true;
+      m_notifyCondition.notify_one();
+      return;
+    }
+  }
+  sendNotification();
+}
+
+void CommonAdapter::sendNotification ()
+{
+  flight_record (FlightEventType::ExecNotified, "");
   m_execInterface.notifyOfExternalEvent();
+  m_notificationsSent++;
+}
+
+void CommonAdapter::startNotifier ()
+{
+  std::lock_guard<std::mutex> lock (m_notifyMutex);
+  if (m_notifierRunning || m_drainWindow.count() <= 0) return;
+  m_notifierRunning = true;
+  m_notifier = std::thread (&CommonAdapter::notifierLoop, this);
+}
+
+void CommonAdapter::stopNotifier ()
+{
+  {
+    std::lock_guard<std::mutex> lock (m_notifyMutex);
+    if (! m_notifierRunning) return;
+    m_notifierRunning = false;
+  }
+  m_notifyCondition.notify_one();
+  if (m_notifier.joinable()) m_notifier.join();
+  ROS_INFO("Exec notifications: %llu sent for %llu events.",
+           (unsigned long long) m_notificationsSent,
+           (unsigned long long) m_eventsReceived);
 }
 
-bool CommonAdapter::isStateSubscribed(const State& state) const
+void CommonAdapter::notifierLoop ()
 {
-  return m_subscribedStates.find(state) != m_subscribedStates.end();
+  std::unique_lock<std::mutex> lock (m_notifyMutex);
+  while (true) {
+    m_notifyCondition.wait (lock, [this] {
+      return m_notifyPending || ! m_notifierRunning;
+    });
+    if (! m_notifyPending) return;  // stopped, nothing left to signal
+
+    // Let the rest of the burst arrive, then wake the exec once for all of it,
+    // unless a command ack has done so meanwhile.
+    lock.unlock();
+    std::this_thread::sleep_for (m_drainWindow);
+    lock.lock();
+    if (! m_notifyPending) continue;
+    m_notifyPending = false;
+    lock.unlock();
+    sendNotification();
+    lock.lock();
+  }
+}
+
+void CommonAdapter::holdValueChange (const StateRegistry::Entry& entry)
+{
+  // Wake the flusher if the value is due before whatever it is waiting for.
+  auto due = StateRegistry::Clock::now() +
+    std::chrono::duration_cast<StateRegistry::Clock::duration>
+    (std::chrono::duration<double> (entry.filter.minInterval));
+  std::lock_guard<std::mutex> lock (m_flushMutex);
+  if (m_flusherRunning && due < m_flushDue) {
+    m_flushDue = due;
+    m_flushCondition.notify_one();
+  }
+}
+
+void CommonAdapter::startFlusher ()
+{
+  std::lock_guard<std::mutex> lock (m_flushMutex);
+  if (m_flusherRunning || ! m_states.holdsValues()) return;
+  m_flusherRunning = true;
+  m_flushDue = StateRegistry::Clock::time_point::max();
+  m_flusher = std::thread (&CommonAdapter::flusherLoop, this);
+}
+
+void CommonAdapter::stopFlusher ()
+{
+  {
+    std::lock_guard<std::mutex> lock (m_flushMutex);
+    if (! m_flusherRunning) return;
+    m_flusherRunning = false;
+  }
+  m_flushCondition.notify_one();
+  if (m_flusher.joinable()) m_flusher.join();
+}
+
+void CommonAdapter::flusherLoop ()
+{
+  std::unique_lock<std::mutex> lock (m_flushMutex);
+  while (m_flusherRunning) {
+    auto now = StateRegistry::Clock::now();
+    if (now < m_flushDue) {
+      if (m_flushDue == StateRegistry::Clock::time_point::max()) {
+        m_flushCondition.wait (lock);
+      }
+      else m_flushCondition.wait_until (lock, m_flushDue);
+      continue;
+    }
+
+    // Values held from here on lower the due time again, so none is missed
+    // while the registry is scanned.
+    m_flushDue = StateRegistry::Clock::time_point::max();
+    lock.unlock();
+    auto next = m_states.flushHeld
+      (now, [this] (StateRegistry::Entry& entry, const Value& value) {
+        if (entry.subscribed) {
+          debugMsg("CommonAdapter:flushHeld", " sending " << entry.state);
+          sendValueChange (entry, value);
+        }
+      });
+    lock.lock();
+    m_flushDue = std::min (m_flushDue, next);
+  }
+}
+
+uint64_t CommonAdapter::eventsReceived () const
+{
+  return m_eventsReceived;
+}
+
+uint64_t CommonAdapter::notificationsSent () const
+{
+  return m_notificationsSent;
+}
+
+uint64_t CommonAdapter::lookupsPerformed () const
+{
+  return m_lookupsPerformed;
+}
+
+void CommonAdapter::loadNotificationConfig ()
+{
+  // Coalescing of exec notifications, from the adapter's configuration, e.g.
+  //   <ExecNotification DrainWindow="0.002"/>
+  // DrainWindow is in seconds.  Zero, the default, notifies once per batch or
+  // value change outside one; a window delays every value change by up to its
+  // length, and suits only bursts from many threads at once.
+
+  double window =
+    getXml().child("ExecNotification").attribute("DrainWindow").as_double(0);
+  m_drainWindow = std::chrono::duration<double> (window > 0 ? window : 0);
+  if (window > 0) {
+    ROS_INFO("Coalescing exec notifications over %g seconds.", window);
+  }
+}
+
+void CommonAdapter::loadCheckpointConfig ()
+{
+  // The checkpoint journal, from the adapter's configuration, e.g.
+  //   <Checkpoints Directory="./" MaxBoots="16" MaxFileSize="1048576"/>
+  // and optionally File, QueueSize (records) and OKOnExit.  A relative
+  // Directory is taken from the node's working directory, ~/.ros by default.
+  // The journal is shared by all adapters, so only the first configures it.
+
+  if (g_checkpoints.started()) return;
+  CheckpointConfig config;
+  pugi::xml_node node = getXml().child("Checkpoints");
+  config.directory =
+    node.attribute("Directory").as_string(config.directory.c_str());
+  config.file = node.attribute("File").as_string(config.file.c_str());
+  config.maxBoots = node.attribute("MaxBoots").as_uint(config.maxBoots);
+  config.maxFileSize =
+    node.attribute("MaxFileSize").as_uint(config.maxFileSize);
+  config.queueSize = node.attribute("QueueSize").as_uint(config.queueSize);
+  config.okOnExit = node.attribute("OKOnExit").as_bool(config.okOnExit);
+  g_checkpoints.open (config);
+}
+
+void CommonAdapter::loadFlightRecorderConfig ()
+{
+  // The flight recorder (see FlightRecorder.h), from the adapter's
+  // configuration, e.g.
+  //   <FlightRecorder File="ow_flight.rec" Events="1048576" Buffer="16384"/>
+  // Events is the number kept in the file, and Buffer the number the ring
+  // holds before the writer takes them.  Without the element nothing is
+  // recorded.  Like the checkpoint journal, the recorder is shared by all
+  // adapters.
+
+  pugi::xml_node node = getXml().child("FlightRecorder");
+  if (! node || g_flightRecorder.enabled()) return;
+  FlightRecorderConfig config;
+  config.file = node.attribute("File").as_string(config.file.c_str());
+  config.events = node.attribute("Events").as_uint(config.events);
+  config.buffer = node.attribute("Buffer").as_uint(config.buffer);
+  g_flightRecorder.open (config);
+}
+
+void CommonAdapter::loadTelemetryFilters ()
+{
+  // Filters on published states, from the adapter's configuration, e.g.
+  //   <TelemetryFilter State="HandYawPosition ScoopYawPosition"
+  //                    Deadband="0.001" MaxRate="10"/>
+  // State is one or more names, separated by spaces, each of which may have
+  // a '*' wildcard.  Deadband is in the state's units and MaxRate in Hz; both
+  // are optional.  A change held back by MaxRate is sent when its interval is
+  // over.
+
+  const char* tag = "TelemetryFilter";
+  for (pugi::xml_node node = getXml().child(tag); node;
+       node = node.next_sibling(tag)) {
+    std::istringstream patterns (node.attribute("State").as_string());
+    ChangeFilter filter;
+    filter.deadband = node.attribute("Deadband").as_double(0);
+    double max_rate = node.attribute("MaxRate").as_double(0);
+    if (max_rate > 0) filter.minInterval = 1.0 / max_rate;
+    std::string pattern;
+    bool any = false;
+    while (patterns >> pattern) {
+      any = true;
+      m_states.addFilter (pattern, filter);
+      ROS_INFO("Filtering %s: deadband %g, max rate %g Hz", pattern.c_str(),
+               filter.deadband, max_rate);
+    }
+    if (! any) ROS_WARN("%s without a State attribute, ignoring.", tag);
+  }
+}
+
+StateRegistry& CommonAdapter::stateRegistry ()
+{
+  return m_states;
 }
 
 CommonAdapter::CommonAdapter(AdapterExecInterface& execInterface,
                      const pugi::xml_node& configXml)
-  : InterfaceAdapter(execInterface, configXml)
+  : InterfaceAdapter(execInterface, configXml),
+    m_drainWindow (0),
+    m_notifyPending (false),
+    m_notifierRunning (false),
+    m_flusherRunning (false),
+    m_eventsReceived (0),
+    m_notificationsSent (0),
+    m_lookupsPerformed (0)
 {
   debugMsg("CommonAdapter", " created.");
 }
 
+CommonAdapter::~CommonAdapter()
+{
+  stopFlusher();
+  stopNotifier();
+  // Waits for publications under way to this adapter, which the interfaces'
+  // threads may still be making.
+  m_subscriptions.clear();
+  std::lock_guard<std::mutex> lock (AdaptersMutex);
+  Adapters.erase (std::remove (Adapters.begin(), Adapters.end(), this),
+                  Adapters.end());
+}
+
 bool CommonAdapter::initialize()
 {
   g_configuration->defaultRegisterAdapter(this);
@@ -55,24 +448,40 @@ bool CommonAdapter::initialize()
   g_configuration->registerCommandHandler("log_warning", log_warning);
   g_configuration->registerCommandHandler("log_error", log_error);
   g_configuration->registerCommandHandler("log_debug", log_debug);
-  setSubscriber (receiveBool);
-  setSubscriber (receiveString);
-  setSubscriber (receiveDouble);
-  setSubscriber (receiveBoolString);
-  setSubscriber (receiveDoubleVector);
-  g_adapter = this;
+  g_configuration->registerCommandHandler("set_checkpoint", set_checkpoint);
+  g_configuration->registerCommandHandler("set_boot_ok", set_boot_ok);
+  g_configuration->registerCommandHandler("flush_checkpoints",
+                                          flush_checkpoints);
+  registerCheckpointLookups();
+  loadTelemetryFilters();
+  loadNotificationConfig();
+  loadCheckpointConfig();
+  loadFlightRecorderConfig();
+  if (m_subscriptions.empty()) {
+    subscribeTelemetry();
+    std::lock_guard<std::mutex> lock (AdaptersMutex);
+    Adapters.push_back (this);
+  }
   debugMsg("CommonAdapter", " initialized.");
   return true;
 }
 
 bool CommonAdapter::start()
 {
+  startNotifier();
+  startFlusher();
   debugMsg("CommonAdapter", " started.");
   return true;
 }
 
 bool CommonAdapter::stop()
 {
+  stopFlusher();
+  stopNotifier();
+  ROS_INFO("Commands: %zu issued, %zu still in execution, at most %zu at once.",
+           g_commandRegistry.totalCount(), g_commandRegistry.liveCount(),
+           g_commandRegistry.peakCount());
+  g_commandLatency.log();
   debugMsg("CommonAdapter", " stopped.");
   return true;
 }
@@ -85,6 +494,10 @@ bool CommonAdapter::reset()
 
 bool CommonAdapter::shutdown()
 {
+  stopFlusher();
+  stopNotifier();
+  g_checkpoints.close (true);
+  g_flightRecorder.close();
   debugMsg("CommonAdapter", " shut down.");
   return true;
 }
@@ -98,12 +511,112 @@ void CommonAdapter::invokeAbort(Command *cmd)
 void CommonAdapter::subscribe(const State& state)
 {
   debugMsg("CommonAdapter:subscribe", " to state " << state.name());
-  m_subscribedStates.insert(state);
+  StateRegistry::Entry* entry = m_states.intern(state);
+  if (entry) entry->subscribed = true;
+  else debugMsg("CommonAdapter:subscribe",
+                " no value changes are published for " << state);
 }
 
 
 void CommonAdapter::unsubscribe (const State& state)
 {
   debugMsg("CommonAdapter:unsubscribe", " from state " << state.name());
-  m_subscribedStates.erase(state);
+  StateRegistry::Entry* entry = m_states.intern(state);
+  if (entry) entry->subscribed = false;
+}
+
+void CommonAdapter::lookupNow (const State& state, StateCacheEntry& entry)
+{
+  debugMsg("CommonAdapter:lookupNow", " called on " << state.name() << " with "
+           << state.parameters().size() << " arguments");
+
+  m_lookupsPerformed++;
+  auto it = m_lookupHandlers.find (state.name());
+  if (it == m_lookupHandlers.end()) {
+    ROS_ERROR("PLEXIL Adapter: Invalid lookup name: %s", state.name().c_str());
+    entry.update(Unknown);
+    return;
+  }
+  Value value = it->second (state.parameters());
+  if (g_flightRecorder.enabled()) {
+    flight_record (FlightEventType::Lookup, state.name(), 0,
+                   flight_value (value));
+  }
+  entry.update(value);
+}
+
+void CommonAdapter::registerLookup (const std::string& state_name,
+                                    LookupHandler handler)
+{
+  if (! m_lookupHandlers.emplace (state_name, handler).second) {
+    ROS_WARN("Lookup %s registered more than once, ignoring.",
+             state_name.c_str());
+  }
+}
+
+void CommonAdapter::registerStubbedLookup (const std::string& state_name,
+                                           const Value& value)
+{
+  // Stubbed lookups always return the given value.
+  registerLookup (state_name, [value] (const std::vector<Value>&) {
+    return value;
+  });
+}
+
+// The boot parameter of a checkpoint lookup, counting back from the current
+// boot, which is the default.  False if it is given but unknown.
+static bool boot_param (const std::vector<Value>& params, size_t index,
+                        int32_t& boot)
+{
+  boot = 0;
+  return params.size() <= index || params[index].getValue (boot);
+}
+
+void CommonAdapter::registerCheckpointLookups ()
+{
+  // The plans' checkpoint lookups, from g_checkpoints (see
+  // CheckpointJournal.h).
+
+  registerLookup ("DidCrash", [] (const std::vector<Value>&) {
+    return g_checkpoints.didCrash();
+  });
+  registerLookup ("NumberOfUnhandledBoots", [] (const std::vector<Value>&) {
+    return g_checkpoints.unhandledBoots();
+  });
+  registerLookup ("NumberOfTotalBoots", [] (const std::vector<Value>&) {
+    return g_checkpoints.totalBoots();
+  });
+  registerLookup ("IsBootOK", [] (const std::vector<Value>& params) {
+    int32_t boot;
+    return boot_param (params, 0, boot) ? g_checkpoints.isBootOK (boot)
+                                        : Unknown;
+  });
+  registerLookup ("TimeOfBoot", [] (const std::vector<Value>& params) {
+    int32_t boot;
+    return boot_param (params, 0, boot) ? g_checkpoints.bootTime (boot)
+                                        : Unknown;
+  });
+  registerLookup ("CheckpointWhen", [] (const std::vector<Value>& params) {
+    std::string name;
+    return ! params.empty() && params[0].getValue (name) ?
+      g_checkpoints.checkpointWhen (name) : Unknown;
+  });
+
+  using CheckpointLookup =
+    Value (CheckpointJournal::*) (const std::string&, int32_t) const;
+  auto checkpoint_lookup = [] (CheckpointLookup lookup) {
+    return [lookup] (const std::vector<Value>& params) {
+      std::string name;
+      int32_t boot;
+      return ! params.empty() && params[0].getValue (name) &&
+        boot_param (params, 1, boot) ? (g_checkpoints.*lookup) (name, boot)
+                                     : Unknown;
+    };
+  };
+  registerLookup ("CheckpointState",
+                  checkpoint_lookup (&CheckpointJournal::checkpointState));
+  registerLookup ("CheckpointTime",
+                  checkpoint_lookup (&CheckpointJournal::checkpointTime));
+  registerLookup ("CheckpointInfo",
+                  checkpoint_lookup (&CheckpointJournal::checkpointInfo));
 }
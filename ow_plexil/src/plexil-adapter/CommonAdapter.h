@@ -12,15 +12,30 @@
 #include "Command.hh"
 #include "Value.hh"
 
-#include <set>
+#include "StateRegistry.h"
+#include "subscriber.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+// Computes the current value of a state, given the state's parameters.
+using LookupHandler =
+  std::function<PLEXIL::Value (const std::vector<PLEXIL::Value>&)>;
+
 class CommonAdapter : public PLEXIL::InterfaceAdapter
 {
 public:
   CommonAdapter() = delete;  // only a specialized constructor for subclasses
-  virtual ~CommonAdapter() = default;
+  virtual ~CommonAdapter();
   CommonAdapter (const CommonAdapter&) = delete;
   CommonAdapter& operator= (const CommonAdapter&) = delete;
 
@@ -32,13 +47,94 @@ public:
   virtual void invokeAbort(PLEXIL::Command *cmd);
   virtual void subscribe(const PLEXIL::State& state);
   virtual void unsubscribe(const PLEXIL::State& state);
-  void propagateValueChange (const PLEXIL::State&,
-                             const std::vector<PLEXIL::Value>&) const;
+  virtual void lookupNow (const PLEXIL::State&, PLEXIL::StateCacheEntry&);
+
+  // Send a new value of the given state to the exec, if it is subscribed.
+  void propagateValueChange (StateRegistry::Entry&, const PLEXIL::Value&);
+
+  // Signal the exec that a value change has been handed to it.  Signals are
+  // coalesced within a batch (below), so that the exec is woken once for all
+  // the changes of a callback, and, if a drain window is configured, across
+  // threads over the window.
+  void notifyExec ();
+
+  // As above, for a command ack, status or return value, which is signalled
+  // at once, outside any batch or drain window.  Covers the value changes
+  // still waiting for the window.
+  void notifyExecNow ();
+
+  // The states published to the exec.
+  StateRegistry& stateRegistry ();
+
+  // Defer notifying the exec of the value changes propagated by the calling
+  // thread until the matching endBatch, so that the exec is woken once for
+  // all of them.  Batches nest, and are kept separately for each adapter.
+  void beginBatch ();
+  void endBatch ();
+
+  // Notification metrics
+  uint64_t eventsReceived () const;    // calls to notifyExec()
+  uint64_t notificationsSent () const; // calls to notifyOfExternalEvent()
+  uint64_t lookupsPerformed () const;  // calls to lookupNow()
+
+  // The adapters initialized and not yet destroyed, all of which serve the
+  // one exec, in the order they were initialized.  For static functions, such
+  // as command handlers, that need an adapter.
+  static std::vector<CommonAdapter*> adapters ();
 
 protected:
   CommonAdapter (PLEXIL::AdapterExecInterface&, const pugi::xml_node&);
-  bool isStateSubscribed (const PLEXIL::State& state) const;
-  std::set<PLEXIL::State> m_subscribedStates;
+  void loadTelemetryFilters ();
+  void loadNotificationConfig ();
+  void loadCheckpointConfig ();
+  void loadFlightRecorderConfig ();
+  void signalExec ();
+  void sendNotification ();
+  void startNotifier ();
+  void stopNotifier ();
+  void notifierLoop ();
+  void sendValueChange (StateRegistry::Entry&, const PLEXIL::Value&);
+  void holdValueChange (const StateRegistry::Entry&);
+  void startFlusher ();
+  void stopFlusher ();
+  void flusherLoop ();
+
+  // Subscribe this adapter to the telemetry published by the testbed
+  // interface (see subscriber.h), until it is destroyed.
+  void subscribeTelemetry ();
+  void receiveBatchEvent (BatchEvent);
+  std::vector<Subscription> m_subscriptions;
+
+  StateRegistry m_states;
+
+  // Coalescing of exec notifications.  With a zero drain window, the default,
+  // the exec is notified directly.
+  std::chrono::duration<double> m_drainWindow;
+  std::thread m_notifier;
+  std::mutex m_notifyMutex;
+  std::condition_variable m_notifyCondition;
+  bool m_notifyPending;
+  bool m_notifierRunning;
+
+  // Sending of the value changes held back by the telemetry filters, when
+  // their intervals are over.  Runs only if a filter limits the rate.
+  std::thread m_flusher;
+  std::mutex m_flushMutex;
+  std::condition_variable m_flushCondition;
+  StateRegistry::Clock::time_point m_flushDue;
+  bool m_flusherRunning;
+
+  std::atomic<uint64_t> m_eventsReceived;
+  std::atomic<uint64_t> m_notificationsSent;
+  std::atomic<uint64_t> m_lookupsPerformed;
+
+  // Lookups are dispatched by state name from this table, which testbed
+  // adapters fill in from their initialize().
+  void registerLookup (const std::string& state_name, LookupHandler);
+  void registerStubbedLookup (const std::string& state_name,
+                              const PLEXIL::Value&);
+  void registerCheckpointLookups ();
+  std::unordered_map<std::string, LookupHandler> m_lookupHandlers;
 };
 
 #endif
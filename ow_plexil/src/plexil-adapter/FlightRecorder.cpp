@@ -0,0 +1,161 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "FlightRecorder.h"
+#include "CommandLatency.h"
+#include <ros/ros.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+FlightRecorder g_flightRecorder;
+
+// How often the writer moves events from the ring to the file; made up.  At
+// the default buffer size, the ring holds this long a burst at over 1.6
+// million events per second.
+static const auto DrainPeriod = std::chrono::milliseconds (10);
+
+// Serial number of the calling thread.
+static uint32_t thread_serial ()
+{
+  static std::atomic<uint32_t> last {0};
+  static thread_local uint32_t serial = ++last;
+  return serial;
+}
+
+FlightRecorder::~FlightRecorder ()
+{
+  close();
+}
+
+bool FlightRecorder::open (const FlightRecorderConfig& config)
+{
+  if (m_opened.exchange (true)) return false;
+
+  size_t capacity = std::max<size_t> (config.events, 1);
+  size_t ring = 1;
+  while (ring < config.buffer) ring <<= 1;
+
+  std::string previous = config.file + ".prev";
+  ::rename (config.file.c_str(), previous.c_str());
+  m_fd = ::open (config.file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  m_mapSize = sizeof (FlightFileHeader) + capacity * sizeof (FlightEvent);
+  void* map = MAP_FAILED;
+  if (m_fd >= 0 && ftruncate (m_fd, m_mapSize) == 0) {
+    map = mmap (nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  }
+  if (map == MAP_FAILED) {
+    ROS_ERROR ("Cannot make flight recorder file %s: %s", config.file.c_str(),
+               strerror (errno));
+    if (m_fd >= 0) ::close (m_fd);
+    m_fd = -1;
+    return false;
+  }
+
+  m_header = static_cast<FlightFileHeader*>(map);
+  m_events = reinterpret_cast<FlightEvent*>(m_header + 1);
+  std::memset (m_header, 0, sizeof (FlightFileHeader));
+  std::memcpy (m_header->magic, FlightMagic, sizeof (FlightMagic));
+  m_header->version = FlightVersion;
+  m_header->eventSize = sizeof (FlightEvent);
+  m_header->capacity = capacity;
+  m_header->startTime = command_timestamp();
+  m_header->startWallTime = std::chrono::duration_cast<std::chrono::nanoseconds>
+    (std::chrono::system_clock::now().time_since_epoch()).count();
+
+  m_slots.reset (new Slot[ring]);
+  for (size_t i = 0; i < ring; i++) {
+    m_slots[i].sequence.store (i, std::memory_order_relaxed);
+  }
+  m_mask = ring - 1;
+  m_writer = std::thread (&FlightRecorder::writerLoop, this);
+  m_enabled = true;
+  ROS_INFO ("Flight recorder: %s, %zu events.", config.file.c_str(),
+            capacity);
+  return true;
+}
+
+void FlightRecorder::close ()
+{
+  if (! m_enabled.exchange (false)) return;
+
+  // The ring is kept, as recording threads may still be using it.
+  m_stopping = true;
+  if (m_writer.joinable()) m_writer.join();
+  msync (m_header, m_mapSize, MS_SYNC);
+  ROS_INFO ("Flight recorder: %llu events written, %llu dropped.",
+            (unsigned long long) m_header->written,
+            (unsigned long long) m_header->dropped);
+  munmap (m_header, m_mapSize);
+  ::close (m_fd);
+  m_header = nullptr;
+  m_events = nullptr;
+  m_fd = -1;
+}
+
+void FlightRecorder::record (FlightEventType type, const std::string& name,
+                             int id, double value, uint16_t status)
+{
+  // Claim the next position, unless its slot is still to be drained.
+  uint64_t position = m_head.load (std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &m_slots[position & m_mask];
+    uint64_t sequence = slot->sequence.load (std::memory_order_acquire);
+    int64_t lag = static_cast<int64_t>(sequence - position);
+    if (lag == 0) {
+      if (m_head.compare_exchange_weak (position, position + 1,
+                                        std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (lag < 0) {
+      m_dropped.fetch_add (1, std::memory_order_relaxed);
+      return;
+    }
+    else position = m_head.load (std::memory_order_relaxed);
+  }
+
+  FlightEvent& event = slot->event;
+  event.time = command_timestamp();
+  event.thread = thread_serial();
+  event.type = static_cast<uint16_t>(type);
+  event.status = status;
+  event.id = id;
+  event.reserved = 0;
+  event.value = value;
+  size_t length = std::min (name.size(), FlightNameSize - 1);
+  std::memcpy (event.name, name.data(), length);
+  std::memset (event.name + length, 0, FlightNameSize - length);
+  slot->sequence.store (position + 1, std::memory_order_release);
+}
+
+void FlightRecorder::drain ()
+{
+  // Stops at the first slot not yet filled, even if later ones are.
+  uint64_t ring = m_mask + 1;
+  while (true) {
+    Slot& slot = m_slots[m_tail & m_mask];
+    if (slot.sequence.load (std::memory_order_acquire) != m_tail + 1) break;
+    m_events[m_header->written % m_header->capacity] = slot.event;
+    m_header->written++;
+    slot.sequence.store (m_tail + ring, std::memory_order_release);
+    m_tail++;
+  }
+  m_header->dropped = m_dropped.load (std::memory_order_relaxed);
+}
+
+void FlightRecorder::writerLoop ()
+{
+  while (! m_stopping) {
+    std::this_thread::sleep_for (DrainPeriod);
+    drain();
+  }
+  drain();
+}
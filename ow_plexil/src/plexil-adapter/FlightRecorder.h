@@ -0,0 +1,172 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Flight_Recorder_H
+#define Flight_Recorder_H
+
+// A flight recorder of adapter events: lookups, value changes sent to the
+// exec, command dispatch, acknowledgment and return values, and action goals
+// and their outcomes.  Events are fixed-size binary records, stamped with the
+// monotonic clock and the recording thread, which are put in a lock-free ring
+// buffer by the thread that has them and moved to a memory-mapped file by a
+// background thread, so that recording neither formats text nor waits.  When
+// the ring is full, events are dropped and counted.
+//
+// The file keeps the latest events, wrapping around when full.  Being mapped,
+// what was recorded before a crash is kept.  The file of the previous run is
+// renamed with the suffix ".prev".  flight_recorder_decode prints the events
+// of a file, or a summary of them.
+//
+// The file format, simply a header and then the events as below, is read by
+// casting, so is that of the machine that recorded it.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+
+enum class FlightEventType : uint16_t
+{
+  Lookup = 1,         // lookupNow; value is the lookup's, if numeric
+  ValueChange,        // value change sent to the exec; value as for Lookup
+  ExecNotified,       // notifyOfExternalEvent
+  CommandDispatched,  // command record created; id is its CommandId
+  CommandAcked,       // COMMAND_SENT_TO_SYSTEM sent
+  CommandReturned,    // return value sent; value is its first element
+  CommandFinished,    // final ack sent; status is 1 for success
+  ActionGoalSent,     // goal sent to an action server; name is the operation
+  ActionActive,       // action server accepted the goal
+  ActionDone,         // status is the actionlib goal state
+  ActionTimedOut      // goal canceled; value is its operation's timeout
+};
+
+const size_t FlightNameSize = 32;
+
+struct FlightEvent
+{
+  int64_t time;              // monotonic nanoseconds (command_timestamp())
+  uint32_t thread;           // serial number of the recording thread, from 1
+  uint16_t type;             // FlightEventType
+  uint16_t status;           // as per the type, or 0
+  int32_t id;                // command ID, or 0
+  uint32_t reserved;
+  double value;              // as per the type, or NaN
+  char name[FlightNameSize]; // state, command or operation, cut to fit
+};
+
+static_assert (sizeof (FlightEvent) == 64, "FlightEvent should be 64 bytes");
+
+const char FlightMagic[8] = { 'O', 'W', 'F', 'L', 'I', 'G', 'H', 'T' };
+const uint32_t FlightVersion = 1;
+
+// At the start of the file, followed by room for capacity events.  The event
+// with sequence number n is at index n % capacity.
+struct FlightFileHeader
+{
+  char magic[8];             // FlightMagic
+  uint32_t version;          // FlightVersion
+  uint32_t eventSize;        // sizeof (FlightEvent)
+  uint64_t capacity;         // events the file has room for
+  uint64_t written;          // events written in all, the latest kept
+  uint64_t dropped;          // events dropped because the ring was full
+  int64_t startTime;         // monotonic nanoseconds when the file was made
+  int64_t startWallTime;     // the same moment in nanoseconds since the epoch
+  char reserved[8];
+};
+
+static_assert (sizeof (FlightFileHeader) == 64,
+               "FlightFileHeader should be 64 bytes");
+
+// Printable name of an event type.
+inline const char* flight_event_name (uint16_t type)
+{
+  static const char* names[] = {
+    "?", "Lookup", "ValueChange", "ExecNotified", "CommandDispatched",
+    "CommandAcked", "CommandReturned", "CommandFinished", "ActionGoalSent",
+    "ActionActive", "ActionDone", "ActionTimedOut"
+  };
+  return type < sizeof (names) / sizeof (names[0]) ? names[type] : names[0];
+}
+
+// From the adapter's configuration, e.g.
+//   <FlightRecorder File="ow_flight.rec" Events="1048576" Buffer="16384"/>
+struct FlightRecorderConfig
+{
+  std::string file = "ow_flight.rec";
+  size_t events = 1 << 20;   // kept in the file
+  size_t buffer = 1 << 14;   // in the ring, rounded up to a power of two
+};
+
+class FlightRecorder
+{
+ public:
+  FlightRecorder () = default;
+  ~FlightRecorder ();
+  FlightRecorder (const FlightRecorder&) = delete;
+  FlightRecorder& operator= (const FlightRecorder&) = delete;
+
+  // Create the file and start recording.  False, with nothing recorded, if
+  // the file cannot be made.  Only the first call has any effect.
+  bool open (const FlightRecorderConfig&);
+
+  // Stop recording and write out what is in the ring.
+  void close ();
+
+  bool enabled () const { return m_enabled.load (std::memory_order_relaxed); }
+
+  // Record an event; the name is cut to fit.  Safe from any thread.
+  void record (FlightEventType, const std::string& name, int id = 0,
+               double value = std::numeric_limits<double>::quiet_NaN(),
+               uint16_t status = 0);
+
+  uint64_t dropped () const { return m_dropped; }
+
+ private:
+  struct Slot
+  {
+    // The ring position the slot is free for, or one past the position of
+    // the event it holds.
+    std::atomic<uint64_t> sequence;
+    FlightEvent event;
+  };
+
+  void writerLoop ();
+  void drain ();
+
+  std::atomic<bool> m_enabled {false};
+  std::atomic<bool> m_opened {false};
+  std::atomic<bool> m_stopping {false};
+
+  std::unique_ptr<Slot[]> m_slots;
+  uint64_t m_mask = 0;
+  alignas(64) std::atomic<uint64_t> m_head {0};  // next position to claim
+  alignas(64) uint64_t m_tail = 0;               // next to drain, by writer
+  std::atomic<uint64_t> m_dropped {0};
+
+  int m_fd = -1;
+  size_t m_mapSize = 0;
+  FlightFileHeader* m_header = nullptr;
+  FlightEvent* m_events = nullptr;
+  std::thread m_writer;
+};
+
+// The recorder of this process, opened by the first adapter initialized.
+extern FlightRecorder g_flightRecorder;
+
+// Record an event if the recorder is open.
+inline void flight_record (FlightEventType type, const std::string& name,
+                           int id = 0,
+                           double value =
+                             std::numeric_limits<double>::quiet_NaN(),
+                           uint16_t status = 0)
+{
+  if (g_flightRecorder.enabled()) {
+    g_flightRecorder.record (type, name, id, value, status);
+  }
+}
+
+#endif
@@ -7,6 +7,7 @@
 // OW
 #include "OwAdapter.h"
 #include "OwInterface.h"
+#include "CommandBinder.h"
 #include "adapter_support.h"
 #include "subscriber.h"
 
@@ -28,255 +29,16 @@ using namespace PLEXIL;
 #include <string>
 using std::string;
 using std::vector;
-using std::unique_ptr;
+using std::shared_ptr;
 
-
-//////////////////////// PLEXIL Lookup Support //////////////////////////////
-
-static void stubbed_lookup (const string& name, const string& value)
-{
-  // This warning is annoying.  Could parameterize it.
-  //  ROS_WARN("PLEXIL Adapter: Stubbed lookup of %s returning %s",
-  //           name.c_str(), value.c_str());
-}
-
-
-// NOTE: This macro, and the stub it implements, are temporary.
-#define STATE_STUB(name,val)                    \
-  if (state_name == #name) {                    \
-    stubbed_lookup (#name, #val);               \
-    value_out = val;                            \
-  }
-
-static bool lookup (const string& state_name,
-                    const vector<PLEXIL::Value>& args,
-                    PLEXIL::Value& value_out)
-{
-  bool retval = true;
-
-  // Stubbed mission and system parameters.  Many of these will eventually be
-  // obsolete.
-
-  STATE_STUB(TrenchLength, 10)
-  else STATE_STUB(TrenchGroundPosition, -0.155)
-  else STATE_STUB(TrenchWidth, 10)
-  else STATE_STUB(TrenchDepth, 2)
-  else STATE_STUB(TrenchPitch, 0)
-  else STATE_STUB(TrenchYaw, 0)
-  else STATE_STUB(TrenchStartX, 5)
-  else STATE_STUB(TrenchStartY, 10)
-  else STATE_STUB(TrenchStartZ, 0)
-  else STATE_STUB(TrenchDumpX, 0)
-  else STATE_STUB(TrenchDumpY, 0)
-  else STATE_STUB(TrenchDumpZ, 5)
-  else STATE_STUB(TrenchIdentified, true)
-  else STATE_STUB(TrenchTargetTimeout, 60)
-  else STATE_STUB(ExcavationTimeout, 10)
-  else STATE_STUB(ExcavationTimeout, 60)
-  else STATE_STUB(SampleGood, true)
-  else STATE_STUB(CollectAndTransferTimeout, 10)
-
-  else if (state_name == "TiltDegrees") {
-    value_out = OwInterface::instance()->getTilt();
-  }
-  else if (state_name == "PanDegrees") {
-    value_out = OwInterface::instance()->getPanDegrees();
-  }
-  else if (state_name == "PanVelocity") {
-    value_out = OwInterface::instance()->getPanVelocity();
-  }
-  else if (state_name == "TiltVelocity") {
-    value_out = OwInterface::instance()->getTiltVelocity();
-  }
-  else if (state_name == "HardTorqueLimitReached") {
-    string s;
-    args[0].getValue(s);
-    value_out = OwInterface::instance()->hardTorqueLimitReached(s);
-  }
-  else if (state_name == "SoftTorqueLimitReached") {
-    string s;
-    args[0].getValue(s);
-    value_out = OwInterface::instance()->softTorqueLimitReached(s);
-  }
-  else if (state_name == "Running") {
-    string operation;
-    args[0].getValue(operation);
-    value_out = OwInterface::instance()->running (operation);
-  }
-  else if (state_name == "StateOfCharge") {
-    value_out = OwInterface::instance()->getStateOfCharge();
-  }
-  else if (state_name == "RemainingUsefulLife") {
-    value_out = OwInterface::instance()->getRemainingUsefulLife();
-  }
-  else if (state_name == "BatteryTemperature") {
-    value_out = OwInterface::instance()->getBatteryTemperature();
-  }
-  else if (state_name == "GroundFound") {
-    value_out = OwInterface::instance()->groundFound();
-  }
-  else if (state_name == "GroundPosition") {
-    value_out = OwInterface::instance()->groundPosition();
-  }
-  // Faults
-  else if (state_name == "SystemFault") {
-    value_out = OwInterface::instance()->systemFault();
-  }
-  else if (state_name == "AntennaFault") {
-    value_out = OwInterface::instance()->antennaFault();
-  }
-  else if (state_name == "ArmFault") {
-    value_out = OwInterface::instance()->armFault();
-  }
-  else if (state_name == "PowerFault") {
-    value_out = OwInterface::instance()->powerFault();
-  }
-  else retval = false;
-
-  return retval;
-}
-
-static void stow (Command* cmd, AdapterExecInterface* intf)
-{
-  unique_ptr<CommandRecord>& cr = new_command_record(cmd, intf);
-  OwInterface::instance()->stow (CommandId);
-  send_ack_once(*cr);
-
-}
-
-static void unstow (Command* cmd, AdapterExecInterface* intf)
-{
-  unique_ptr<CommandRecord>& cr = new_command_record(cmd, intf);
-  OwInterface::instance()->unstow (CommandId);
-  send_ack_once(*cr);
-}
-
-static void guarded_move (Command* cmd, AdapterExecInterface* intf)
-{
-  double x, y, z, dir_x, dir_y, dir_z, search_distance;
-  const vector<Value>& args = cmd->getArgValues();
-  args[0].getValue(x);
-  args[1].getValue(y);
-  args[2].getValue(z);
-  args[3].getValue(dir_x);
-  args[4].getValue(dir_y);
-  args[5].getValue(dir_z);
-  args[6].getValue(search_distance);
-  unique_ptr<CommandRecord>& cr = new_command_record(cmd, intf);
-  OwInterface::instance()->guardedMove (x, y, z, dir_x, dir_y, dir_z,
-                                        search_distance, CommandId);
-  send_ack_once(*cr);
-}
-
-static void grind (Command* cmd, AdapterExecInterface* intf)
-{
-  double x, y, depth, length, ground_pos;
-  bool parallel;
-  const vector<Value>& args = cmd->getArgValues();
-  args[0].getValue(x);
-  args[1].getValue(y);
-  args[2].getValue(depth);
-  args[3].getValue(length);
-  args[4].getValue(parallel);
-  args[5].getValue(ground_pos);
-  unique_ptr<CommandRecord>& cr = new_command_record(cmd, intf);
-  OwInterface::instance()->grind(x, y, depth, length, parallel, ground_pos,
-                                 CommandId);
-  send_ack_once(*cr);
-}
-
-static void dig_circular (Command* cmd, AdapterExecInterface* intf)
-{
-  double x, y, depth, ground_position;
-  bool parallel;
-  const vector<Value>& args = cmd->getArgValues();
-  args[0].getValue(x);
-  args[1].getValue(y);
-  args[2].getValue(depth);
-  args[3].getValue(ground_position);
-  args[4].getValue(parallel);
-  unique_ptr<CommandRecord>& cr = new_command_record(cmd, intf);
-  OwInterface::instance()->digCircular(x, y, depth, ground_position, parallel,
-                                       CommandId);
-  send_ack_once(*cr);
-}
-
-static void dig_linear (Command* cmd, AdapterExecInterface* intf)
-{
-  double x, y, depth, length, ground_position;
-  const vector<Value>& args = cmd->getArgValues();
-  args[0].getValue(x);
-  args[1].getValue(y);
-  args[2].getValue(depth);
-  args[3].getValue(length);
-  args[4].getValue(ground_position);
-  unique_ptr<CommandRecord>& cr = new_command_record(cmd, intf);
-  OwInterface::instance()->digLinear(x, y, depth, length, ground_position,
-                                     CommandId);
-  send_ack_once(*cr);
-}
-
-static void deliver (Command* cmd, AdapterExecInterface* intf)
-{
-  double x, y, z;
-  const vector<Value>& args = cmd->getArgValues();
-  args[0].getValue(x);
-  args[1].getValue(y);
-  args[2].getValue(z);
-  unique_ptr<CommandRecord>& cr = new_command_record(cmd, intf);
-  OwInterface::instance()->deliver (x, y, z, CommandId);
-  send_ack_once(*cr);
-}
-
-static void tilt_antenna (Command* cmd, AdapterExecInterface* intf)
-{
-  double degrees;
-  const vector<Value>& args = cmd->getArgValues();
-  args[0].getValue (degrees);
-  unique_ptr<CommandRecord>& cr = new_command_record(cmd, intf);
-  OwInterface::instance()->tiltAntenna (degrees, CommandId);
-  send_ack_once(*cr);
-}
-
-static void pan_antenna (Command* cmd, AdapterExecInterface* intf)
-{
-  double degrees;
-  const vector<Value>& args = cmd->getArgValues();
-  args[0].getValue (degrees);
-  unique_ptr<CommandRecord>& cr = new_command_record(cmd, intf);
-  OwInterface::instance()->panAntenna (degrees, CommandId);
-  send_ack_once(*cr);
-}
-
-static void take_picture (Command* cmd, AdapterExecInterface* intf)
+// The interface to the lander a command is for, named by the namespace
+// prefixing the command's name, e.g. lander2/stow; or the default lander.
+static OwInterface* lander_of (Command* cmd)
 {
-  unique_ptr<CommandRecord>& cr = new_command_record(cmd, intf);
-  OwInterface::instance()->takePicture (CommandId);
-  send_ack_once(*cr);
-}
-
-static void identify_sample_location (Command* cmd, AdapterExecInterface* intf)
-{
-  int num_pictures;
-  std::string filter_type;
-  const vector<Value>& args = cmd->getArgValues();
-  args[0].getValue (num_pictures);
-  args[1].getValue (filter_type);
-  std::unique_ptr<CommandRecord>& cr = new_command_record(cmd, intf);
-  std::vector<double> point_vector;
-  // Get our sample point from identifySampleLocation
-  point_vector = OwInterface::instance()->identifySampleLocation (num_pictures,
-                                                                  filter_type,
-                                                                  CommandId);
-  // Checks if we have a valid sized point
-  if(point_vector.size() != 3){
-    // Resizes the array and initializes values to -500 so we know to skip
-    point_vector.resize(1,-500);
-  }
-  // Contstruct a Value type vector for plexil before returning the result
-  Value value_point_vector = Value(point_vector);
-  intf->handleCommandReturn(cmd, value_point_vector);
-  send_ack_once(*cr);
+  const string& name = cmd->getName();
+  size_t slash = name.rfind ('/');
+  if (slash == string::npos) return OwInterface::instance();
+  return OwInterface::instance (name.substr (0, slash));
 }
 
 OwAdapter::OwAdapter(AdapterExecInterface& execInterface,
@@ -289,34 +51,143 @@ OwAdapter::OwAdapter(AdapterExecInterface& execInterface,
 bool OwAdapter::initialize()
 {
   CommonAdapter::initialize();
-  g_configuration->registerCommandHandler("stow", stow);
-  g_configuration->registerCommandHandler("unstow", unstow);
-  g_configuration->registerCommandHandler("grind", grind);
-  g_configuration->registerCommandHandler("guarded_move", guarded_move);
-  g_configuration->registerCommandHandler("dig_circular", dig_circular);
-  g_configuration->registerCommandHandler("dig_linear", dig_linear);
-  g_configuration->registerCommandHandler("deliver", deliver);
-  g_configuration->registerCommandHandler("tilt_antenna", tilt_antenna);
-  g_configuration->registerCommandHandler("pan_antenna", pan_antenna);
-  g_configuration->registerCommandHandler("identify_sample_location",
-                                          identify_sample_location);
-  g_configuration->registerCommandHandler("take_picture", take_picture);
-  OwInterface::instance()->setCommandStatusCallback (command_status_callback);
+
+  // The commands and lookups of each lander but the default are named with
+  // its namespace as prefix, e.g. lander2/stow, lander2/StateOfCharge.
+  for (const string& lander : OwInterface::landers()) {
+    string prefix = lander.empty() ? "" : lander + "/";
+    auto command = [&prefix] (const string& name,
+                              ExecuteCommandHandler handler) {
+      g_configuration->registerCommandHandler(prefix + name, handler);
+    };
+    command("stow", COMMAND_BINDING (lander_of, &OwInterface::stow));
+    command("unstow", COMMAND_BINDING (lander_of, &OwInterface::unstow));
+    command("grind", COMMAND_BINDING (lander_of, &OwInterface::grind));
+    command("guarded_move",
+            COMMAND_BINDING (lander_of, &OwInterface::guardedMove));
+    command("dig_circular",
+            COMMAND_BINDING (lander_of, &OwInterface::digCircular));
+    command("dig_linear", COMMAND_BINDING (lander_of, &OwInterface::digLinear));
+    command("deliver", COMMAND_BINDING (lander_of, &OwInterface::deliver));
+    command("tilt_antenna",
+            COMMAND_BINDING (lander_of, &OwInterface::tiltAntenna));
+    command("pan_antenna",
+            COMMAND_BINDING (lander_of, &OwInterface::panAntenna));
+    // The sample point is returned through command_return_callback when the
+    // identification finishes.
+    command("identify_sample_location",
+            COMMAND_BINDING (lander_of, &OwInterface::identifySampleLocation));
+    command("take_picture",
+            COMMAND_BINDING (lander_of, &OwInterface::takePicture));
+    command("take_panorama",
+            COMMAND_BINDING (lander_of, &OwInterface::takePanorama));
+    OwInterface* ow = OwInterface::instance (lander);
+    registerLookups (prefix, ow);
+    ow->setCommandStatusCallback (command_status_callback);
+    ow->setCommandStageCallback (command_stage_callback);
+    ow->setCommandReturnCallback (command_return_callback);
+    if (! lander.empty()) ROS_INFO("Serving lander %s", lander.c_str());
+  }
   debugMsg("OwAdapter", " initialized.");
   return true;
 }
 
-void OwAdapter::lookupNow (const State& state, StateCacheEntry& entry)
+void OwAdapter::registerLookups (const string& prefix, OwInterface* ow)
 {
-  debugMsg("OwAdapter:lookupNow", " called on " << state.name() << " with "
-           << state.parameters().size() << " arguments");
+  // Stubbed mission and system parameters.  Many of these will eventually be
+  // obsolete.
 
-  Value retval = Unknown;  // the value of the queried state
+  registerStubbedLookup (prefix + "TrenchLength", 10);
+  registerStubbedLookup (prefix + "TrenchGroundPosition", -0.155);
+  registerStubbedLookup (prefix + "TrenchWidth", 10);
+  registerStubbedLookup (prefix + "TrenchDepth", 2);
+  registerStubbedLookup (prefix + "TrenchPitch", 0);
+  registerStubbedLookup (prefix + "TrenchYaw", 0);
+  registerStubbedLookup (prefix + "TrenchStartX", 5);
+  registerStubbedLookup (prefix + "TrenchStartY", 10);
+  registerStubbedLookup (prefix + "TrenchStartZ", 0);
+  registerStubbedLookup (prefix + "TrenchDumpX", 0);
+  registerStubbedLookup (prefix + "TrenchDumpY", 0);
+  registerStubbedLookup (prefix + "TrenchDumpZ", 5);
+  registerStubbedLookup (prefix + "TrenchIdentified", true);
+  registerStubbedLookup (prefix + "TrenchTargetTimeout", 60);
+  registerStubbedLookup (prefix + "ExcavationTimeout", 10);
+  registerStubbedLookup (prefix + "SampleGood", true);
+  registerStubbedLookup (prefix + "CollectAndTransferTimeout", 10);
+
+  registerLookup (prefix + "TiltDegrees", [ow] (const vector<Value>&) {
+    return Value (ow->getTilt());
+  });
+  registerLookup (prefix + "PanDegrees", [ow] (const vector<Value>&) {
+    return Value (ow->getPanDegrees());
+  });
+  registerLookup (prefix + "PanVelocity", [ow] (const vector<Value>&) {
+    return Value (ow->getPanVelocity());
+  });
+  registerLookup (prefix + "TiltVelocity", [ow] (const vector<Value>&) {
+    return Value (ow->getTiltVelocity());
+  });
+  // The joint name is read in place rather than copied.
+  registerLookup (prefix + "HardTorqueLimitReached", [ow] (const vector<Value>& args) {
+    const string* joint = nullptr;
+    if (args.empty() || ! args[0].getValuePointer (joint)) return Unknown;
+    return Value (ow->hardTorqueLimitReached (*joint));
+  });
+  registerLookup (prefix + "SoftTorqueLimitReached", [ow] (const vector<Value>& args) {
+    const string* joint = nullptr;
+    if (args.empty() || ! args[0].getValuePointer (joint)) return Unknown;
+    return Value (ow->softTorqueLimitReached (*joint));
+  });
+  registerLookup (prefix + "Running", [ow] (const vector<Value>& args) {
+    string operation;
+    args[0].getValue(operation);
+    return Value (ow->running (operation));
+  });
+  registerLookup (prefix + "StateOfCharge", [ow] (const vector<Value>&) {
+    return Value (ow->getStateOfCharge());
+  });
+  registerLookup (prefix + "RemainingUsefulLife", [ow] (const vector<Value>&) {
+    return Value (ow->getRemainingUsefulLife());
+  });
+  registerLookup (prefix + "BatteryTemperature", [ow] (const vector<Value>&) {
+    return Value (ow->getBatteryTemperature());
+  });
+  registerLookup (prefix + "ProjectedRemainingUsefulLife",
+                  [ow] (const vector<Value>&) {
+    return Value (ow->getProjectedRemainingUsefulLife());
+  });
+  registerLookup (prefix + "PowerBudgetOK", [ow] (const vector<Value>&) {
+    return Value (ow->powerBudgetOK());
+  });
+  registerLookup (prefix + "JointTelemetryTime", [ow] (const vector<Value>&) {
+    return Value (ow->jointTelemetryTime());
+  });
+  registerLookup (prefix + "PowerTelemetryTime", [ow] (const vector<Value>&) {
+    return Value (ow->powerTelemetryTime());
+  });
+  registerLookup (prefix + "PanoramaFramesTaken", [ow] (const vector<Value>&) {
+    return Value (ow->panoramaFramesTaken());
+  });
+  registerLookup (prefix + "GroundFound", [ow] (const vector<Value>&) {
+    return Value (ow->groundFound());
+  });
+  registerLookup (prefix + "GroundPosition", [ow] (const vector<Value>&) {
+    return Value (ow->groundPosition());
+  });
 
-  if (! lookup(state.name(), state.parameters(), retval)) {
-    ROS_ERROR("PLEXIL Adapter: Invalid lookup name: %s", state.name().c_str());
-  }
-  entry.update(retval);
+  // Faults
+  registerLookup (prefix + "SystemFault", [ow] (const vector<Value>&) {
+    return Value (ow->systemFault());
+  });
+  registerLookup (prefix + "AntennaFault", [ow] (const vector<Value>&) {
+    return Value (ow->antennaFault());
+  });
+  registerLookup (prefix + "ArmFault", [ow] (const vector<Value>&) {
+    return Value (ow->armFault());
+  });
+  registerLookup (prefix + "PowerFault", [ow] (const vector<Value>&) {
+    return Value (ow->powerFault());
+  });
 }
 
 extern "C" {
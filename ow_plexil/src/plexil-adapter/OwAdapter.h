@@ -8,6 +8,9 @@
 // PLEXIL Interface adapter for OceanWATERS.
 
 #include "CommonAdapter.h"
+#include <string>
+
+class OwInterface;
 
 class OwAdapter : public CommonAdapter
 {
@@ -19,7 +22,10 @@ public:
   OwAdapter& operator= (const OwAdapter&) = delete;
 
   virtual bool initialize();
-  virtual void lookupNow (const PLEXIL::State&, PLEXIL::StateCacheEntry&);
+
+private:
+  // Register the lookups of the given lander, named with the given prefix.
+  void registerLookups (const std::string& prefix, OwInterface*);
 };
 
 extern "C" {
@@ -9,13 +9,17 @@
 
 // OW
 #include "OwExecutive.h"
+#include "PlanCache.h"
+#include "node_support.h"
 
 // PLEXIL
+#include "AdapterConfiguration.hh"
 #include "AdapterFactory.hh"
 #include "AdapterExecInterface.hh"
 #include "Debug.hh"
 #include "Error.hh"
 #include "ExecApplication.hh"
+#include "ExecListener.hh"
 #include "InterfaceSchema.hh"
 #include "parsePlan.hh"
 #include "State.hh"
@@ -24,7 +28,9 @@ using PLEXIL::InterfaceSchema;
 
 // C++
 #include <stdlib.h>
+#include <atomic>
 #include <fstream>
+#include <mutex>
 #include <string>
 #include <iostream>
 using std::string;
@@ -36,6 +42,27 @@ static string PlexilDir = "";
 // The embedded PLEXIL application
 static PLEXIL::ExecApplication* PlexilApp = NULL;
 
+// Parsed plans, sized by the private ROS parameter ~plan_cache_size.
+const int DefaultPlanCacheSize = 16;
+static PlanCache Plans (DefaultPlanCacheSize);
+
+// Exec step notification, see setStepCallback().
+static std::atomic<unsigned long> StepCount (0);
+static std::function<void()> StepCallback;
+static std::mutex StepCallbackMutex;
+
+// Listener that reports the completion of each exec step.
+class StepListener : public PLEXIL::ExecListener
+{
+ public:
+  void stepComplete (unsigned int /* cycle */) override
+  {
+    StepCount++;
+    std::lock_guard<std::mutex> lock (StepCallbackMutex);
+    if (StepCallback) StepCallback();
+  }
+};
+
 OwExecutive* OwExecutive::instance ()
 {
   // Very simple singleton
@@ -48,13 +75,25 @@ bool OwExecutive::getPlanState()
 	return PlexilApp->allPlansFinished();
 }
 
+void OwExecutive::setStepCallback (std::function<void()> callback)
+{
+  std::lock_guard<std::mutex> lock (StepCallbackMutex);
+  StepCallback = callback;
+}
+
+unsigned long OwExecutive::stepCount () const
+{
+  return StepCount;
+}
+
 bool OwExecutive::runPlan (const string& filename)
 {
   string plan = (PlexilDir + filename);
 
-  pugi::xml_document* doc = NULL;
+  // The cache retains the document, whatever the outcome.
+  std::shared_ptr<pugi::xml_document> doc;
   try {
-    doc = PLEXIL::loadXmlFile (plan);
+    doc = Plans.get (plan);
   }
   catch (PLEXIL::ParserException const &e) {
     ROS_ERROR("Load of PLEXIL plan %s failed: %s", plan.c_str(), e.what());
@@ -67,7 +106,7 @@ bool OwExecutive::runPlan (const string& filename)
   }
 
   try {
-    PlexilApp->addPlan (doc);
+    PlexilApp->addPlan (doc.get());
   }
   catch (PLEXIL::ParserException const &e) {
     ROS_ERROR("Add of PLEXIL plan %s failed: %s", plan.c_str(), e.what());
@@ -87,7 +126,6 @@ bool OwExecutive::runPlan (const string& filename)
     return false;
   }
 
-  delete doc;
   return true;
 }
 
@@ -162,6 +200,16 @@ bool OwExecutive::initialize (const string& config_file)
 
   PlexilDir = plexil_plan_dir_env+string("/");
 
+  // Plan cache, optionally warmed up with every plan in the directory.
+  ros::NodeHandle private_nh = private_node_handle();
+  int cache_size;
+  private_nh.param ("plan_cache_size", cache_size, DefaultPlanCacheSize);
+  if (cache_size < 0) {
+    ROS_WARN("Invalid ~plan_cache_size %d, not caching plans.", cache_size);
+    cache_size = 0;
+  }
+  Plans.setCapacity (cache_size);
+
   // Throw exceptions, DON'T assert
   Error::doThrowExceptions();
 
@@ -173,6 +221,8 @@ bool OwExecutive::initialize (const string& config_file)
       ROS_ERROR("plexilInitializeInterfaces failed");
       return false;
     }
+    // The exec's listener hub takes ownership.
+    PLEXIL::g_configuration->addExecListener (new StepListener());
     if (!PlexilApp->startInterfaces()) {
       ROS_ERROR("Interface startup failed");
       return false;
@@ -189,5 +239,12 @@ bool OwExecutive::initialize (const string& config_file)
     ROS_ERROR("%s", s.str().c_str());
     return false;
   }
+
+  bool preload;
+  private_nh.param ("preload_plans", preload, false);
+  if (preload) {
+    size_t count = Plans.preload (PlexilDir);
+    ROS_INFO("Preloaded %zu PLEXIL plans from %s", count, PlexilDir.c_str());
+  }
   return true;
 }
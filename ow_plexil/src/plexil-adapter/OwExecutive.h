@@ -10,6 +10,7 @@
 // The implementation embeds a PLEXIL executive and application.  Because only
 // one PLEXIL executive can run in one process, this class is a singleton.
 
+#include <functional>
 #include <string>
 
 class OwExecutive
@@ -25,6 +26,14 @@ class OwExecutive
   bool initialize (const std::string& config_file);
   bool getPlanState(); // returns true if current plan is finished executing
   bool runPlan (const std::string& filename);
+
+  // Call the given function, from the exec thread, after every step of the
+  // exec.  Plans start and finish only in steps, so this lets a caller wait
+  // for plan events instead of polling.  The function must not block.
+  void setStepCallback (std::function<void()> callback);
+
+  // Number of exec steps completed.
+  unsigned long stepCount () const;
 };
 
 #endif
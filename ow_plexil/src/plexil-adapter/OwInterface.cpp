@@ -6,6 +6,9 @@
 #include "OwInterface.h"
 #include "subscriber.h"
 #include "joint_support.h"
+#include "Seqlock.h"
+#include "PowerEstimator.h"
+#include "node_support.h"
 
 // ROS
 #include <std_msgs/Float64.h>
@@ -13,18 +16,24 @@
 #include <std_msgs/Empty.h>
 
 // C++
+#include <bitset>
 #include <set>
 #include <map>
-#include <thread>
+#include <unordered_map>
+#include <algorithm>
 #include <functional>
+#include <mutex>
+#include <atomic>
 using std::set;
 using std::map;
 using std::vector;
-using std::thread;
 using std::ref;
 using std::string;
 using std::shared_ptr;
 using std::make_unique;
+using std::mutex;
+using std::lock_guard;
+using std::atomic;
 
 // C
 #include <cmath>  // for M_PI and fabs
@@ -37,20 +46,12 @@ using namespace ow_lander;
 const double D2R = M_PI / 180.0 ;
 const double R2D = 180.0 / M_PI ;
 
-const double DegreeTolerance = 0.4;    // made up, degees
-const double VelocityTolerance = 0.01; // made up, unitless
-
-static bool within_tolerance (double val1, double val2, double tolerance)
-{
-  return fabs (val1 - val2) <= tolerance;
-}
-
 
 //////////////////// Lander Operation Support ////////////////////////
 
-const double PanTiltTimeout = 15.0; // seconds, made up
-const double PointCloudTimeout = 50.0; // 5 second timeout assuming a rate of 10hz
-const double SampleTimeout = 50.0; // 5 second timeout assuming a rate of 10hz
+const double ImageTimeout = 10.0;     // seconds, made up
+const double PointCloudTimeout = 5.0; // seconds, after the image is received
+const double SampleTimeout = 30.0; // seconds, made up
 
 // Lander operation names.  In general these match those used in PLEXIL and
 // ow_lander.
@@ -66,8 +67,17 @@ const string Op_Stow              = "Stow";
 const string Op_Unstow            = "Unstow";
 const string Op_TakePicture       = "TakePicture";
 const string Op_IdentifySampleLocation = "IdentifySampleLocation";
+const string Op_TakePanorama      = "TakePanorama";
 
 
+// Resources that lander operations need exclusively.  Pan, tilt and imaging
+// each need their own, so they can overlap each other and arm motion, but not a
+// panorama, which needs all three.
+const unsigned ArmResource = 1;
+const unsigned PanResource = 2;
+const unsigned TiltResource = 4;
+const unsigned CameraResource = 8;
+
 // 1. Indices into subsequent vector
 //
 enum LanderOps {
@@ -81,372 +91,917 @@ enum LanderOps {
   Stow,
   Unstow,
   TakePicture,
-  IdentifySampleLocation
+  IdentifySampleLocation,
+  TakePanorama
 };
 
-static vector<string> LanderOpNames = {
-  Op_GuardedMove, Op_DigCircular, Op_DigLinear, Op_Deliver,
-  Op_PanAntenna, Op_TiltAntenna, Op_Grind, Op_Stow, Op_Unstow, Op_TakePicture,
-  Op_IdentifySampleLocation
+// 2. Operation names and the resources they need, in order of LanderOps.
+//
+static vector<std::pair<string, unsigned>> LanderOpTable = {
+  {Op_GuardedMove, ArmResource},
+  {Op_DigCircular, ArmResource},
+  {Op_DigLinear, ArmResource},
+  {Op_Deliver, ArmResource},
+  {Op_PanAntenna, PanResource},
+  {Op_TiltAntenna, TiltResource},
+  {Op_Grind, ArmResource},
+  {Op_Stow, ArmResource},
+  {Op_Unstow, ArmResource},
+  {Op_TakePicture, CameraResource},
+  {Op_IdentifySampleLocation, 0},
+  {Op_TakePanorama, PanResource | TiltResource | CameraResource}
 };
 
 
 /////////////////////////// Joint/Torque Support ///////////////////////////////
 
-static set<string> JointsAtHardTorqueLimit { };
-static set<string> JointsAtSoftTorqueLimit { };
-
-static map<string, Joint> JointMap {
-  // ROS JointStates message name -> type
-  { "j_shou_yaw", Joint::shoulder_yaw },
-  { "j_shou_pitch", Joint::shoulder_pitch },
-  { "j_prox_pitch", Joint::proximal_pitch },
-  { "j_dist_pitch", Joint::distal_pitch },
-  { "j_hand_yaw", Joint::hand_yaw },
-  { "j_scoop_yaw", Joint::scoop_yaw },
-  { "j_ant_pan", Joint::antenna_pan },
-  { "j_ant_tilt", Joint::antenna_tilt },
-  { "j_grinder", Joint::grinder }
+// Indexed by Joint, so must be in the order of its enumerators.
+static const JointProperties JointProps[NumJoints] {
+  // NOTE: Torque limits are made up, and are only defaults for the
+  // ~torque_limits parameters (see load_torque_limits).  Assuming that only
+  // magnitude matters.
+
+  { "j_shou_yaw", "ShoulderYaw", 60, 80 },
+  { "j_shou_pitch", "ShoulderPitch", 60, 80 },
+  { "j_prox_pitch", "ProximalPitch", 60, 80 },
+  { "j_dist_pitch", "DistalPitch", 60, 80 },
+  { "j_hand_yaw", "HandYaw", 60, 80 },
+  { "j_scoop_yaw", "ScoopYaw", 60, 80 },
+  { "j_ant_pan", "AntennaPan", 30, 30 },
+  { "j_ant_tilt", "AntennaTilt", 30, 30 },
+  { "j_grinder", "Grinder", 30, 30 }
 };
 
-static map<Joint, JointProperties> JointPropMap {
-  // NOTE: Torque limits are made up, and there may be a better place for these
-  // later.  Assuming that only magnitude matters.
-
-  { Joint::shoulder_yaw,   { "j_shou_yaw", "ShoulderYaw", 60, 80 }},
-  { Joint::shoulder_pitch, { "j_shou_pitch", "ShoulderPitch", 60, 80 }},
-  { Joint::proximal_pitch, { "j_prox_pitch", "ProximalPitch", 60, 80 }},
-  { Joint::distal_pitch,   { "j_dist_pitch", "DistalPitch", 60, 80 }},
-  { Joint::hand_yaw,       { "j_hand_yaw", "HandYaw", 60, 80 }},
-  { Joint::scoop_yaw,      { "j_scoop_yaw", "ScoopYaw", 60, 80 }},
-  { Joint::antenna_pan,    { "j_ant_pan", "AntennaPan", 30, 30 }},
-  { Joint::antenna_tilt,   { "j_ant_tilt", "AntennaTilt", 30, 30 }},
-  { Joint::grinder,        { "j_grinder", "Grinder", 30, 30 }}
+// Published state names of each joint's telemetry, computed once.  Indexed by
+// Joint.
+// The states published for each joint.
+struct JointStates
+{
+  StateHandle position, velocity, effort;
+  StateHandle hardTorque, softTorque;  // limits reached
 };
 
-static map<Joint, JointTelemetry> JointTelemetryMap { };
+// The states published by the interface, in its lander's namespace.
+struct PublishedStates
+{
+  JointStates joints[NumJoints];  // indexed by Joint
+  StateHandle panDegrees, tiltDegrees, panoramaFramesTaken;
+  StateHandle stateOfCharge, remainingUsefulLife, batteryTemperature;
+  StateHandle projectedRemainingUsefulLife, powerBudgetOK;
+  StateHandle groundFound, groundPosition;
+  StateHandle systemFault, armFault, powerFault, antennaFault;
+};
 
-static void handle_overtorque (Joint joint, double effort)
+// The telemetry of every joint as of one /joint_states message, stamped with
+// the message's time in seconds, and the joints (by Joint index) at their
+// torque limits.  A joint at its hard limit is not also at its soft limit.
+struct JointSnapshot
 {
-  // For now, torque is just effort (Newton-meter), and overtorque is specific
-  // to the joint.
+  JointTelemetry joints[NumJoints];  // indexed by Joint
+  std::bitset<NumJoints> hardTorque, softTorque;
+  double stamp = 0;
+};
 
-  string joint_name = JointPropMap[joint].plexilName;
+// Joints by PLEXIL name, for the torque limit lookups.
+static const std::unordered_map<string, size_t> JointsByPlexilName = [] {
+  std::unordered_map<string, size_t> joints;
+  for (size_t j = 0; j < NumJoints; j++) joints[JointProps[j].plexilName] = j;
+  return joints;
+}();
+
+// Torque limits in effect, by Joint.  A limit is reached when the magnitude of
+// the joint's effort reaches it, and is released only when the effort falls
+// below it by the hysteresis fraction, so that noise about a limit does not
+// produce a stream of events.  Set by load_torque_limits before the telemetry
+// subscribers start.
+struct TorqueLimits
+{
+  double soft, hard;
+};
 
-  if (fabs(effort) >= JointPropMap[joint].hardTorqueLimit) {
-    JointsAtHardTorqueLimit.insert (joint_name);
-  }
-  else if (fabs(effort) >= JointPropMap[joint].softTorqueLimit) {
-    JointsAtSoftTorqueLimit.insert(joint_name);
-  }
-  else {
-    JointsAtHardTorqueLimit.erase (joint_name);
-    JointsAtSoftTorqueLimit.erase (joint_name);
+// The latest power telemetry, stamped with the time (seconds) of the last
+// message received.  Snapshots are published as for joint telemetry; the
+// power callbacks share the telemetry callback thread.
+struct PowerSnapshot
+{
+  double stateOfCharge = NAN;
+  double remainingUsefulLife = NAN;
+  double batteryTemperature = NAN;
+  double projectedRemainingUsefulLife = NAN;  // see PowerEstimator
+  double stamp = 0;
+};
+
+// The telemetry state of one lander.
+struct OwInterface::Telemetry
+{
+  // Written by the telemetry callback, which fills the back buffer from each
+  // message and then publishes it whole; read by the exec's lookups.  The
+  // back buffer carries over joints that a message omits.
+  Seqlock<JointSnapshot> jointSnapshots;
+  JointSnapshot jointBackBuffer;
+
+  // Indexed by Joint.
+  TorqueLimits torqueLimits[NumJoints];
+  double torqueHysteresis = 0.05;
+
+  // The joint at each position of the /joint_states message, or NumJoints
+  // for an unsupported one.  Built from the first message, and rebuilt only
+  // if the message's joint names change.  Used only by the telemetry callback
+  // thread.
+  vector<string> jointStatesLayout;
+  vector<size_t> jointStatesIndex;
+
+  Seqlock<PowerSnapshot> powerSnapshots;
+  PowerSnapshot powerBackBuffer;
+
+  // Fed by the power callbacks.  The operations held back while the power
+  // budget is exceeded, by LanderOps, are set by load_power_budget before the
+  // subscribers start; the budget's state is read by the exec.
+  PowerEstimator powerEstimator;
+  vector<bool> powerLimited;
+  atomic<bool> powerBudgetOK { true };
+
+  // TODO: encapsulate GroundFound and GroundPosition in the PLEXIL command.
+  // They are not accurate outside the context of a single GuardedMove
+  // command, and can be possibly misused given the current plan interface.
+  atomic<bool> groundFound { false };
+  atomic<double> groundPosition { 0 }; // should not be queried unless found
+
+  // Resolved by the constructor.
+  PublishedStates states;
+};
+
+static void load_torque_limits (OwInterface::Telemetry& telemetry)
+{
+  // Per joint, e.g. ~torque_limits/HandYaw/soft, ~torque_limits/HandYaw/hard.
+  // The limits are the same for every lander.
+  ros::NodeHandle nh = private_node_handle();
+  nh.param ("torque_hysteresis", telemetry.torqueHysteresis, 0.05);
+  for (size_t j = 0; j < NumJoints; j++) {
+    const JointProperties& props = JointProps[j];
+    string prefix = "torque_limits/" + props.plexilName + "/";
+    TorqueLimits& limits = telemetry.torqueLimits[j];
+    nh.param (prefix + "soft", limits.soft, props.softTorqueLimit);
+    nh.param (prefix + "hard", limits.hard, props.hardTorqueLimit);
+    if (limits.soft > limits.hard) {
+      ROS_WARN ("Soft torque limit of %s exceeds its hard limit, using %f",
+                props.plexilName.c_str(), limits.hard);
+      limits.soft = limits.hard;
+    }
   }
 }
 
-static void handle_joint_fault (Joint joint, int joint_index,
-                                const sensor_msgs::JointState::ConstPtr& msg)
+static void map_joint_states (OwInterface::Telemetry& telemetry,
+                              const vector<string>& ros_names)
 {
-  // NOTE: For now, the only fault is overtorque.
-  handle_overtorque (joint, msg->effort[joint_index]);
-}
-
-template <typename T1, typename T2>
-void OwInterface::updateFaultStatus (T1 msg_val, T2& fmap,
-                                     const string& component,
-                                     const string& state_name)
-{
-  for (auto const& entry : fmap) {
-    string key = entry.first;
-    T1 value = entry.second.first;
-    bool fault_active = entry.second.second;
-    bool faulty = (msg_val & value) == value;
-    if (!fault_active && faulty) {
-      ROS_WARN ("Fault in %s: %s", component.c_str(), key.c_str());
-      fmap[key].second = true;
-      publish (state_name, true);
+  vector<size_t>& index = telemetry.jointStatesIndex;
+  telemetry.jointStatesLayout = ros_names;
+  index.assign (ros_names.size(), NumJoints);
+  for (size_t i = 0; i < ros_names.size(); i++) {
+    for (size_t j = 0; j < NumJoints; j++) {
+      if (JointProps[j].rosName == ros_names[i]) index[i] = j;
     }
-    else if (fault_active && !faulty) {
-      ROS_WARN ("Resolved fault in %s: %s", component.c_str(), key.c_str());
-      fmap[key].second = false;
-      publish (state_name, false);
+    if (index[i] == NumJoints) {
+      ROS_ERROR("jointStatesCallback: unsupported joint %s",
+                ros_names[i].c_str());
     }
   }
 }
 
+void OwInterface::handleOvertorque (Joint joint, double effort)
+{
+  // For now, torque is just effort (Newton-meter), and overtorque is specific
+  // to the joint.  Updates the back buffer of the joint snapshot, and
+  // publishes only the limits whose state changed.
+
+  size_t j = joint_index (joint);
+  JointSnapshot& snapshot = m_telemetry->jointBackBuffer;
+  const TorqueLimits& limits = m_telemetry->torqueLimits[j];
+  double torque = fabs (effort);
+  double release = 1 - m_telemetry->torqueHysteresis;
+
+  bool was_hard = snapshot.hardTorque[j];
+  bool was_soft = snapshot.softTorque[j];
+  bool hard = torque >= (was_hard ? limits.hard * release : limits.hard);
+  bool soft = ! hard &&
+    torque >= (was_soft || was_hard ? limits.soft * release : limits.soft);
+  snapshot.hardTorque[j] = hard;
+  snapshot.softTorque[j] = soft;
+
+  const JointStates& states = m_telemetry->states.joints[j];
+  if (hard != was_hard) publish (states.hardTorque, hard);
+  if (soft != was_soft) publish (states.softTorque, soft);
+}
+
+void OwInterface::handleJointFault (Joint joint, int joint_index,
+                                    const sensor_msgs::JointState::ConstPtr& msg)
+{
+  // NOTE: For now, the only fault is overtorque.
+  handleOvertorque (joint, msg->effort[joint_index]);
+}
+
+void OwInterface::updateFaultStatus (uint64_t msg_value, FaultTracker& faults,
+                                     const StateHandle& state)
+{
+  // Publish only when the component's aggregate status changes, not once per
+  // fault that changed.
+  if (faults.update (msg_value)) publish (state, faults.active());
+}
+
 void OwInterface::systemFaultMessageCallback
 (const  ow_faults_detection::SystemFaults::ConstPtr& msg)
 {
-  updateFaultStatus (msg->value, m_systemErrors, "SYSTEM", "SystemFault");
+  updateFaultStatus (msg->value, m_systemErrors,
+                     m_telemetry->states.systemFault);
 }
 
 void OwInterface::armFaultCallback(const ow_faults_detection::ArmFaults::ConstPtr& msg)
 {
-  updateFaultStatus (msg->value, m_armErrors, "ARM", "ArmFault");
+  updateFaultStatus (msg->value, m_armErrors, m_telemetry->states.armFault);
 }
 
 void OwInterface::powerFaultCallback (const ow_faults_detection::PowerFaults::ConstPtr& msg)
 {
-  updateFaultStatus (msg->value, m_powerErrors, "POWER", "PowerFault");
+  updateFaultStatus (msg->value, m_powerErrors,
+                     m_telemetry->states.powerFault);
 }
 
 void OwInterface::antennaFaultCallback(const ow_faults_detection::PTFaults::ConstPtr& msg)
 {
-  updateFaultStatus (msg->value, m_panTiltErrors, "ANTENNA", "AntennaFault");
+  updateFaultStatus (msg->value, m_panTiltErrors,
+                     m_telemetry->states.antennaFault);
 }
 
 void OwInterface::jointStatesCallback
 (const sensor_msgs::JointState::ConstPtr& msg)
 {
   // Publish all joint information for visibility to PLEXIL and handle any
-  // joint-related faults.
+  // joint-related faults.  The exec is notified once for the whole message.
+
+  PublishBatch batch;
 
-  for (int i = 0; i < JointMap.size(); i++) {
-    string ros_name = msg->name[i];
-    if (JointMap.find (ros_name) != JointMap.end()) {
-      Joint joint = JointMap[ros_name];
+  Telemetry& telemetry = *m_telemetry;
+  const PublishedStates& states = telemetry.states;
+  if (msg->name != telemetry.jointStatesLayout) {
+    map_joint_states (telemetry, msg->name);
+  }
+
+  size_t count = std::min ({ msg->name.size(), msg->position.size(),
+                             msg->velocity.size(), msg->effort.size() });
+  for (size_t i = 0; i < count; i++) {
+    size_t index = telemetry.jointStatesIndex[i];
+    if (index != NumJoints) {
+      Joint joint = static_cast<Joint>(index);
       double position = msg->position[i];
       double velocity = msg->velocity[i];
       double effort = msg->effort[i];
       if (joint == Joint::antenna_pan) {
-        m_currentPan = position * R2D;
-        managePanTilt (Op_PanAntenna, m_currentPan, m_goalPan, m_panStart);
-        publish ("PanDegrees", m_currentPan);
-     }
+        double current = position * R2D;
+        {
+          lock_guard<mutex> lock (m_antennaMutex);
+          m_currentPan = current;
+        }
+        m_panTracker.update (current, velocity * R2D, msg->header.stamp);
+        publish (states.panDegrees, current);
+      }
       else if (joint == Joint::antenna_tilt) {
-        m_currentTilt = position * R2D;
-        managePanTilt (Op_TiltAntenna, m_currentTilt, m_goalTilt, m_tiltStart);
-        publish ("TiltDegrees", m_currentTilt);
+        double current = position * R2D;
+        {
+          lock_guard<mutex> lock (m_antennaMutex);
+          m_currentTilt = current;
+        }
+        m_tiltTracker.update (current, velocity * R2D, msg->header.stamp);
+        publish (states.tiltDegrees, current);
       }
-      JointTelemetryMap[joint] = JointTelemetry (position, velocity, effort);
-      string plexil_name = JointPropMap[joint].plexilName;
-      publish (plexil_name + "Position", position);
-      publish (plexil_name + "Velocity", velocity);
-      publish (plexil_name + "Effort", effort);
-      handle_joint_fault (joint, i, msg);
+      telemetry.jointBackBuffer.joints[index] =
+        JointTelemetry (position, velocity, effort);
+      const JointStates& joint_states = states.joints[index];
+      publish (joint_states.position, position);
+      publish (joint_states.velocity, velocity);
+      publish (joint_states.effort, effort);
+      handleJointFault (joint, i, msg);
     }
-    else ROS_ERROR("jointStatesCallback: unsupported joint %s",
-                   ros_name.c_str());
   }
+  telemetry.jointBackBuffer.stamp = msg->header.stamp.toSec();
+  telemetry.jointSnapshots.store (telemetry.jointBackBuffer);
 }
 
-void OwInterface::managePanTilt (const string& opname,
-                                 double current, double goal,
-                                 const ros::Time& start)
-{
-  // We are only concerned when there is a pan/tilt in progress.
-  if (! operationRunning (opname)) return;
+///////////////////////// Antenna/Camera Support ///////////////////////////////
 
-  int id = m_runningOperations.at (opname);
+static bool taken_after (const ros::Time& stamp, const ros::Time& trigger)
+{
+  // Unstamped data is accepted.
+  return stamp.isZero() || stamp >= trigger;
+}
 
-  //if position is over 360 we want to bring it back within the
-  //-360 to 360 range to check if goal position has been reached.
-  if(fabs(current) > 360){
-    if(current < 0){
-      current = fmod(fabs(current),360.0)*-1;
+void OwInterface::cameraCallback (const sensor_msgs::Image::ConstPtr& msg)
+{
+  // NOTE: the received image is ignored for now.  We wait for the pointcloud
+  // as well before marking the picture as finished, but the camera is free to
+  // move once the image is in.
+  int finished_id = IDLE_ID;
+  int captured_id = IDLE_ID;
+  ros::Timer replaced;
+  {
+    lock_guard<mutex> lock (m_pictureMutex);
+    if (m_pictureId == IDLE_ID || m_imageReceived ||
+        ! taken_after (msg->header.stamp, m_pictureTriggerTime)) {
+      return;
     }
-    else{
-      current = fmod(fabs(current), 360.0);
+    m_imageReceived = true;
+    if (m_pointCloudReceived) finished_id = releasePicture (replaced);
+    else {
+      armPictureTimeout (PointCloudTimeout, replaced);
+      captured_id = m_pictureId;
     }
   }
+  replaced.stop();
+  if (finished_id != IDLE_ID) pictureFinished (finished_id, true);
+  if (captured_id != IDLE_ID) panoramaImageCaptured (captured_id);
+}
 
-  // We can't guarantee which way the antenna will move, so we have to check if
-  // the current angle is equivalent.Ex:-180 degrees == 180 degrees.
-  if(current > 0 && goal < 0){
-    current = current - 360;
+void OwInterface::pointCloudCallback (const sensor_msgs::PointCloud2::ConstPtr& msg)
+{
+  // NOTE: the received pointcloud is ignored for now.
+  int finished_id = IDLE_ID;
+  ros::Timer replaced;
+  {
+    lock_guard<mutex> lock (m_pictureMutex);
+    if (m_pictureId == IDLE_ID || m_pointCloudReceived ||
+        ! taken_after (msg->header.stamp, m_pictureTriggerTime)) {
+      return;
+    }
+    m_pointCloudReceived = true;
+    if (m_imageReceived) finished_id = releasePicture (replaced);
   }
-  else if(current < 0 && goal > 0){
-    current = current + 360;
+  replaced.stop();
+  if (finished_id != IDLE_ID) pictureFinished (finished_id, true);
+}
+
+void OwInterface::armPictureTimeout (double seconds, ros::Timer& replaced)
+{
+  // Call with m_pictureMutex held.  Replaces any pending timeout, handing it
+  // back to be stopped once the mutex is released, since stopping a timer
+  // waits for its callback, which takes the mutex.
+  int id = m_pictureId;
+  const bool oneshot = true;
+  std::swap (replaced, m_pictureTimer);
+  m_pictureTimer = m_imagingCallbacks->nodeHandle().createTimer
+    (ros::Duration (seconds),
+     [this, id] (const ros::TimerEvent&) { pictureTimeout (id); },
+     oneshot);
+}
+
+void OwInterface::pictureTimeout (int id)
+{
+  bool got_image;
+  ros::Timer timer;  // this one, which needs no stopping
+  {
+    lock_guard<mutex> lock (m_pictureMutex);
+    if (m_pictureId != id) return;  // finished in the meantime
+    got_image = m_imageReceived;
+    releasePicture (timer);
   }
+  // An image without its pointcloud still counts as a picture.
+  if (got_image) {
+    ROS_ERROR("Timeout Exceeded: Recieved an Image but no PointCloud2.");
+  }
+  else ROS_ERROR("Timeout Exceeded: no Image received.");
+  pictureFinished (id, got_image);
+}
 
-  // Antenna states of interest,
-  bool reached = within_tolerance (current, goal, DegreeTolerance);
-  bool expired = ros::Time::now() > start + ros::Duration (PanTiltTimeout);
+int OwInterface::releasePicture (ros::Timer& timer)
+{
+  // Call with m_pictureMutex held.  Returns the ID of the finished picture,
+  // and hands back its timeout to be stopped as for armPictureTimeout.
+  int id = m_pictureId;
+  m_pictureId = IDLE_ID;
+  std::swap (timer, m_pictureTimer);
+  return id;
+}
 
-  if (reached || expired) {
-    markOperationFinished (opname, id);
-    if (expired) ROS_ERROR("%s timed out", opname.c_str());
-    if (! reached) {
-      ROS_ERROR("%s failed. Ended at %f degrees, goal was %f.",
-                opname.c_str(), current, goal);
-    }
+void OwInterface::pictureFinished (int id, bool success)
+{
+  if (! panoramaPictureFinished (id, success)) {
+    markOperationFinished (Op_TakePicture, id, success);
+  }
+}
+
+void OwInterface::antennaMoveFinished (const string& opname, int id,
+                                       bool success)
+{
+  if (! panoramaMoveFinished (id, success)) {
+    markOperationFinished (opname, id, success);
   }
 }
 
+void OwInterface::startPan (double degrees, int id)
+{
+  double current;
+  {
+    lock_guard<mutex> lock (m_antennaMutex);
+    current = m_currentPan;
+  }
+  m_panTracker.start (id, degrees, current);
+  antennaOp (Op_PanAntenna, degrees, m_antennaPanPublisher);
+}
 
-///////////////////////// Antenna/Camera Support ///////////////////////////////
-void OwInterface::cameraCallback (const sensor_msgs::Image::ConstPtr& msg)
+void OwInterface::startTilt (double degrees, int id)
+{
+  double current;
+  {
+    lock_guard<mutex> lock (m_antennaMutex);
+    current = m_currentTilt;
+  }
+  m_tiltTracker.start (id, degrees, current);
+  antennaOp (Op_TiltAntenna, degrees, m_antennaTiltPublisher);
+}
+
+void OwInterface::triggerPicture (int id)
+{
+  ros::Timer replaced;
+  {
+    lock_guard<mutex> lock (m_pictureMutex);
+    m_pictureId = id;
+    m_pictureTriggerTime = ros::Time::now();
+    m_imageReceived = false;
+    m_pointCloudReceived = false;
+    armPictureTimeout (ImageTimeout, replaced);
+  }
+  replaced.stop();
+  std_msgs::Empty msg;
+  ROS_INFO ("Capturing stereo image using left image trigger.");
+  m_leftImageTriggerPublisher->publish (msg);
+}
+
+
+///////////////////////// Panorama support /////////////////////////////////////
+
+// Camera field of view and antenna range, in degrees, as in plexil_defs.h.
+const double VerticalFov = 10;    // Easy value for testing.  Should be 15.
+const double HorizontalFov = 10;  // Easy value for testing.  Should be 21.
+const double PanMin = 0;
+const double PanMax = 359;
+const double TiltMin = -45;
+const double TiltMax = 45;
+
+// The frames of a panorama, in the order the TakePanorama plan takes them:
+// rows of increasing tilt, each panned across the range in alternating
+// directions, with the last row and column capped at the upper limits.
+static vector<OwInterface::PanoramaFrame> panorama_frames
+(double tilt_lo, double tilt_hi, double pan_lo, double pan_hi,
+ double tilt_increment, double pan_increment)
+{
+  vector<OwInterface::PanoramaFrame> frames;
+  double pan = pan_lo;
+  bool reverse = false;
+
+  auto pass = [&] (double tilt) {
+    frames.push_back ({ tilt, pan });
+    if (reverse) {
+      while (pan - pan_increment > pan_lo) {
+        pan -= pan_increment;
+        frames.push_back ({ tilt, pan });
+      }
+      if (pan > pan_lo) frames.push_back ({ tilt, pan = pan_lo });
+    }
+    else {
+      while (pan + pan_increment < pan_hi) {
+        pan += pan_increment;
+        frames.push_back ({ tilt, pan });
+      }
+      if (pan < pan_hi) frames.push_back ({ tilt, pan = pan_hi });
+    }
+    reverse = ! reverse;
+  };
+
+  double tilt = tilt_lo;
+  for (; tilt < tilt_hi; tilt += tilt_increment) pass (tilt);
+  pass (tilt_hi);
+  return frames;
+}
+
+void OwInterface::takePanorama (double tilt_lo, double tilt_hi,
+                                double pan_lo, double pan_hi,
+                                double vert_overlap, double horiz_overlap,
+                                int id)
 {
-  // NOTE: the received image is ignored for now.
-  m_pointCloudRecieved = false;
-  if (operationRunning (Op_TakePicture)) {
-    ros::Rate rate(10);
-    int timeout = 0;
-    // We wait for the pointcloud as well or the 5 sec timeout before marking as
-    // finished.
-    while(m_pointCloudRecieved == false && timeout < PointCloudTimeout){
-        ros::spinOnce();
-        rate.sleep();
-        timeout+=1;
+  startOperation (Op_TakePanorama, id, [=] () {
+    string error;
+    if (tilt_lo > tilt_hi || tilt_lo < TiltMin || tilt_hi > TiltMax) {
+      error = "tilt spec outside valid range";
+    }
+    else if (pan_lo > pan_hi || pan_lo < PanMin || pan_hi > PanMax) {
+      error = "pan spec outside valid range";
+    }
+    else if (VerticalFov / 2 <= vert_overlap) {
+      error = "vertical overlap too high";
+    }
+    else if (HorizontalFov / 2 <= horiz_overlap) {
+      error = "horizontal overlap too high";
+    }
+    if (! error.empty()) {
+      ROS_ERROR ("%s: %s.", Op_TakePanorama.c_str(), error.c_str());
+      markOperationFinished (Op_TakePanorama, id, false);
+      return;
     }
-    if(timeout == PointCloudTimeout){
-      ROS_ERROR("Timeout Exceeded: Recieved an Image but no PointCloud2.");
+
+    PanoramaStep step;
+    {
+      lock_guard<mutex> lock (m_panoramaMutex);
+      m_panoramaId = id;
+      m_panoramaFrames = panorama_frames (tilt_lo, tilt_hi, pan_lo, pan_hi,
+                                          VerticalFov / 2 - vert_overlap,
+                                          HorizontalFov / 2 - horiz_overlap);
+      m_panoramaTarget = 0;
+      m_panoramaTriggered = 0;
+      m_panoramaTaken = 0;
+      m_panoramaMoves = 0;
+      m_panoramaShooting = false;
+      m_panoramaCaptured = false;
+      m_panoramaFailed = false;
+      ROS_INFO ("Starting %s: %zu frames", Op_TakePanorama.c_str(),
+                m_panoramaFrames.size());
+
+      // Move both axes to the first frame.
+      const PanoramaFrame& first = m_panoramaFrames.front();
+      step.id = id;
+      step.pan = step.tilt = true;
+      step.panDegrees = first.pan;
+      step.tiltDegrees = first.tilt;
+      m_panoramaMoves = 2;
+    }
+    publish (m_telemetry->states.panoramaFramesTaken, 0.0);
+    runPanoramaStep (step);
+  });
+}
+
+OwInterface::PanoramaStep OwInterface::advancePanorama ()
+{
+  // Call with m_panoramaMutex held.  The antenna moves to the next frame as
+  // soon as the current one is imaged, while its point cloud is still coming;
+  // a picture is triggered once the antenna has arrived and the previous
+  // picture is complete.  The panorama finishes, or fails, only once no move
+  // or picture of it is outstanding.
+  PanoramaStep step;
+  step.id = m_panoramaId;
+  step.taken = m_panoramaTaken;
+  if (m_panoramaMoves > 0) return step;
+
+  size_t count = m_panoramaFrames.size();
+  if (m_panoramaFailed || m_panoramaTriggered == count) {
+    step.finished = ! m_panoramaShooting;
+  }
+  else if (m_panoramaTriggered == m_panoramaTarget) {
+    if (! m_panoramaShooting) {
+      step.shoot = true;
+      m_panoramaTriggered++;
+      m_panoramaShooting = true;
+      m_panoramaCaptured = false;
     }
-    markOperationFinished (Op_TakePicture, m_runningOperations.at (Op_TakePicture));
   }
+  else if (! m_panoramaShooting || m_panoramaCaptured) {
+    const PanoramaFrame& from = m_panoramaFrames[m_panoramaTarget];
+    const PanoramaFrame& to = m_panoramaFrames[++m_panoramaTarget];
+    step.pan = to.pan != from.pan;
+    step.tilt = to.tilt != from.tilt;
+    step.panDegrees = to.pan;
+    step.tiltDegrees = to.tilt;
+    m_panoramaMoves = step.pan + step.tilt;
+    if (m_panoramaMoves == 0) return advancePanorama();
+  }
+
+  if (step.finished) {
+    step.success = ! m_panoramaFailed;
+    m_panoramaId = IDLE_ID;
+  }
+  return step;
 }
 
-void OwInterface::pointCloudCallback (const sensor_msgs::PointCloud2::ConstPtr& msg)
+void OwInterface::runPanoramaStep (const PanoramaStep& step)
 {
-  // NOTE: the received pointcloud is ignored for now.
-  if (operationRunning (Op_TakePicture)) {
-    //mark as recieved
-    m_pointCloudRecieved = true;
+  // Not called with m_panoramaMutex held, since the moves and picture report
+  // back through it.
+  if (step.pan) startPan (step.panDegrees, step.id);
+  if (step.tilt) startTilt (step.tiltDegrees, step.id);
+  if (step.shoot) triggerPicture (step.id);
+  if (step.finished) {
+    ROS_INFO ("%s %s after %zu frames", Op_TakePanorama.c_str(),
+              step.success ? "finished" : "failed", step.taken);
+    markOperationFinished (Op_TakePanorama, step.id, step.success);
+  }
+}
+
+bool OwInterface::panoramaMoveFinished (int id, bool success)
+{
+  PanoramaStep step;
+  {
+    lock_guard<mutex> lock (m_panoramaMutex);
+    if (id == IDLE_ID || id != m_panoramaId) return false;
+    m_panoramaMoves--;
+    if (! success) m_panoramaFailed = true;
+    step = advancePanorama();
+  }
+  runPanoramaStep (step);
+  return true;
+}
+
+bool OwInterface::panoramaPictureFinished (int id, bool success)
+{
+  // Progress is published per frame.
+  PanoramaStep step;
+  {
+    lock_guard<mutex> lock (m_panoramaMutex);
+    if (id == IDLE_ID || id != m_panoramaId) return false;
+    m_panoramaShooting = false;
+    if (success) m_panoramaTaken++;
+    else m_panoramaFailed = true;
+    step = advancePanorama();
   }
+  publish (m_telemetry->states.panoramaFramesTaken,
+           static_cast<double>(step.taken));
+  runPanoramaStep (step);
+  return true;
+}
+
+void OwInterface::panoramaImageCaptured (int id)
+{
+  PanoramaStep step;
+  {
+    lock_guard<mutex> lock (m_panoramaMutex);
+    if (id == IDLE_ID || id != m_panoramaId) return;
+    m_panoramaCaptured = true;
+    step = advancePanorama();
+  }
+  runPanoramaStep (step);
+}
+
+double OwInterface::panoramaFramesTaken () const
+{
+  lock_guard<mutex> lock (m_panoramaMutex);
+  return m_panoramaTaken;
 }
 
 
 ///////////////////////// Power support /////////////////////////////////////
 
-static double StateOfCharge       = NAN;
-static double RemainingUsefulLife = NAN;
-static double BatteryTemperature  = NAN;
+static void load_power_budget (OwInterface::Telemetry& telemetry)
+{
+  // E.g. ~power_budget/min_state_of_charge; see PowerBudgetLimits.  The
+  // budget is the same for every lander.
+  ros::NodeHandle nh = private_node_handle();
+  PowerBudgetLimits limits;
+  int window = limits.window;
+  nh.param ("power_budget/window", window, window);
+  limits.window = std::max (window, 2);
+  nh.param ("power_budget/min_state_of_charge", limits.minStateOfCharge,
+            limits.minStateOfCharge);
+  nh.param ("power_budget/max_temperature", limits.maxTemperature,
+            limits.maxTemperature);
+  nh.param ("power_budget/temperature_horizon", limits.temperatureHorizon,
+            limits.temperatureHorizon);
+  nh.param ("power_budget/min_remaining_life", limits.minRemainingLife,
+            limits.minRemainingLife);
+  nh.param ("power_budget/charge_hysteresis", limits.chargeHysteresis,
+            limits.chargeHysteresis);
+  nh.param ("power_budget/temperature_hysteresis",
+            limits.temperatureHysteresis, limits.temperatureHysteresis);
+  nh.param ("power_budget/life_hysteresis", limits.lifeHysteresis,
+            limits.lifeHysteresis);
+  nh.param ("power_budget/recovery_time", limits.recoveryTime,
+            limits.recoveryTime);
+  telemetry.powerEstimator.setLimits (limits);
+
+  // The energy-heavy operations, which are held back while the budget is
+  // exceeded.
+  vector<string> operations;
+  nh.param ("power_budget/operations", operations,
+            vector<string> { Op_Grind, Op_DigCircular, Op_DigLinear });
+  telemetry.powerLimited.assign (LanderOpTable.size(), false);
+  for (const string& name : operations) {
+    auto it = std::find_if (LanderOpTable.begin(), LanderOpTable.end(),
+                            [&name] (const std::pair<string, unsigned>& op) {
+                              return op.first == name;
+                            });
+    if (it == LanderOpTable.end()) {
+      ROS_WARN ("Ignoring unknown operation %s in ~power_budget/operations",
+                name.c_str());
+      continue;
+    }
+    telemetry.powerLimited[it - LanderOpTable.begin()] = true;
+  }
+}
+
+void OwInterface::updatePowerBudget (double stamp)
+{
+  Telemetry& telemetry = *m_telemetry;
+  double life = telemetry.powerEstimator.projectedRemainingUsefulLife();
+  telemetry.powerBackBuffer.projectedRemainingUsefulLife = life;
+  telemetry.powerBackBuffer.stamp = stamp;
+  telemetry.powerSnapshots.store (telemetry.powerBackBuffer);
+  if (! std::isnan (life)) {
+    publish (telemetry.states.projectedRemainingUsefulLife, life);
+  }
+
+  if (! telemetry.powerEstimator.update (stamp)) return;
+  bool ok = telemetry.powerEstimator.budgetOK();
+  telemetry.powerBudgetOK = ok;
+  publish (telemetry.states.powerBudgetOK, ok);
+  if (ok) {
+    ROS_INFO ("Power budget restored.");
+    admitPendingCommands();
+  }
+  else {
+    ROS_WARN ("Power budget exceeded: %s.  Holding back energy-heavy "
+              "operations.", telemetry.powerEstimator.shortfall());
+  }
+}
 
-static void soc_callback (const std_msgs::Float64::ConstPtr& msg)
+void OwInterface::socCallback (const std_msgs::Float64::ConstPtr& msg)
 {
-  StateOfCharge = msg->data;
-  publish ("StateOfCharge", StateOfCharge);
+  double now = ros::Time::now().toSec();
+  m_telemetry->powerBackBuffer.stateOfCharge = msg->data;
+  m_telemetry->powerEstimator.addStateOfCharge (now, msg->data);
+  updatePowerBudget (now);
+  publish (m_telemetry->states.stateOfCharge, msg->data);
 }
 
-static void rul_callback (const std_msgs::Int16::ConstPtr& msg)
+void OwInterface::rulCallback (const std_msgs::Int16::ConstPtr& msg)
 {
   // NOTE: This is not being called as of 4/12/21.  Jira OW-656 addresses.
-  RemainingUsefulLife = msg->data;
-  publish ("RemainingUsefulLife", RemainingUsefulLife);
+  m_telemetry->powerBackBuffer.remainingUsefulLife = msg->data;
+  m_telemetry->powerEstimator.setRemainingUsefulLife (msg->data);
+  updatePowerBudget (ros::Time::now().toSec());
+  publish (m_telemetry->states.remainingUsefulLife,
+           m_telemetry->powerBackBuffer.remainingUsefulLife);
 }
 
-static void temperature_callback (const std_msgs::Float64::ConstPtr& msg)
+void OwInterface::temperatureCallback (const std_msgs::Float64::ConstPtr& msg)
 {
-  BatteryTemperature = msg->data;
-  publish ("BatteryTemperature", BatteryTemperature);
+  double now = ros::Time::now().toSec();
+  m_telemetry->powerBackBuffer.batteryTemperature = msg->data;
+  m_telemetry->powerEstimator.addTemperature (now, msg->data);
+  updatePowerBudget (now);
+  publish (m_telemetry->states.batteryTemperature, msg->data);
 }
 
+bool OwInterface::operationPermitted (size_t op) const
+{
+  const vector<bool>& limited = m_telemetry->powerLimited;
+  return op >= limited.size() || ! limited[op] || m_telemetry->powerBudgetOK;
+}
 
-//////////////////// GuardedMove Action support ////////////////////////////////
-
-// TODO: encapsulate GroundFound and GroundPosition in the PLEXIL command.  They
-// are not accurate outside the context of a single GuardedMove command.
+bool OwInterface::powerBudgetOK () const
+{
+  return m_telemetry->powerBudgetOK;
+}
 
-// TODO: encapsulate GroundFound and GroundPosition within the GuardedMove
-// operation: it is not meaningful otherwise, and can be possibly misused given
-// the current plan interface.
 
-static bool GroundFound = false;
-static double GroundPosition = 0; // should not be queried unless GroundFound
+//////////////////// GuardedMove Action support ////////////////////////////////
 
 bool OwInterface::groundFound () const
 {
-  return GroundFound;
+  return m_telemetry->groundFound;
 }
 
 double OwInterface::groundPosition () const
 {
-  return GroundPosition;
-}
-
-template <typename T>
-bool OwInterface::faultActive (const T& fmap) const
-{
-  for (auto const& entry : fmap) {
-    if (entry.second.second) return true;
-  }
-  return false;
+  return m_telemetry->groundPosition;
 }
 
 bool OwInterface::systemFault () const
 {
-  return faultActive (m_systemErrors);
+  return m_systemErrors.active();
 }
 
 bool OwInterface::antennaFault () const
 {
-  return faultActive (m_panTiltErrors);
+  return m_panTiltErrors.active();
 }
 
 bool OwInterface::armFault () const
 {
-  return faultActive (m_armErrors);
+  return m_armErrors.active();
 }
 
 bool OwInterface::powerFault () const
 {
-  return faultActive (m_powerErrors);
+  return m_powerErrors.active();
 }
 
-template<typename T>
-static t_action_done_cb<T> guarded_move_done_cb (const string& opname)
+
+/////////////////////////// OwInterface members ////////////////////////////////
+
+OwInterface* OwInterface::instance ()
 {
-  return [&] (const actionlib::SimpleClientGoalState& state,
-              const T& result) {
-    ROS_INFO ("%s finished in state %s", opname.c_str(), state.toString().c_str());
-    GroundFound = result->success;
-    GroundPosition = result->final.z;
-    publish ("GroundFound", GroundFound);
-    publish ("GroundPosition", GroundPosition);
-  };
+  return instance ("");
 }
 
-// Since template is outside the scope of the class we cannot use a member
-// variable and instead have to use a static one like in the
-// guarded_move_done_cb above.
-static vector<double> SamplePoint;
-static bool GotSampleLocation = false;
-template<int OpIndex, typename T>
-static void identify_sample_location_done_cb
-(const actionlib::SimpleClientGoalState& state,
- const T& result)
-{
-  if(result->success == true){
-    SamplePoint.push_back(result->sample_location.x);
-    SamplePoint.push_back(result->sample_location.y);
-    SamplePoint.push_back(result->sample_location.z);
-    ROS_INFO ("Possible sample location identified at (%f, %f, %f)",
-           SamplePoint[0], SamplePoint[1], SamplePoint[2]);
-  }
-  else{
-    ROS_ERROR("Could not get sample point from IdentifySampleLocation");
-  }
-  GotSampleLocation = true;
+OwInterface* OwInterface::instance (const string& lander)
+{
+  static mutex instances_mutex;
+  static map<string, std::unique_ptr<OwInterface>> instances;
+  lock_guard<mutex> lock (instances_mutex);
+  std::unique_ptr<OwInterface>& ow = instances[lander];
+  if (! ow) ow = make_unique<OwInterface> (lander);
+  return ow.get();
 }
 
+vector<string> OwInterface::landers ()
+{
+  vector<string> names;
+  private_node_handle().param ("landers", names, vector<string>());
+  vector<string> landers = { "" };
+  for (string name : names) {
+    // Namespaces are taken as relative to the root.
+    while (! name.empty() && name.front() == '/') name.erase (0, 1);
+    while (! name.empty() && name.back() == '/') name.pop_back();
+    if (name.empty() ||
+        std::find (landers.begin(), landers.end(), name) != landers.end()) {
+      ROS_WARN ("Ignoring lander namespace '%s' in ~landers", name.c_str());
+      continue;
+    }
+    landers.push_back (name);
+  }
+  return landers;
+}
 
-/////////////////////////// OwInterface members ////////////////////////////////
-
-OwInterface* OwInterface::instance ()
+OwInterface::OwInterface (const string& lander)
+  : PlexilInterface (lander),
+    m_telemetry (make_unique<Telemetry>()),
+    m_initialized (false),
+    m_currentPan (0), m_currentTilt (0),
+    m_panTracker (Op_PanAntenna, [this] (int id, bool success) {
+      antennaMoveFinished (Op_PanAntenna, id, success);
+    }),
+    m_tiltTracker (Op_TiltAntenna, [this] (int id, bool success) {
+      antennaMoveFinished (Op_TiltAntenna, id, success);
+    }),
+    m_pictureId (IDLE_ID),
+    m_imageReceived (false), m_pointCloudReceived (false),
+    m_panoramaId (IDLE_ID),
+    m_panoramaTarget (0), m_panoramaTriggered (0), m_panoramaTaken (0),
+    m_panoramaMoves (0),
+    m_panoramaShooting (false), m_panoramaCaptured (false),
+    m_panoramaFailed (false)
 {
-  // Very simple singleton
-  static OwInterface instance;
-  return &instance;
+  PublishedStates& states = m_telemetry->states;
+  for (size_t j = 0; j < NumJoints; j++) {
+    const JointProperties& props = JointProps[j];
+    states.joints[j] = {
+      stateHandle (props.positionState()),
+      stateHandle (props.velocityState()),
+      stateHandle (props.effortState()),
+      stateHandle ("HardTorqueLimitReached", props.plexilName),
+      stateHandle ("SoftTorqueLimitReached", props.plexilName)
+    };
+  }
+  states.panDegrees = stateHandle ("PanDegrees");
+  states.tiltDegrees = stateHandle ("TiltDegrees");
+  states.panoramaFramesTaken = stateHandle ("PanoramaFramesTaken");
+  states.stateOfCharge = stateHandle ("StateOfCharge");
+  states.remainingUsefulLife = stateHandle ("RemainingUsefulLife");
+  states.batteryTemperature = stateHandle ("BatteryTemperature");
+  states.projectedRemainingUsefulLife =
+    stateHandle ("ProjectedRemainingUsefulLife");
+  states.powerBudgetOK = stateHandle ("PowerBudgetOK");
+  states.groundFound = stateHandle ("GroundFound");
+  states.groundPosition = stateHandle ("GroundPosition");
+  states.systemFault = stateHandle ("SystemFault");
+  states.armFault = stateHandle ("ArmFault");
+  states.powerFault = stateHandle ("PowerFault");
+  states.antennaFault = stateHandle ("AntennaFault");
 }
 
-OwInterface::OwInterface ()
-  : m_currentPan (0), m_currentTilt (0),
-    m_goalPan (0), m_goalTilt (0), m_pointCloudRecieved(false)
-    // m_panStart, m_tiltStart are deliberately uninitialized
+OwInterface::~OwInterface ()
 {
+  // Stop the callback threads before the state they use goes away, and drain
+  // pending dispatches while the action clients still exist.
+  stopActionServerConnection();
+  m_imagingCallbacks.reset();
+  m_faultCallbacks.reset();
+  m_telemetryCallbacks.reset();
+  m_actionWorkers.stop();
 }
 
 void OwInterface::initialize()
 {
-  static bool initialized = false;
+  if (not m_initialized) {
+    m_initialized = true;
 
-  if (not initialized) {
-
-    for (auto name : LanderOpNames) {
-      registerLanderOperation (name);
+    for (const auto& op : LanderOpTable) {
+      registerLanderOperation (op.first, op.second);
     }
 
+    startActionWorkers();
+    // Sample identification has a default timeout, since plans wait on its
+    // result.
+    setOperationTimeout (Op_IdentifySampleLocation, SampleTimeout);
+    loadOperationTimeouts();
+    loadOperationQueueLimits();
+    load_torque_limits (*m_telemetry);
+    load_power_budget (*m_telemetry);
+
     m_genericNodeHandle = make_unique<ros::NodeHandle>();
 
     // Initialize publishers.  Queue size is a guess at adequacy.  For now,
@@ -456,103 +1011,102 @@ void OwInterface::initialize()
     const bool latch = true;
     m_antennaTiltPublisher = make_unique<ros::Publisher>
       (m_genericNodeHandle->advertise<std_msgs::Float64>
-       ("/ant_tilt_position_controller/command", qsize, latch));
+       (topic ("/ant_tilt_position_controller/command"), qsize, latch));
     m_antennaPanPublisher = make_unique<ros::Publisher>
       (m_genericNodeHandle->advertise<std_msgs::Float64>
-       ("/ant_pan_position_controller/command", qsize, latch));
+       (topic ("/ant_pan_position_controller/command"), qsize, latch));
     m_leftImageTriggerPublisher = make_unique<ros::Publisher>
       (m_genericNodeHandle->advertise<std_msgs::Empty>
-       ("/StereoCamera/left/image_trigger", qsize, latch));
+       (topic ("/StereoCamera/left/image_trigger"), qsize, latch));
+
+    // Initialize subscribers.  Each group is serviced by one thread, which
+    // keeps its callbacks serialized.
+
+    m_telemetryCallbacks = make_unique<CallbackGroup>("telemetry");
+    m_faultCallbacks = make_unique<CallbackGroup>("fault");
+    m_imagingCallbacks = make_unique<CallbackGroup>("imaging");
+    ros::NodeHandle& telemetry_nh = m_telemetryCallbacks->nodeHandle();
+    ros::NodeHandle& fault_nh = m_faultCallbacks->nodeHandle();
+    ros::NodeHandle& imaging_nh = m_imagingCallbacks->nodeHandle();
+
+    // The antenna move timeouts are serialized with the joint states.
+    m_panTracker.initialize (telemetry_nh);
+    m_tiltTracker.initialize (telemetry_nh);
 
-    // Initialize subscribers
     m_jointStatesSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
-       subscribe("/joint_states", qsize,
+      (telemetry_nh.
+       subscribe(topic ("/joint_states"), qsize,
                  &OwInterface::jointStatesCallback, this));
     m_cameraSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
-       subscribe("/StereoCamera/left/image_raw", qsize,
+      (imaging_nh.
+       subscribe(topic ("/StereoCamera/left/image_raw"), qsize,
                  &OwInterface::cameraCallback, this));
     m_pointCloudSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
-       subscribe("/StereoCamera/points2", qsize,
+      (imaging_nh.
+       subscribe(topic ("/StereoCamera/points2"), qsize,
                  &OwInterface::pointCloudCallback, this));
     m_socSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
-       subscribe("/power_system_node/state_of_charge", qsize, soc_callback));
+      (telemetry_nh.
+       subscribe(topic ("/power_system_node/state_of_charge"), qsize,
+                 &OwInterface::socCallback, this));
     m_batteryTempSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
-       subscribe("/power_system_node/battery_temperature", qsize,
-                 temperature_callback));
+      (telemetry_nh.
+       subscribe(topic ("/power_system_node/battery_temperature"), qsize,
+                 &OwInterface::temperatureCallback, this));
     m_rulSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
-       subscribe("/power_system_node/remaining_useful_life", qsize, rul_callback));
+      (telemetry_nh.
+       subscribe(topic ("/power_system_node/remaining_useful_life"), qsize,
+                 &OwInterface::rulCallback, this));
     // subscribers for fault messages
     m_systemFaultMessagesSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
-       subscribe("/faults/system_faults_status", qsize,
+      (fault_nh.
+       subscribe(topic ("/faults/system_faults_status"), qsize,
                 &OwInterface::systemFaultMessageCallback, this));
     m_armFaultMessagesSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
-       subscribe("/faults/arm_faults_status", qsize,
+      (fault_nh.
+       subscribe(topic ("/faults/arm_faults_status"), qsize,
                 &OwInterface::armFaultCallback, this));
     m_powerFaultMessagesSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
-       subscribe("/faults/power_faults_status", qsize,
+      (fault_nh.
+       subscribe(topic ("/faults/power_faults_status"), qsize,
                 &OwInterface::powerFaultCallback, this));
     m_ptFaultMessagesSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
-       subscribe("/faults/pt_faults_status", qsize,
+      (fault_nh.
+       subscribe(topic ("/faults/pt_faults_status"), qsize,
                 &OwInterface::antennaFaultCallback, this));
 
+    m_telemetryCallbacks->start();
+    m_faultCallbacks->start();
+    m_imagingCallbacks->start();
+
     m_guardedMoveClient =
-      make_unique<GuardedMoveActionClient>(Op_GuardedMove, true);
-    m_unstowClient = make_unique<UnstowActionClient>(Op_Unstow, true);
-    m_stowClient = make_unique<StowActionClient>(Op_Stow, true);
-    m_grindClient = make_unique<GrindActionClient>(Op_Grind, true);
-    m_digCircularClient = make_unique<DigCircularActionClient>(Op_DigCircular, true);
-    m_digLinearClient = make_unique<DigLinearActionClient>(Op_DigLinear, true);
-    m_deliverClient = make_unique<DeliverActionClient>(Op_Deliver, true);
+      make_unique<GuardedMoveActionClient>(topic (Op_GuardedMove), true);
+    m_unstowClient = make_unique<UnstowActionClient>(topic (Op_Unstow), true);
+    m_stowClient = make_unique<StowActionClient>(topic (Op_Stow), true);
+    m_grindClient = make_unique<GrindActionClient>(topic (Op_Grind), true);
+    m_digCircularClient =
+      make_unique<DigCircularActionClient>(topic (Op_DigCircular), true);
+    m_digLinearClient =
+      make_unique<DigLinearActionClient>(topic (Op_DigLinear), true);
+    m_deliverClient = make_unique<DeliverActionClient>(topic (Op_Deliver), true);
     m_identifySampleLocationClient = make_unique<IdentifySampleLocationActionClient>
-      (Op_IdentifySampleLocation, true);
-
-    if (! m_unstowClient->
-        waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("Unstow action server did not connect!");
-    }
-    if (! m_stowClient->
-        waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("Stow action server did not connect!");
-    }
-    if (! m_digCircularClient->
-        waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("DigCircular action server did not connect!");
-    }
-    if (! m_digLinearClient->
-        waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("DigLinear action server did not connect!");
-    }
-    if (! m_deliverClient->
-        waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("Deliver action server did not connect!");
-    }
-    if (! m_guardedMoveClient->
-        waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("GuardedMove action server did not connect!");
-    }
-    if (! m_identifySampleLocationClient->waitForServer
-        (ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("IdentifySampleLocation action server did not connect!");
-    }
+      (topic (Op_IdentifySampleLocation), true);
+
+    addActionServer ("Unstow", m_unstowClient);
+    addActionServer ("Stow", m_stowClient);
+    addActionServer ("Grind", m_grindClient);
+    addActionServer ("DigCircular", m_digCircularClient);
+    addActionServer ("DigLinear", m_digLinearClient);
+    addActionServer ("Deliver", m_deliverClient);
+    addActionServer ("GuardedMove", m_guardedMoveClient);
+    addActionServer ("IdentifySampleLocation", m_identifySampleLocationClient);
+    startActionServerConnection();
   }
 }
 
 void OwInterface::antennaOp (const string& opname, double degrees,
-                             std::unique_ptr<ros::Publisher>& pub, int id)
+                             std::unique_ptr<ros::Publisher>& pub)
 {
-  if (! markOperationRunning (opname, id)) {
-    return;
-  }
   std_msgs::Float64 radians;
   radians.data = degrees * D2R;
   ROS_INFO ("Starting %s: %f degrees (%f radians)", opname.c_str(),
@@ -562,31 +1116,31 @@ void OwInterface::antennaOp (const string& opname, double degrees,
 
 void OwInterface::tiltAntenna (double degrees, int id)
 {
-  m_goalTilt = degrees;
-  m_tiltStart = ros::Time::now();
-  antennaOp (Op_TiltAntenna, degrees, m_antennaTiltPublisher, id);
+  // The goal is set only when the operation starts, since it may be queued
+  // behind another tilt.
+  startOperation (Op_TiltAntenna, id, [this, degrees, id] () {
+    startTilt (degrees, id);
+  });
 }
 
 void OwInterface::panAntenna (double degrees, int id)
 {
-  m_goalPan = degrees;
-  m_panStart = ros::Time::now();
-  antennaOp (Op_PanAntenna, degrees, m_antennaPanPublisher, id);
+  startOperation (Op_PanAntenna, id, [this, degrees, id] () {
+    startPan (degrees, id);
+  });
 }
 
 void OwInterface::takePicture (int id)
 {
-  if (! markOperationRunning (Op_TakePicture, id)) return;
-  std_msgs::Empty msg;
-  ROS_INFO ("Capturing stereo image using left image trigger.");
-  m_leftImageTriggerPublisher->publish (msg);
+  startOperation (Op_TakePicture, id, [this, id] () {
+    triggerPicture (id);
+  });
 }
 
 void OwInterface::deliver (double x, double y, double z, int id)
 {
-  if (! markOperationRunning (Op_Deliver, id)) return;
-  thread action_thread (&OwInterface::deliverAction, this, x, y, z, id);
-  action_thread.detach();
+  dispatchOperation (Op_Deliver, id, &OwInterface::deliverAction, this, x, y, z,
+                     id);
 }
 
 
@@ -613,10 +1167,8 @@ void OwInterface::digLinear (double x, double y,
                              double depth, double length, double ground_pos,
                              int id)
 {
-  if (! markOperationRunning (Op_DigLinear, id)) return;
-  thread action_thread (&OwInterface::digLinearAction, this, x, y, depth,
-                        length, ground_pos, id);
-  action_thread.detach();
+  dispatchOperation (Op_DigLinear, id, &OwInterface::digLinearAction, this, x,
+                     y, depth, length, ground_pos, id);
 }
 
 
@@ -649,10 +1201,8 @@ void OwInterface::digLinearAction (double x, double y,
 void OwInterface::digCircular (double x, double y, double depth,
                                double ground_pos, bool parallel, int id)
 {
-  if (! markOperationRunning (Op_DigCircular, id)) return;
-  thread action_thread (&OwInterface::digCircularAction, this, x, y, depth,
-                        ground_pos, parallel, id);
-  action_thread.detach();
+  dispatchOperation (Op_DigCircular, id, &OwInterface::digCircularAction, this,
+                     x, y, depth, ground_pos, parallel, id);
 }
 
 void OwInterface::digCircularAction (double x, double y, double depth,
@@ -682,9 +1232,7 @@ void OwInterface::digCircularAction (double x, double y, double depth,
 
 void OwInterface::unstow (int id)  // as action
 {
-  if (! markOperationRunning (Op_Unstow, id)) return;
-  thread action_thread (&OwInterface::unstowAction, this, id);
-  action_thread.detach();
+  dispatchOperation (Op_Unstow, id, &OwInterface::unstowAction, this, id);
 }
 
 void OwInterface::unstowAction (int id)
@@ -704,9 +1252,7 @@ void OwInterface::unstowAction (int id)
 
 void OwInterface::stow (int id)  // as action
 {
-  if (! markOperationRunning (Op_Stow, id)) return;
-  thread action_thread (&OwInterface::stowAction, this, id);
-  action_thread.detach();
+  dispatchOperation (Op_Stow, id, &OwInterface::stowAction, this, id);
 }
 
 void OwInterface::stowAction (int id)
@@ -727,10 +1273,8 @@ void OwInterface::stowAction (int id)
 void OwInterface::grind (double x, double y, double depth, double length,
                          bool parallel, double ground_pos, int id)
 {
-  if (! markOperationRunning (Op_Grind, id)) return;
-  thread action_thread (&OwInterface::grindAction, this, x, y, depth, length,
-                        parallel, ground_pos, id);
-  action_thread.detach();
+  dispatchOperation (Op_Grind, id, &OwInterface::grindAction, this, x, y, depth,
+                     length, parallel, ground_pos, id);
 }
 
 void OwInterface::grindAction (double x, double y, double depth, double length,
@@ -762,10 +1306,8 @@ void OwInterface::guardedMove (double x, double y, double z,
                                double dir_x, double dir_y, double dir_z,
                                double search_dist, int id)
 {
-  if (! markOperationRunning (Op_GuardedMove, id)) return;
-  thread action_thread (&OwInterface::guardedMoveAction, this, x, y, z,
-                        dir_x, dir_y, dir_z, search_dist, id);
-  action_thread.detach();
+  dispatchOperation (Op_GuardedMove, id, &OwInterface::guardedMoveAction, this,
+                     x, y, z, dir_x, dir_y, dir_z, search_dist, id);
 }
 
 void OwInterface::guardedMoveAction (double x, double y, double z,
@@ -785,6 +1327,21 @@ void OwInterface::guardedMoveAction (double x, double y, double z,
 	    "(x=%.2f, y=%.2f, z=%.2f, dir_x=%.2f, dir_y=%.2f,"
 	    "dir_z=%.2f, search_dist=%.2f)",
 	    x, y, z, dir_x, dir_y, dir_z, search_dist);
+
+  auto done_cb = [this] (const actionlib::SimpleClientGoalState& state,
+                         const GuardedMoveResultConstPtr& result) {
+    ROS_INFO ("%s finished in state %s", Op_GuardedMove.c_str(),
+              state.toString().c_str());
+    // A goal that ended without a result, e.g. one preempted or canceled on
+    // timeout, found no ground; the last position found is kept.
+    bool found = result && result->success;
+    m_telemetry->groundFound = found;
+    publish (m_telemetry->states.groundFound, found);
+    if (found) {
+      m_telemetry->groundPosition = result->final.z;
+      publish (m_telemetry->states.groundPosition, result->final.z);
+    }
+  };
   
   runAction<actionlib::SimpleActionClient<GuardedMoveAction>,
             GuardedMoveGoal,
@@ -793,35 +1350,18 @@ void OwInterface::guardedMoveAction (double x, double y, double z,
     (Op_GuardedMove, m_guardedMoveClient, goal, id,
      default_action_active_cb (Op_GuardedMove),
      default_action_feedback_cb<GuardedMoveFeedbackConstPtr> (Op_GuardedMove),
-     guarded_move_done_cb<GuardedMoveResultConstPtr> (Op_GuardedMove));
-}
-
-vector<double> OwInterface::identifySampleLocation (int num_images,
-                                                    const string& filter_type,
-                                                    int id)
-{
-  SamplePoint.clear();
-  GotSampleLocation = false;
-  if (! markOperationRunning (Op_IdentifySampleLocation, id)) return SamplePoint;
-  thread action_thread (&OwInterface::identifySampleLocationAction,
-                        this, num_images, filter_type, id);
-  action_thread.detach();
-
-  ros::Rate rate(10);
-  int timeout = 0;
-  // We wait for a result from the action server or the 5 sec timeout before
-  // returning. I dont think a timeout is strictly necessary here but because
-  // this is blocking I put it in for safety.
-  while(GotSampleLocation == false && timeout < SampleTimeout){
-      ros::spinOnce();
-      rate.sleep();
-      timeout+=1;
-  }
-  if(timeout == SampleTimeout){
-    ROS_ERROR("Did not recieve a sample point from "
-              "IdentifySampleLocation before timeout.");
-  }
-  return SamplePoint;
+     done_cb);
+}
+
+void OwInterface::identifySampleLocation (int num_images,
+                                          const string& filter_type,
+                                          int id)
+{
+  // A rejected command still gets its (invalid) result, from
+  // handleOperationFinished.
+  dispatchOperation (Op_IdentifySampleLocation, id,
+                     &OwInterface::identifySampleLocationAction, this,
+                     num_images, filter_type, id);
 }
 
 void OwInterface::identifySampleLocationAction (int num_images,
@@ -832,6 +1372,23 @@ void OwInterface::identifySampleLocationAction (int num_images,
   goal.num_images = num_images;
   goal.filter_type = filter_type;
 
+  auto done_cb = [this, id] (const actionlib::SimpleClientGoalState& state,
+                             const ow_plexil::IdentifyLocationResultConstPtr&
+                             result) {
+    if (result && result->success) {
+      ROS_INFO ("Possible sample location identified at (%f, %f, %f)",
+                result->sample_location.x, result->sample_location.y,
+                result->sample_location.z);
+      lock_guard<mutex> lock (m_sampleLocationsMutex);
+      m_sampleLocations[id] = { result->sample_location.x,
+                                result->sample_location.y,
+                                result->sample_location.z };
+    }
+    else {
+      ROS_ERROR("Could not get sample point from IdentifySampleLocation");
+    }
+  };
+
   runAction<actionlib::SimpleActionClient<ow_plexil::IdentifyLocationAction>,
             ow_plexil::IdentifyLocationGoal,
             ow_plexil::IdentifyLocationResultConstPtr,
@@ -840,53 +1397,95 @@ void OwInterface::identifySampleLocationAction (int num_images,
      default_action_active_cb (Op_IdentifySampleLocation),
      default_action_feedback_cb<ow_plexil::IdentifyLocationFeedbackConstPtr>
      (Op_IdentifySampleLocation),
-     identify_sample_location_done_cb<IdentifySampleLocation,
-                                      ow_plexil::IdentifyLocationResultConstPtr>);
+     done_cb);
+}
+
+void OwInterface::handleOperationFinished (const string& name, int id,
+                                           bool success)
+{
+  if (name != Op_IdentifySampleLocation) return;
+
+  // The sample point is returned whether or not the identification succeeded,
+  // since plans wait on it.
+  vector<double> point;
+  {
+    lock_guard<mutex> lock (m_sampleLocationsMutex);
+    auto it = m_sampleLocations.find (id);
+    if (it != m_sampleLocations.end()) {
+      point = it->second;
+      m_sampleLocations.erase (it);
+    }
+  }
+  // Checks if we have a valid sized point
+  if (point.size() != 3) {
+    // Resizes the array and initializes values to -500 so we know to skip
+    point.assign (1, -500);
+  }
+  returnCommandValue (id, point);
 }
 
 double OwInterface::getTilt () const
 {
+  lock_guard<mutex> lock (m_antennaMutex);
   return m_currentTilt;
 }
 
 double OwInterface::getPanDegrees () const
 {
+  lock_guard<mutex> lock (m_antennaMutex);
   return m_currentPan;
 }
 
 double OwInterface::getPanVelocity () const
 {
-  return JointTelemetryMap[Joint::antenna_pan].velocity;
+  return m_telemetry->jointSnapshots.load().joints[joint_index (Joint::antenna_pan)].velocity;
 }
 
 double OwInterface::getTiltVelocity () const
 {
-  return JointTelemetryMap[Joint::antenna_tilt].velocity;
+  return m_telemetry->jointSnapshots.load().joints[joint_index (Joint::antenna_tilt)].velocity;
 }
 
 double OwInterface::getStateOfCharge () const
 {
-  return StateOfCharge;
+  return m_telemetry->powerSnapshots.load().stateOfCharge;
 }
 
 double OwInterface::getRemainingUsefulLife () const
 {
-  return RemainingUsefulLife;
+  return m_telemetry->powerSnapshots.load().remainingUsefulLife;
 }
 
 double OwInterface::getBatteryTemperature () const
 {
-  return BatteryTemperature;
+  return m_telemetry->powerSnapshots.load().batteryTemperature;
+}
+
+double OwInterface::getProjectedRemainingUsefulLife () const
+{
+  return m_telemetry->powerSnapshots.load().projectedRemainingUsefulLife;
+}
+
+double OwInterface::jointTelemetryTime () const
+{
+  return m_telemetry->jointSnapshots.load().stamp;
+}
+
+double OwInterface::powerTelemetryTime () const
+{
+  return m_telemetry->powerSnapshots.load().stamp;
 }
 
 bool OwInterface::hardTorqueLimitReached (const string& joint_name) const
 {
-  return (JointsAtHardTorqueLimit.find (joint_name) !=
-          JointsAtHardTorqueLimit.end());
+  auto it = JointsByPlexilName.find (joint_name);
+  return (it != JointsByPlexilName.end() &&
+          m_telemetry->jointSnapshots.load().hardTorque[it->second]);
 }
 
 bool OwInterface::softTorqueLimitReached (const string& joint_name) const
 {
-  return (JointsAtSoftTorqueLimit.find (joint_name) !=
-          JointsAtSoftTorqueLimit.end());
+  auto it = JointsByPlexilName.find (joint_name);
+  return (it != JointsByPlexilName.end() &&
+          m_telemetry->jointSnapshots.load().softTorque[it->second]);
 }
@@ -5,11 +5,13 @@
 #ifndef Ow_Interface_H
 #define Ow_Interface_H
 
-// Interface to lander simulator.  Singleton, because only once instance will
-// ever be needed in the current autonomy scheme, which has one autonomy
-// executive per lander.
+// Interface to lander simulator.  There is one instance per lander, by its
+// ROS namespace, so that one executive can serve several landers: the default
+// lander, whose topics and states are named as they always were, and those
+// named by the private ROS parameter ~landers (see landers()).
 
 #include <memory>
+#include <mutex>
 #include <ros/ros.h>
 
 // ROS Actions - OceanWATERS
@@ -28,7 +30,10 @@
 #include <sensor_msgs/Image.h>
 #include <sensor_msgs/PointCloud2.h>
 #include <geometry_msgs/Point.h>
+#include <std_msgs/Float64.h>
+#include <std_msgs/Int16.h>
 #include <string>
+#include <vector>
 
 #include <ow_faults_detection/SystemFaults.h>
 #include <ow_faults_detection/ArmFaults.h>
@@ -36,6 +41,10 @@
 #include <ow_faults_detection/PTFaults.h>
 
 #include "PlexilInterface.h"
+#include "CallbackGroup.h"
+#include "fault_support.h"
+#include "AntennaTracker.h"
+#include "joint_support.h"
 
 using UnstowActionClient =
   actionlib::SimpleActionClient<ow_lander::UnstowAction>;
@@ -54,16 +63,21 @@ using DeliverActionClient =
 using IdentifySampleLocationActionClient =
   actionlib::SimpleActionClient<ow_plexil::IdentifyLocationAction>;
 
-// Maps from fault name to the pair (fault value, is fault in progress?)
-using FaultMap32 = std::map<std::string,std::pair<uint32_t, bool>>;
-using FaultMap64 = std::map<std::string,std::pair<uint64_t, bool>>;
-
 class OwInterface : public PlexilInterface
 {
  public:
+  // The interface to the default lander.
   static OwInterface* instance();
-  OwInterface ();
-  ~OwInterface () = default;
+
+  // The interface to the lander in the given namespace, created on first use.
+  static OwInterface* instance (const std::string& lander);
+
+  // Namespaces of the landers served: the default lander (""), then those
+  // listed in the private ROS parameter ~landers, e.g. [lander2, lander3].
+  static std::vector<std::string> landers ();
+
+  explicit OwInterface (const std::string& lander = "");
+  ~OwInterface ();
   OwInterface (const OwInterface&) = delete;
   OwInterface& operator= (const OwInterface&) = delete;
   void initialize ();
@@ -73,9 +87,8 @@ class OwInterface : public PlexilInterface
   void guardedMove (double x, double y, double z,
                     double direction_x, double direction_y, double direction_z,
                     double search_distance, int id);
-  std::vector<double> identifySampleLocation (int num_images, 
-                                              const std::string& filter_type,
-                                              int id);
+  void identifySampleLocation (int num_images, const std::string& filter_type,
+                               int id);
   void tiltAntenna (double degrees, int id);
   void panAntenna (double degrees, int id);
   void takePicture (int id);
@@ -88,8 +101,9 @@ class OwInterface : public PlexilInterface
   void stow (int id);
   void unstow (int id);
   void deliver (double x, double y, double z, int id);
-  void takePanorama (double elev_lo, double elev_hi,
-                     double lat_overlap, double vert_overlap);
+  void takePanorama (double tilt_lo, double tilt_hi,
+                     double pan_lo, double pan_hi,
+                     double vert_overlap, double horiz_overlap, int id);
 
   // State/Lookup interface
   double getTilt () const;
@@ -99,6 +113,10 @@ class OwInterface : public PlexilInterface
   double getStateOfCharge () const;
   double getRemainingUsefulLife () const;
   double getBatteryTemperature () const;
+  double getProjectedRemainingUsefulLife () const;  // see PowerEstimator
+  bool powerBudgetOK () const;
+  double jointTelemetryTime () const;  // stamp of the joint values, in seconds
+  double powerTelemetryTime () const;  // receipt of the power values, in seconds
   bool   groundFound () const;
   double groundPosition () const;
   bool   systemFault () const;
@@ -108,6 +126,17 @@ class OwInterface : public PlexilInterface
 
   bool hardTorqueLimitReached (const std::string& joint_name) const;
   bool softTorqueLimitReached (const std::string& joint_name) const;
+  double panoramaFramesTaken () const;  // by the running or last panorama
+
+  // The lander's joint and power telemetry, torque limits and GuardedMove
+  // results, defined in OwInterface.cpp.
+  struct Telemetry;
+
+  // Antenna angles of one image of a panorama, in degrees.
+  struct PanoramaFrame
+  {
+    double tilt, pan;
+  };
 
  private:
   void unstowAction (int id);
@@ -119,63 +148,101 @@ class OwInterface : public PlexilInterface
                           double search_distance, int id);
   void identifySampleLocationAction (int num_images, 
                                      const std::string& filter_type, int id);
+  void handleOperationFinished (const std::string& name, int id,
+                                bool success) override;
   void digCircularAction (double x, double y, double depth,
                           double ground_pos, bool parallel, int id);
   void digLinearAction (double x, double y, double depth, double length,
                         double ground_pos, int id);
   void deliverAction (double x, double y, double z, int id);
   void jointStatesCallback (const sensor_msgs::JointState::ConstPtr&);
+  void handleOvertorque (Joint, double effort);
+  void handleJointFault (Joint, int joint_index,
+                         const sensor_msgs::JointState::ConstPtr&);
+  void socCallback (const std_msgs::Float64::ConstPtr&);
+  void rulCallback (const std_msgs::Int16::ConstPtr&);
+  void temperatureCallback (const std_msgs::Float64::ConstPtr&);
+  void updatePowerBudget (double stamp);
+  bool operationPermitted (size_t op) const override;
   void cameraCallback (const sensor_msgs::Image::ConstPtr&);
   void pointCloudCallback (const sensor_msgs::PointCloud2::ConstPtr&);
-  void managePanTilt (const std::string& opname,
-                      double current, double goal,
-                      const ros::Time& start);
+  void armPictureTimeout (double seconds, ros::Timer& replaced);
+  void pictureTimeout (int id);
+  int releasePicture (ros::Timer& timer);
+  void pictureFinished (int id, bool success);
+  void triggerPicture (int id);
+  void startPan (double degrees, int id);
+  void startTilt (double degrees, int id);
+  void antennaMoveFinished (const std::string& opname, int id, bool success);
+
+  // What a panorama does next, decided under m_panoramaMutex and done outside
+  // it.
+  struct PanoramaStep
+  {
+    int id = IDLE_ID;
+    bool pan = false, tilt = false;
+    double panDegrees = 0, tiltDegrees = 0;
+    bool shoot = false;
+    bool finished = false, success = false;
+    size_t taken = 0;
+  };
+  PanoramaStep advancePanorama ();
+  void runPanoramaStep (const PanoramaStep&);
+  // These return whether the move or picture was part of a panorama.
+  bool panoramaMoveFinished (int id, bool success);
+  bool panoramaPictureFinished (int id, bool success);
+  void panoramaImageCaptured (int id);
   void systemFaultMessageCallback (const ow_faults_detection::SystemFaults::ConstPtr&);
   void armFaultCallback (const ow_faults_detection::ArmFaults::ConstPtr&);
   void powerFaultCallback (const ow_faults_detection::PowerFaults::ConstPtr&);
   void antennaFaultCallback (const ow_faults_detection::PTFaults::ConstPtr&);
   void antennaOp (const std::string& opname, double degrees,
-                  std::unique_ptr<ros::Publisher>&, int id);
+                  std::unique_ptr<ros::Publisher>&);
 
-  template <typename T1, typename T2>
-    void updateFaultStatus (T1 msg_val, T2&,
-                            const std::string& component_name,
-                            const std::string& state_name); // PLEXIL Lookup name
+  void updateFaultStatus (uint64_t msg_value, FaultTracker&,
+                          const StateHandle&); // of the PLEXIL Lookup
 
-  template <typename T>
-    bool faultActive (const T& fault_map) const;
+  // Fault status by component.  Updated only by the fault callbacks, which
+  // share a single-threaded queue; read by the exec.
 
-  // System level faults:
+  FaultTracker m_systemErrors { "SYSTEM", {
+    {"ARM_EXECUTION_ERROR", 4},
+    {"POWER_EXECUTION_ERROR", 512},
+    {"PT_EXECUTION_ERROR", 128}
+  }};
 
-  FaultMap64 m_systemErrors =
-  {
-    {"ARM_EXECUTION_ERROR", std::make_pair(4,false)},
-    {"POWER_EXECUTION_ERROR", std::make_pair(512,false)},
-    {"PT_EXECUTION_ERROR", std::make_pair(128,false)}
-  };
+  FaultTracker m_armErrors { "ARM", {
+    {"HARDWARE_ERROR", 1},
+    {"TRAJECTORY_GENERATION_ERROR", 2},
+    {"COLLISION_ERROR", 3},
+    {"ESTOP_ERROR", 4},
+    {"POSITION_LIMIT_ERROR", 5},
+    {"TORQUE_LIMIT_ERROR", 6},
+    {"VELOCITY_LIMIT_ERROR", 7},
+    {"NO_FORCE_DATA_ERROR", 8}
+  }};
 
-  FaultMap32 m_armErrors = {
-    {"HARDWARE_ERROR", std::make_pair(1, false)},
-    {"TRAJECTORY_GENERATION_ERROR", std::make_pair(2, false)},
-    {"COLLISION_ERROR", std::make_pair(3, false)},
-    {"ESTOP_ERROR", std::make_pair(4, false)},
-    {"POSITION_LIMIT_ERROR", std::make_pair(5, false)},
-    {"TORQUE_LIMIT_ERROR", std::make_pair(6, false)},
-    {"VELOCITY_LIMIT_ERROR", std::make_pair(7, false)},
-    {"NO_FORCE_DATA_ERROR", std::make_pair(8, false)}
-  };
+  FaultTracker m_powerErrors { "POWER", {
+    {"HARDWARE_ERROR", 1}
+  }};
 
-  FaultMap32 m_powerErrors = {
-    {"HARDWARE_ERROR", std::make_pair(1, false)}
-  };
+  FaultTracker m_panTiltErrors { "ANTENNA", {
+    {"HARDWARE_ERROR", 1},
+    {"JOINT_LIMIT_ERROR", 2}
+  }};
 
-  FaultMap32 m_panTiltErrors = {
-    {"HARDWARE_ERROR", std::make_pair(1, false)},
-    {"JOINT_LIMIT_ERROR", std::make_pair(2, false)}
-  };
+  std::unique_ptr<Telemetry> m_telemetry;
+
+  bool m_initialized;
 
   std::unique_ptr<ros::NodeHandle> m_genericNodeHandle;
 
+  // Callback queues, each with its own spinner, so that a slow subsystem
+  // (e.g. imaging) cannot delay telemetry or fault reporting.
+  std::unique_ptr<CallbackGroup> m_telemetryCallbacks;
+  std::unique_ptr<CallbackGroup> m_faultCallbacks;
+  std::unique_ptr<CallbackGroup> m_imagingCallbacks;
+
   // Publishers and subscribers
 
   std::unique_ptr<ros::Publisher> m_antennaTiltPublisher;
@@ -203,11 +270,40 @@ class OwInterface : public PlexilInterface
   std::unique_ptr<DeliverActionClient> m_deliverClient;
   std::unique_ptr<IdentifySampleLocationActionClient> m_identifySampleLocationClient;
 
-  // Antenna state - note that pan and tilt can be concurrent.
+  // Sample locations identified by running IdentifySampleLocation commands, by
+  // command ID.  Empty until the action succeeds.
+  std::map<int, std::vector<double>> m_sampleLocations;
+  std::mutex m_sampleLocationsMutex;
+
+  // Antenna state - note that pan and tilt can be concurrent.  The current
+  // angles are written by the telemetry callbacks and read by the exec, so
+  // guarded by m_antennaMutex.  Moves in progress are tracked per axis.
+  mutable std::mutex m_antennaMutex;
   double m_currentPan, m_currentTilt;
-  double m_goalPan, m_goalTilt;      // commanded pan/tilt values
-  bool m_pointCloudRecieved;
-  ros::Time m_panStart, m_tiltStart; // pan/tilt start times
+  AntennaTracker m_panTracker, m_tiltTracker;
+
+  // TakePicture state, guarded by m_pictureMutex.  The picture is complete
+  // when both an image and a point cloud stamped after the trigger have been
+  // received.  m_pictureId is IDLE_ID when no picture is pending.
+  std::mutex m_pictureMutex;
+  int m_pictureId;
+  ros::Time m_pictureTriggerTime;
+  bool m_imageReceived, m_pointCloudReceived;
+  ros::Timer m_pictureTimer;
+
+  // TakePanorama state, guarded by m_panoramaMutex.  The panorama's moves and
+  // pictures run under its own command ID, which is IDLE_ID when no panorama
+  // is running.
+  mutable std::mutex m_panoramaMutex;
+  int m_panoramaId;
+  std::vector<PanoramaFrame> m_panoramaFrames;
+  size_t m_panoramaTarget;     // frame the antenna is at or moving to
+  size_t m_panoramaTriggered;  // pictures triggered
+  size_t m_panoramaTaken;      // pictures completed
+  int m_panoramaMoves;         // antenna moves in progress
+  bool m_panoramaShooting;     // a picture is in progress
+  bool m_panoramaCaptured;     // its image is in, so the antenna may move
+  bool m_panoramaFailed;
 };
 
 #endif
@@ -19,7 +19,9 @@ public:
   OwlatAdapter& operator= (const OwlatAdapter&) = delete;
 
   virtual bool initialize();
-  virtual void lookupNow (const PLEXIL::State&, PLEXIL::StateCacheEntry&);
+
+private:
+  void registerLookups ();
 };
 
 extern "C" {
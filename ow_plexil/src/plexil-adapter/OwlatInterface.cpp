@@ -2,7 +2,7 @@
 // Research and Simulation can be found in README.md in the root directory of
 // this repository.
 
-#include <thread>
+#include <algorithm>
 #include <vector>
 #include "OwlatInterface.h"
 #include <ArrayImpl.hh>
@@ -10,8 +10,9 @@
 #include "subscriber.h"
 
 using std::hash;
+using std::lock_guard;
+using std::mutex;
 using std::string;
-using std::thread;
 using std::string;
 using std::vector;
 using namespace owlat_sim_msgs;
@@ -33,6 +34,10 @@ const string Name_OwlatTaskPSP =   "/owlat_sim/TASK_PSP";
 const string Name_OwlatTaskScoop =   "/owlat_sim/TASK_SCOOP";
 const string Name_OwlatTaskShearBevameter =   "/owlat_sim/TASK_SHEAR_BEVAMETER";
 
+// Resources that lander operations need exclusively.  ARM_STOP needs none, so
+// that it can interrupt the other arm operations.
+const unsigned ArmResource = 1;
+
 // Used as indices into the subsequent vector.
 enum class LanderOps {
   OwlatUnstow,
@@ -52,22 +57,23 @@ enum class LanderOps {
   OwlatArmTaskShearBevameter
 };
 
-static std::vector<string> LanderOpNames = {
-    Name_OwlatUnstow,
-    Name_OwlatStow,
-    Name_OwlatArmMoveCartesian,
-    Name_OwlatArmMoveCartesianGuarded,
-    Name_OwlatArmMoveJoint,
-    Name_OwlatArmMoveJoints,
-    Name_OwlatArmMoveJointsGuarded,
-    Name_OwlatArmPlaceTool,
-    Name_OwlatArmSetTool,
-    Name_OwlatArmStop,
-    Name_OwlatArmTareFS,
-    Name_OwlatTaskDropoff,
-    Name_OwlatTaskPSP,
-    Name_OwlatTaskScoop,
-    Name_OwlatTaskShearBevameter
+// Operation names and the resources they need.
+static std::vector<std::pair<string, unsigned>> LanderOpTable = {
+    {Name_OwlatUnstow, ArmResource},
+    {Name_OwlatStow, ArmResource},
+    {Name_OwlatArmMoveCartesian, ArmResource},
+    {Name_OwlatArmMoveCartesianGuarded, ArmResource},
+    {Name_OwlatArmMoveJoint, ArmResource},
+    {Name_OwlatArmMoveJoints, ArmResource},
+    {Name_OwlatArmMoveJointsGuarded, ArmResource},
+    {Name_OwlatArmPlaceTool, ArmResource},
+    {Name_OwlatArmSetTool, ArmResource},
+    {Name_OwlatArmStop, 0},
+    {Name_OwlatArmTareFS, ArmResource},
+    {Name_OwlatTaskDropoff, ArmResource},
+    {Name_OwlatTaskPSP, ArmResource},
+    {Name_OwlatTaskScoop, ArmResource},
+    {Name_OwlatTaskShearBevameter, ArmResource}
   };
 
 // Task Shear Bevameter Callback
@@ -77,9 +83,13 @@ static void task_shear_bevameter_done_cb
 (const actionlib::SimpleClientGoalState& state,
  const T& result)
 {
-  ROS_INFO("Shear Bevameter Stop Reason: : %d", result->stop_reason.value);
-  BevameterStopReasonVar = result->stop_reason.value;
-  publish("ShearBevameterStopReason", BevameterStopReasonVar);
+  // Goals that end without a result, e.g. when canceled, have no reason.
+  if (result) {
+    ROS_INFO("Shear Bevameter Stop Reason: : %d", result->stop_reason.value);
+    BevameterStopReasonVar = result->stop_reason.value;
+    static const StateHandle reason ("ShearBevameterStopReason");
+    publish(reason, BevameterStopReasonVar);
+  }
   ROS_INFO ("/owlat_sim/TASK_SHEAR_BEVAMETER finished in state %s", 
             state.toString().c_str());
 }
@@ -91,9 +101,13 @@ static void task_psp_done_cb
 (const actionlib::SimpleClientGoalState& state,
  const T& result)
 {
-  ROS_INFO("PSP Stop Reason: : %d", result->stop_reason.value);
-  PSPStopReasonVar = result->stop_reason.value;
-  publish("PSPStopReason", PSPStopReasonVar);
+  // Goals that end without a result, e.g. when canceled, have no reason.
+  if (result) {
+    ROS_INFO("PSP Stop Reason: : %d", result->stop_reason.value);
+    PSPStopReasonVar = result->stop_reason.value;
+    static const StateHandle reason ("PSPStopReason");
+    publish(reason, PSPStopReasonVar);
+  }
   ROS_INFO ("/owlat_sim/TASK_PSP finished in state %s", 
             state.toString().c_str());
 }
@@ -105,67 +119,93 @@ OwlatInterface* OwlatInterface::instance ()
   return &instance;
 }
 
+OwlatInterface::~OwlatInterface ()
+{
+  // Stop the telemetry thread before the values it writes go away, and drain
+  // pending dispatches while the action clients still exist.
+  stopActionServerConnection();
+  m_telemetryCallbacks.reset();
+  m_actionWorkers.stop();
+}
+
 void OwlatInterface::initialize()
 {
   static bool initialized = false;
 
   if (not initialized) {
 
-    for (auto name : LanderOpNames) {
-      registerLanderOperation (name);
+    for (const auto& op : LanderOpTable) {
+      registerLanderOperation (op.first, op.second);
     }
 
+    startActionWorkers();
+    loadOperationTimeouts();
+    loadOperationQueueLimits();
+
     m_genericNodeHandle = make_unique<ros::NodeHandle>();
-    m_arm_joint_angles.resize(7);
-    m_arm_joint_accelerations.resize(7);
-    m_arm_joint_torques.resize(7);
-    m_arm_joint_velocities.resize(7);
-    m_arm_ft_torque.resize(3);
-    m_arm_ft_force.resize(3);
-    m_arm_pose.resize(7);
+    m_arm_joint_angles = RealArray (7, 0.0);
+    m_arm_joint_accelerations = RealArray (7, 0.0);
+    m_arm_joint_torques = RealArray (7, 0.0);
+    m_arm_joint_velocities = RealArray (7, 0.0);
+    m_arm_ft_torque = RealArray (3, 0.0);
+    m_arm_ft_force = RealArray (3, 0.0);
+    m_arm_pose = RealArray (7, 0.0);
+    m_armJointAnglesState = stateHandle ("ArmJointAngles");
+    m_armJointAccelerationsState = stateHandle ("ArmJointAccelerations");
+    m_armJointTorquesState = stateHandle ("ArmJointTorques");
+    m_armJointVelocitiesState = stateHandle ("ArmJointVelocities");
+    m_armFTTorqueState = stateHandle ("ArmFTTorque");
+    m_armFTForceState = stateHandle ("ArmFTForce");
+    m_armPoseState = stateHandle ("ArmPose");
+    m_armToolState = stateHandle ("ArmTool");
     m_arm_tool = 0;
 
     const int qsize = 3;
+    m_telemetryCallbacks = make_unique<CallbackGroup>("telemetry");
+    ros::NodeHandle& telemetry_nh = m_telemetryCallbacks->nodeHandle();
+
     m_armJointAnglesSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
+      (telemetry_nh.
        subscribe("/owlat_sim/ARM_JOINT_ANGLES", qsize,
        &OwlatInterface::armJointAnglesCallback, this));
  
     m_armJointAccelerationsSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
+      (telemetry_nh.
        subscribe("/owlat_sim/ARM_JOINT_ACCELERATIONS", qsize,
        &OwlatInterface::armJointAccelerationsCallback, this));
 
     m_armJointTorquesSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
+      (telemetry_nh.
        subscribe("/owlat_sim/ARM_JOINT_TORQUES", qsize,
        &OwlatInterface::armJointTorquesCallback, this));
 
     m_armJointVelocitiesSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
+      (telemetry_nh.
        subscribe("/owlat_sim/ARM_JOINT_VELOCITIES", qsize,
        &OwlatInterface::armJointAnglesCallback, this));
 
     m_armFTTorqueSubscriber = make_unique<ros::Subscriber>
-      (m_genericNodeHandle ->
+      (telemetry_nh.
        subscribe("/owlat_sim/ARM_FT_TORQUE", qsize,
        &OwlatInterface::armFTTorqueCallback, this));
 
    m_armFTForceSubscriber = make_unique<ros::Subscriber>
-        (m_genericNodeHandle ->
+        (telemetry_nh.
          subscribe("/owlat_sim/ARM_FT_FORCE", qsize,
          &OwlatInterface::armFTForceCallback, this));
 
    m_armPoseSubscriber = make_unique<ros::Subscriber>
-        (m_genericNodeHandle ->
+        (telemetry_nh.
          subscribe("/owlat_sim/ARM_POSE", qsize,
          &OwlatInterface::armPoseCallback, this));
          
    m_armToolSubscriber = make_unique<ros::Subscriber>
-        (m_genericNodeHandle ->
+        (telemetry_nh.
          subscribe("/owlat_sim/ARM_TOOL", qsize,
          &OwlatInterface::armToolCallback, this));
 
+    m_telemetryCallbacks->start();
+
     // Initialize pointers
     m_owlatUnstowClient =
       std::make_unique<OwlatUnstowActionClient>(Name_OwlatUnstow, true);
@@ -199,51 +239,22 @@ void OwlatInterface::initialize()
       std::make_unique<OwlatTaskShearBevameterActionClient>(Name_OwlatTaskShearBevameter, true);
 
     // Connect to action servers
-    if (! m_owlatUnstowClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT UNSTOW action server did not connect!");
-    }
-    if (! m_owlatStowClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT STOW action server did not connect!");
-    }
-    if (! m_owlatArmMoveCartesianClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT ARM_MOVE_CARTESIAN action server did not connect!");
-    }
-    if (! m_owlatArmMoveCartesianGuardedClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT ARM_MOVE_CARTESIAN_GUARDED action server did not connect!");
-    }
-    if (! m_owlatArmMoveJointClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT ARM_MOVE_JOINT action server did not connect!");
-    }
-    if (! m_owlatArmMoveJointsClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT ARM_MOVE_JOINTS action server did not connect!");
-    }
-    if (! m_owlatArmMoveJointsGuardedClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT ARM_MOVE_JOINTS_GUARDED action server did not connect!");
-    }
-    if (! m_owlatArmPlaceToolClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT ARM_PLACE_TOOL action server did not connect!");
-    }
-    if (! m_owlatArmSetToolClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT ARM_SET_TOOL action server did not connect!");
-    }
-    if (! m_owlatArmStopClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT ARM_STOP action server did not connect!");
-    }
-    if (! m_owlatArmTareFSClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT ARM_TARE_FS action server did not connect!");
-    }
-    if (! m_owlatTaskDropoffClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT TASK_DROPOFF action server did not connect!");
-    }
-    if (! m_owlatTaskPSPClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT TASK_PSP action server did not connect!");
-    }
-    if (! m_owlatTaskScoopClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT TASK_SCOOP action server did not connect!");
-    }
-    if (! m_owlatTaskShearBevameterClient->waitForServer(ros::Duration(ACTION_SERVER_TIMEOUT_SECS))) {
-      ROS_ERROR ("OWLAT TASK_SHEAR_BEVAMETER action server did not connect!");
-    }
+    addActionServer ("OWLAT UNSTOW", m_owlatUnstowClient);
+    addActionServer ("OWLAT STOW", m_owlatStowClient);
+    addActionServer ("OWLAT ARM_MOVE_CARTESIAN", m_owlatArmMoveCartesianClient);
+    addActionServer ("OWLAT ARM_MOVE_CARTESIAN_GUARDED", m_owlatArmMoveCartesianGuardedClient);
+    addActionServer ("OWLAT ARM_MOVE_JOINT", m_owlatArmMoveJointClient);
+    addActionServer ("OWLAT ARM_MOVE_JOINTS", m_owlatArmMoveJointsClient);
+    addActionServer ("OWLAT ARM_MOVE_JOINTS_GUARDED", m_owlatArmMoveJointsGuardedClient);
+    addActionServer ("OWLAT ARM_PLACE_TOOL", m_owlatArmPlaceToolClient);
+    addActionServer ("OWLAT ARM_SET_TOOL", m_owlatArmSetToolClient);
+    addActionServer ("OWLAT ARM_STOP", m_owlatArmStopClient);
+    addActionServer ("OWLAT ARM_TARE_FS", m_owlatArmTareFSClient);
+    addActionServer ("OWLAT TASK_DROPOFF", m_owlatTaskDropoffClient);
+    addActionServer ("OWLAT TASK_PSP", m_owlatTaskPSPClient);
+    addActionServer ("OWLAT TASK_SCOOP", m_owlatTaskScoopClient);
+    addActionServer ("OWLAT TASK_SHEAR_BEVAMETER", m_owlatTaskShearBevameterClient);
+    startActionServerConnection();
   }
 }
 
@@ -252,9 +263,8 @@ void OwlatInterface::initialize()
 
 void OwlatInterface::owlatUnstow (int id)
 {
-  if (! markOperationRunning (Name_OwlatUnstow, id)) return;
-  thread action_thread (&OwlatInterface::owlatUnstowAction, this, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatUnstow, id, &OwlatInterface::owlatUnstowAction,
+                     this, id);
 }
 
 void OwlatInterface::owlatUnstowAction (int id)
@@ -274,9 +284,8 @@ void OwlatInterface::owlatUnstowAction (int id)
 
 void OwlatInterface::owlatStow (int id)
 {
-  if (! markOperationRunning (Name_OwlatStow, id)) return;
-  thread action_thread (&OwlatInterface::owlatStowAction, this, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatStow, id, &OwlatInterface::owlatStowAction, this,
+                     id);
 }
 
 void OwlatInterface::owlatStowAction (int id)
@@ -299,10 +308,9 @@ void OwlatInterface::owlatArmMoveCartesian (int frame, bool relative,
                                             const vector<double>& orientation,
                                             int id)
 {
-  if (! markOperationRunning (Name_OwlatArmMoveCartesian, id)) return;
-  thread action_thread (&OwlatInterface::owlatArmMoveCartesianAction, this,
-                        frame, relative, position, orientation, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatArmMoveCartesian, id,
+                     &OwlatInterface::owlatArmMoveCartesianAction, this, frame,
+                     relative, position, orientation, id);
 }
 
 void OwlatInterface::owlatArmMoveCartesianAction (int frame, bool relative, 
@@ -339,11 +347,10 @@ void OwlatInterface::owlatArmMoveCartesianGuarded (int frame, bool relative,
                                                    double force_threshold,
                                                    double torque_threshold,int id)
 {
-  if (! markOperationRunning (Name_OwlatArmMoveCartesianGuarded, id)) return;
-  thread action_thread (&OwlatInterface::owlatArmMoveCartesianGuardedAction,
-                        this, frame, relative, position, orientation,
-                        retracting, force_threshold, torque_threshold, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatArmMoveCartesianGuarded, id,
+                     &OwlatInterface::owlatArmMoveCartesianGuardedAction, this,
+                     frame, relative, position, orientation, retracting,
+                     force_threshold, torque_threshold, id);
 }
 
 void OwlatInterface::owlatArmMoveCartesianGuardedAction (int frame, bool relative, 
@@ -382,10 +389,9 @@ void OwlatInterface::owlatArmMoveJoint (bool relative,
                                         int joint, double angle, 
                                         int id) 
 {
-  if (! markOperationRunning (Name_OwlatArmMoveJoint, id)) return;
-  thread action_thread (&OwlatInterface::owlatArmMoveJointAction,
-                        this, relative, joint, angle, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatArmMoveJoint, id,
+                     &OwlatInterface::owlatArmMoveJointAction, this, relative,
+                     joint, angle, id);
 }
 
 void OwlatInterface::owlatArmMoveJointAction (bool relative, 
@@ -411,10 +417,9 @@ void OwlatInterface::owlatArmMoveJointAction (bool relative,
 void OwlatInterface::owlatArmMoveJoints (bool relative, const vector<double>& angles, 
                                          int id) 
 {
-  if (! markOperationRunning (Name_OwlatArmMoveJoints, id)) return;
-  thread action_thread (&OwlatInterface::owlatArmMoveJointsAction,
-                        this, relative, angles, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatArmMoveJoints, id,
+                     &OwlatInterface::owlatArmMoveJointsAction, this, relative,
+                     angles, id);
 }
 
 void OwlatInterface::owlatArmMoveJointsAction (bool relative, const vector<double>& angles, 
@@ -445,11 +450,10 @@ void OwlatInterface::owlatArmMoveJointsGuarded (bool relative,
                                                 double torque_threshold, 
                                                 int id)
 {
-  if (! markOperationRunning (Name_OwlatArmMoveJointsGuarded, id)) return;
-  thread action_thread (&OwlatInterface::owlatArmMoveJointsGuardedAction,
-                        this, relative, angles, retracting, force_threshold,
-                        torque_threshold, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatArmMoveJointsGuarded, id,
+                     &OwlatInterface::owlatArmMoveJointsGuardedAction, this,
+                     relative, angles, retracting, force_threshold,
+                     torque_threshold, id);
 }
 
 void OwlatInterface::owlatArmMoveJointsGuardedAction (bool relative,
@@ -487,12 +491,10 @@ void OwlatInterface::owlatArmPlaceTool (int frame, bool relative,
                                         bool retracting, double force_threshold,
                                         double torque_threshold, int id)
 {
-  if (! markOperationRunning (Name_OwlatArmPlaceTool, id)) return;
-  thread action_thread (&OwlatInterface::owlatArmPlaceToolAction,
-                        this, frame, relative, position, normal, 
-                        distance, overdrive, retracting, force_threshold,
-                        torque_threshold, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatArmPlaceTool, id,
+                     &OwlatInterface::owlatArmPlaceToolAction, this, frame,
+                     relative, position, normal, distance, overdrive,
+                     retracting, force_threshold, torque_threshold, id);
 }
 
 void OwlatInterface::owlatArmPlaceToolAction (int frame, bool relative,
@@ -528,9 +530,8 @@ void OwlatInterface::owlatArmPlaceToolAction (int frame, bool relative,
 
 void OwlatInterface::owlatArmSetTool (int tool, int id)
 {
-  if (! markOperationRunning (Name_OwlatArmSetTool, id)) return;
-  thread action_thread (&OwlatInterface::owlatArmSetToolAction, this, tool, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatArmSetTool, id,
+                     &OwlatInterface::owlatArmSetToolAction, this, tool, id);
 }
 
 void OwlatInterface::owlatArmSetToolAction (int tool, int id)
@@ -551,9 +552,8 @@ void OwlatInterface::owlatArmSetToolAction (int tool, int id)
 
 void OwlatInterface::owlatArmStop (int id)
 {
-  if (! markOperationRunning (Name_OwlatArmStop, id)) return;
-  thread action_thread (&OwlatInterface::owlatArmStopAction, this, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatArmStop, id, &OwlatInterface::owlatArmStopAction,
+                     this, id);
 }
 
 void OwlatInterface::owlatArmStopAction (int id)
@@ -573,9 +573,8 @@ void OwlatInterface::owlatArmStopAction (int id)
 
 void OwlatInterface::owlatArmTareFS (int id)
 {
-  if (! markOperationRunning (Name_OwlatArmTareFS, id)) return;
-  thread action_thread (&OwlatInterface::owlatArmTareFSAction, this, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatArmTareFS, id,
+                     &OwlatInterface::owlatArmTareFSAction, this, id);
 }
 
 void OwlatInterface::owlatArmTareFSAction (int id)
@@ -596,10 +595,9 @@ void OwlatInterface::owlatArmTareFSAction (int id)
 void OwlatInterface::owlatTaskDropoff (int frame, bool relative,
                                        const vector<double>& point, int id) 
 {
-  if (! markOperationRunning (Name_OwlatTaskDropoff, id)) return;
-  thread action_thread (&OwlatInterface::owlatTaskDropoffAction,
-                        this, frame, relative, point, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatTaskDropoff, id,
+                     &OwlatInterface::owlatTaskDropoffAction, this, frame,
+                     relative, point, id);
 }
 
 void OwlatInterface::owlatTaskDropoffAction (int frame, bool relative,
@@ -629,11 +627,9 @@ void OwlatInterface::owlatTaskPSP (int frame, bool relative,
                                    double max_depth,
                                    double max_force, int id) 
 {
-  if (! markOperationRunning (Name_OwlatTaskPSP, id)) return;
-  thread action_thread (&OwlatInterface::owlatTaskPSPAction,
-                        this, frame, relative, point, normal,
-                        max_depth, max_force, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatTaskPSP, id, &OwlatInterface::owlatTaskPSPAction,
+                     this, frame, relative, point, normal, max_depth, max_force,
+                     id);
 }
 
 void OwlatInterface::owlatTaskPSPAction (int frame, bool relative,
@@ -668,11 +664,9 @@ void OwlatInterface::owlatTaskScoop (int frame, bool relative,
                                      const vector<double>& point, 
                                      const vector<double>& normal, int id) 
 {
-  if (! markOperationRunning (Name_OwlatTaskPSP, id)) return;
-  thread action_thread (&OwlatInterface::owlatTaskScoopAction,
-                        this, frame, relative, point, normal,
-                        id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatTaskScoop, id,
+                     &OwlatInterface::owlatTaskScoopAction, this, frame,
+                     relative, point, normal, id);
 }
 
 void OwlatInterface::owlatTaskScoopAction (int frame, bool relative,
@@ -704,11 +698,9 @@ void OwlatInterface::owlatTaskShearBevameter (int frame, bool relative,
                                               double preload,
                                               double max_torque, int id) 
 {
-  if (! markOperationRunning (Name_OwlatTaskShearBevameter, id)) return;
-  thread action_thread (&OwlatInterface::owlatTaskShearBevameterAction,
-                        this, frame, relative, point, normal,
-                        preload, max_torque, id);
-  action_thread.detach();
+  dispatchOperation (Name_OwlatTaskShearBevameter, id,
+                     &OwlatInterface::owlatTaskShearBevameterAction, this,
+                     frame, relative, point, normal, preload, max_torque, id);
 }
 
 void OwlatInterface::owlatTaskShearBevameterAction (int frame, bool relative,
@@ -741,97 +733,139 @@ void OwlatInterface::owlatTaskShearBevameterAction (int frame, bool relative,
 }
 
 
+// Copy the values of a telemetry message into its preallocated array.  The
+// arrays are written only by the telemetry callbacks, which share one thread,
+// so they are published after the lock is released.
+template <class Values>
+static void update_array (RealArray& array, const Values& values)
+{
+  size_t count = std::min (array.size(), size_t (values.size()));
+  for (size_t i = 0; i < count; i++) array.setElement (i, values[i]);
+}
+
 void OwlatInterface::armJointAnglesCallback(const owlat_sim_msgs::ARM_JOINT_ANGLES::ConstPtr& msg)
 {
-  std::copy(msg->value.begin(), msg->value.end(), m_arm_joint_angles.begin()); 
-  publish("ArmJointAngles", m_arm_joint_angles);
+  {
+    lock_guard<mutex> lock (m_telemetryMutex);
+    update_array (m_arm_joint_angles, msg->value);
+  }
+  publish(m_armJointAnglesState, m_arm_joint_angles);
 }
 
 void OwlatInterface::armJointAccelerationsCallback(const owlat_sim_msgs::ARM_JOINT_ACCELERATIONS::ConstPtr& msg)
 {
-  std::copy(msg->value.begin(), msg->value.end(), m_arm_joint_accelerations.begin()); 
-  publish("ArmJointAccelerations", m_arm_joint_accelerations);
+  {
+    lock_guard<mutex> lock (m_telemetryMutex);
+    update_array (m_arm_joint_accelerations, msg->value);
+  }
+  publish(m_armJointAccelerationsState, m_arm_joint_accelerations);
 }
 
 void OwlatInterface::armJointTorquesCallback(const owlat_sim_msgs::ARM_JOINT_TORQUES::ConstPtr& msg)
 {
-  std::copy(msg->value.begin(), msg->value.end(), m_arm_joint_torques.begin()); 
-  publish("ArmJointTorques", m_arm_joint_torques);
+  {
+    lock_guard<mutex> lock (m_telemetryMutex);
+    update_array (m_arm_joint_torques, msg->value);
+  }
+  publish(m_armJointTorquesState, m_arm_joint_torques);
 }
 
 void OwlatInterface::armJointVelocitiesCallback(const owlat_sim_msgs::ARM_JOINT_VELOCITIES::ConstPtr& msg)
 {
-  std::copy(msg->value.begin(), msg->value.end(), m_arm_joint_velocities.begin()); 
-  publish("ArmJointVelocities", m_arm_joint_velocities);
+  {
+    lock_guard<mutex> lock (m_telemetryMutex);
+    update_array (m_arm_joint_velocities, msg->value);
+  }
+  publish(m_armJointVelocitiesState, m_arm_joint_velocities);
 }
 
 void OwlatInterface::armFTTorqueCallback(const owlat_sim_msgs::ARM_FT_TORQUE::ConstPtr& msg)
 {
-  std::copy(msg->value.begin(), msg->value.end(), m_arm_ft_torque.begin()); 
-  publish("ArmFTTorque", m_arm_ft_torque);
+  {
+    lock_guard<mutex> lock (m_telemetryMutex);
+    update_array (m_arm_ft_torque, msg->value);
+  }
+  publish(m_armFTTorqueState, m_arm_ft_torque);
 }
 
 void OwlatInterface::armFTForceCallback(const owlat_sim_msgs::ARM_FT_FORCE::ConstPtr& msg)
 {
-  std::copy(msg->value.begin(), msg->value.end(), m_arm_ft_force.begin()); 
-  publish("ArmFTForce", m_arm_ft_force);
+  {
+    lock_guard<mutex> lock (m_telemetryMutex);
+    update_array (m_arm_ft_force, msg->value);
+  }
+  publish(m_armFTForceState, m_arm_ft_force);
 }
 
 void OwlatInterface::armPoseCallback(const owlat_sim_msgs::ARM_POSE::ConstPtr& msg)
 {
-  m_arm_pose[0] = msg->value.position.x;
-  m_arm_pose[1] = msg->value.position.y;
-  m_arm_pose[2] = msg->value.position.z;
-  m_arm_pose[3] = msg->value.orientation.x;
-  m_arm_pose[4] = msg->value.orientation.y;
-  m_arm_pose[5] = msg->value.orientation.z;
-  m_arm_pose[6] = msg->value.orientation.w;
-  publish("ArmPose", m_arm_pose);
+  {
+    lock_guard<mutex> lock (m_telemetryMutex);
+    m_arm_pose.setElement (0, msg->value.position.x);
+    m_arm_pose.setElement (1, msg->value.position.y);
+    m_arm_pose.setElement (2, msg->value.position.z);
+    m_arm_pose.setElement (3, msg->value.orientation.x);
+    m_arm_pose.setElement (4, msg->value.orientation.y);
+    m_arm_pose.setElement (5, msg->value.orientation.z);
+    m_arm_pose.setElement (6, msg->value.orientation.w);
+  }
+  publish(m_armPoseState, m_arm_pose);
 }
 
 void OwlatInterface::armToolCallback(const owlat_sim_msgs::ARM_TOOL::ConstPtr& msg)
 {
-  m_arm_tool = msg->value.value;
-  publish("ArmTool", m_arm_tool);
+  {
+    lock_guard<mutex> lock (m_telemetryMutex);
+    m_arm_tool = msg->value.value;
+  }
+  publish(m_armToolState, m_arm_tool);
 }
 
 Value OwlatInterface::getArmJointAngles()
 {
+  lock_guard<mutex> lock (m_telemetryMutex);
   return(Value(m_arm_joint_angles));
 }
 
 Value OwlatInterface::getArmJointAccelerations()
 {
+  lock_guard<mutex> lock (m_telemetryMutex);
   return(Value(m_arm_joint_accelerations));
 }
 
 Value OwlatInterface::getArmJointTorques()
 {
+  lock_guard<mutex> lock (m_telemetryMutex);
   return(Value(m_arm_joint_torques));
 }
 
 Value OwlatInterface::getArmJointVelocities()
 {
+  lock_guard<mutex> lock (m_telemetryMutex);
   return(Value(m_arm_joint_velocities));
 }
 
 Value OwlatInterface::getArmFTTorque()
 {
+  lock_guard<mutex> lock (m_telemetryMutex);
   return(Value(m_arm_ft_torque));
 }
 
 Value OwlatInterface::getArmFTForce()
 {
+  lock_guard<mutex> lock (m_telemetryMutex);
   return(Value(m_arm_ft_force));
 }
 
 Value OwlatInterface::getArmPose()
 {
+  lock_guard<mutex> lock (m_telemetryMutex);
   return(Value(m_arm_pose));
 }
 
 Value OwlatInterface::getArmTool()
 {
+  lock_guard<mutex> lock (m_telemetryMutex);
   return(Value(m_arm_tool));
 }
 
@@ -9,11 +9,14 @@
 
 // C++
 #include <memory>
+#include <mutex>
 #include <ros/ros.h>
 
 // ow_plexil
 #include <Value.hh>
+#include <ArrayImpl.hh>
 #include "PlexilInterface.h"
+#include "CallbackGroup.h"
 
 // OWLAT Sim (installation required)
 #include <owlat_sim_msgs/ARM_UNSTOWAction.h>
@@ -81,7 +84,7 @@ class OwlatInterface : public PlexilInterface
  public:
   static OwlatInterface* instance();
   OwlatInterface() = default;
-  ~OwlatInterface() = default;
+  ~OwlatInterface();
   OwlatInterface (const OwlatInterface&) = delete;
   OwlatInterface& operator= (const OwlatInterface&) = delete;
 
@@ -177,6 +180,9 @@ class OwlatInterface : public PlexilInterface
   // node handle
   std::unique_ptr<ros::NodeHandle> m_genericNodeHandle;
 
+  // Arm telemetry callbacks, serviced by their own spinner thread.
+  std::unique_ptr<CallbackGroup> m_telemetryCallbacks;
+
   // Subscribers
   std::unique_ptr<ros::Subscriber> m_armJointAnglesSubscriber;
   std::unique_ptr<ros::Subscriber> m_armJointAccelerationsSubscriber;
@@ -214,15 +220,29 @@ class OwlatInterface : public PlexilInterface
   std::unique_ptr<OwlatTaskScoopActionClient> m_owlatTaskScoopClient;
   std::unique_ptr<OwlatTaskShearBevameterActionClient> m_owlatTaskShearBevameterClient;
 
-  // Member variables
-  vector<double> m_arm_joint_angles;
-  vector<double> m_arm_joint_accelerations;
-  vector<double> m_arm_joint_torques;
-  vector<double> m_arm_joint_velocities;
-  vector<double> m_arm_ft_torque;
-  vector<double> m_arm_ft_force;
-  vector<double> m_arm_pose;
+  // Member variables.  The telemetry values are written by the telemetry
+  // callbacks and read by the exec, so guarded by m_telemetryMutex.  The
+  // arrays are sized once and then updated in place, and are copied only
+  // into the values sent to the exec.
+  mutable std::mutex m_telemetryMutex;
+  PLEXIL::RealArray m_arm_joint_angles;
+  PLEXIL::RealArray m_arm_joint_accelerations;
+  PLEXIL::RealArray m_arm_joint_torques;
+  PLEXIL::RealArray m_arm_joint_velocities;
+  PLEXIL::RealArray m_arm_ft_torque;
+  PLEXIL::RealArray m_arm_ft_force;
+  PLEXIL::RealArray m_arm_pose;
   double m_arm_tool;
+
+  // The states of the values above, resolved by initialize().
+  StateHandle m_armJointAnglesState;
+  StateHandle m_armJointAccelerationsState;
+  StateHandle m_armJointTorquesState;
+  StateHandle m_armJointVelocitiesState;
+  StateHandle m_armFTTorqueState;
+  StateHandle m_armFTForceState;
+  StateHandle m_armPoseState;
+  StateHandle m_armToolState;
 };
 
 #endif
@@ -0,0 +1,138 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "PlanCache.h"
+
+// ROS
+#include <ros/ros.h>
+
+// PLEXIL
+#include "Error.hh"
+#include "parsePlan.hh"
+
+// POSIX
+#include <dirent.h>
+#include <sys/stat.h>
+
+using std::lock_guard;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+
+static bool same_time (const struct timespec& a, const struct timespec& b)
+{
+  return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+PlanCache::PlanCache (size_t capacity)
+  : m_capacity (capacity)
+{ }
+
+shared_ptr<pugi::xml_document> PlanCache::get (const string& path)
+{
+  struct stat info;
+  if (stat (path.c_str(), &info) != 0) {
+    // Forget a plan that has been removed.
+    lock_guard<mutex> lock (m_mutex);
+    auto it = m_index.find (path);
+    if (it != m_index.end()) {
+      m_entries.erase (it->second);
+      m_index.erase (it);
+    }
+    return nullptr;
+  }
+
+  {
+    lock_guard<mutex> lock (m_mutex);
+    auto it = m_index.find (path);
+    if (it != m_index.end()) {
+      Entry& entry = *it->second;
+      if (same_time (entry.mtime, info.st_mtim) && entry.size == info.st_size) {
+        m_entries.splice (m_entries.begin(), m_entries, it->second);
+        m_hits++;
+        return entry.doc;
+      }
+      // Changed on disk.
+      m_entries.erase (it->second);
+      m_index.erase (it);
+    }
+    m_misses++;
+  }
+
+  // Parse outside the lock; the document is owned by the cache from here on,
+  // whatever happens.
+  shared_ptr<pugi::xml_document> doc (PLEXIL::loadXmlFile (path));
+  if (! doc) return nullptr;
+
+  lock_guard<mutex> lock (m_mutex);
+  if (m_capacity == 0 || m_index.count (path)) return doc;
+  m_entries.push_front (Entry { path, info.st_mtim, info.st_size, doc });
+  m_index[path] = m_entries.begin();
+  evict();
+  return doc;
+}
+
+size_t PlanCache::preload (const string& directory)
+{
+  DIR* dir = opendir (directory.c_str());
+  if (! dir) {
+    ROS_ERROR ("Cannot preload plans, unable to open %s", directory.c_str());
+    return 0;
+  }
+  const string extension = ".plx";
+  size_t loaded = 0;
+  while (struct dirent* file = readdir (dir)) {
+    string name = file->d_name;
+    if (name.size() <= extension.size() ||
+        name.compare (name.size() - extension.size(), extension.size(),
+                      extension) != 0) {
+      continue;
+    }
+    if (loaded == m_capacity) {
+      ROS_WARN ("Plan cache full, not preloading the remaining plans.");
+      break;
+    }
+    try {
+      if (get (directory + name)) loaded++;
+    }
+    catch (PLEXIL::ParserException const &e) {
+      ROS_WARN ("Preload of PLEXIL plan %s failed: %s", name.c_str(), e.what());
+    }
+  }
+  closedir (dir);
+  return loaded;
+}
+
+void PlanCache::setCapacity (size_t capacity)
+{
+  lock_guard<mutex> lock (m_mutex);
+  m_capacity = capacity;
+  evict();
+}
+
+void PlanCache::evict ()
+{
+  while (m_entries.size() > m_capacity) {
+    m_index.erase (m_entries.back().path);
+    m_entries.pop_back();
+  }
+}
+
+size_t PlanCache::size () const
+{
+  lock_guard<mutex> lock (m_mutex);
+  return m_entries.size();
+}
+
+size_t PlanCache::hits () const
+{
+  lock_guard<mutex> lock (m_mutex);
+  return m_hits;
+}
+
+size_t PlanCache::misses () const
+{
+  lock_guard<mutex> lock (m_mutex);
+  return m_misses;
+}
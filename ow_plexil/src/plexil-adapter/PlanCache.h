@@ -0,0 +1,66 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Plan_Cache_H
+#define Plan_Cache_H
+
+// Least-recently-used cache of parsed PLEXIL plan files.  A cached plan is
+// reused as long as its file's modification time and size are unchanged, so
+// running the same plans repeatedly does not re-read and re-parse them.
+
+// PLEXIL
+#include <pugixml.hpp>
+
+// C++
+#include <sys/types.h>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class PlanCache
+{
+ public:
+  // A capacity of 0 disables caching.
+  explicit PlanCache (size_t capacity);
+  PlanCache (const PlanCache&) = delete;
+  PlanCache& operator= (const PlanCache&) = delete;
+
+  // The parsed plan in the given file, or null if the file does not exist.
+  // Throws PLEXIL::ParserException if the file cannot be parsed.
+  std::shared_ptr<pugi::xml_document> get (const std::string& path);
+
+  // Parse and cache every .plx file in the given directory, up to the
+  // capacity.  Returns the number of plans cached.
+  size_t preload (const std::string& directory);
+
+  void setCapacity (size_t capacity);
+
+  // Metrics
+  size_t size () const;
+  size_t hits () const;
+  size_t misses () const;
+
+ private:
+  struct Entry
+  {
+    std::string path;
+    struct timespec mtime;
+    off_t size;
+    std::shared_ptr<pugi::xml_document> doc;
+  };
+
+  void evict ();  // call with m_mutex held
+
+  size_t m_capacity;
+  std::list<Entry> m_entries;  // most recently used first
+  std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+  mutable std::mutex m_mutex;
+  size_t m_hits = 0;
+  size_t m_misses = 0;
+};
+
+#endif
@@ -4,68 +4,269 @@
 
 #include "PlexilInterface.h"
 #include "subscriber.h"
+#include "node_support.h"
+#include <chrono>
 
 using std::string;
+using std::vector;
 
-// Dummy operation ID that signifies idle lander operation.
-#define IDLE_ID (-1)
-
-PlexilInterface::PlexilInterface ()
-  : m_commandStatusCallback (nullptr)
+PlexilInterface::PlexilInterface (const string& lander)
+  : m_lander (lander),
+    m_statePrefix (lander.empty() ? "" : lander + "/"),
+    m_resourcesInUse (0),
+    m_connectionEnded (true),
+    m_stopConnecting (false),
+    m_commandStatusCallback (nullptr),
+    m_commandReturnCallback (nullptr),
+    m_commandStageCallback (nullptr)
 { }
 
 PlexilInterface::~PlexilInterface ()
 {
+  stopActionServerConnection();
+  for (const auto& op : m_operations) {
+    const OperationStats& stats = op.stats;
+    if (stats.completed == 0 && stats.rejected == 0) continue;
+    ROS_INFO ("%s: %zu completed (%zu failed), %zu rejected.", op.name.c_str(),
+              stats.completed, stats.failed, stats.rejected);
+  }
   // No memory leak, since memory wasn't allocated.
   m_commandStatusCallback = nullptr;
 }
 
+string PlexilInterface::topic (const string& name) const
+{
+  if (m_lander.empty()) return name;
+  string ns = "/" + m_lander;
+  return (! name.empty() && name[0] == '/') ? ns + name : ns + "/" + name;
+}
+
+StateHandle PlexilInterface::stateHandle (const string& state_name) const
+{
+  return StateHandle (m_statePrefix + state_name);
+}
+
+StateHandle PlexilInterface::stateHandle (const string& state_name,
+                                          const string& arg) const
+{
+  return StateHandle (m_statePrefix + state_name, arg);
+}
+
+int PlexilInterface::operationIndex (const string& name) const
+{
+  auto it = m_operationIndex.find (name);
+  return it == m_operationIndex.end() ? -1 : static_cast<int>(it->second);
+}
+
 bool PlexilInterface::isLanderOperation (const string& name) const
 {
-  return m_runningOperations.find(name) != m_runningOperations.end();
+  return operationIndex (name) >= 0;
 }
 
-bool PlexilInterface::markOperationRunning (const string& name, int id)
+bool PlexilInterface::admit (size_t index, int id)
 {
-  if (m_runningOperations.at (name) != IDLE_ID) {
-    ROS_WARN ("%s already running, ignoring duplicate request.", name.c_str());
+  Operation& op = m_operations[index];
+  if (op.id != IDLE_ID || (op.resources & m_resourcesInUse) ||
+      ! operationPermitted (index)) {
     return false;
   }
-  m_runningOperations.at (name) = id;
-  publish ("Running", true, name);
+  op.id = id;
+  op.stats.running = 1;
+  m_resourcesInUse |= op.resources;
   return true;
 }
 
-void PlexilInterface::markOperationFinished (const string& name, int id)
+void PlexilInterface::startOperation (const string& name, int id,
+                                      std::function<void()> start)
 {
-  if (! m_runningOperations.at (name) == IDLE_ID) {
-    ROS_WARN ("%s was not running. Should never happen.", name.c_str());
+  int index = operationIndex (name);
+  if (index < 0) {
+    ROS_ERROR ("startOperation: unknown operation %s", name.c_str());
+    rejectCommand (name, id);
+    return;
+  }
+  bool admitted;
+  {
+    std::lock_guard<std::mutex> lock (m_operationsMutex);
+    Operation& op = m_operations[index];
+    // A command may not overtake a queued one of its operation or needing any
+    // of its resources, even if what holds that one back has just cleared.
+    bool behind = queuedAhead (index);
+    admitted = ! behind && admit (index, id);
+    if (! admitted) {
+      if (op.stats.queued < op.queueLimit) {
+        m_pendingCommands.push_back (PendingCommand { size_t(index), id,
+                                                      std::move (start) });
+        op.stats.queued++;
+        ROS_INFO ("%s %s, queued request (%zu waiting).", name.c_str(),
+                  behind ? "behind queued requests" :
+                  operationPermitted (index) ? "busy" : "not permitted",
+                  op.stats.queued);
+        return;
+      }
+      op.stats.rejected++;
+      if (behind) {
+        ROS_WARN ("%s behind queued requests, rejecting request.",
+                  name.c_str());
+      }
+      else if (op.id != IDLE_ID) {
+        ROS_WARN ("%s already running, rejecting duplicate request.",
+                  name.c_str());
+      }
+      else if (! operationPermitted (index)) {
+        ROS_WARN ("%s not permitted at present, rejecting request.",
+                  name.c_str());
+      }
+      else {
+        for (const auto& other : m_operations) {
+          if (other.id != IDLE_ID && (other.resources & op.resources)) {
+            ROS_WARN ("%s conflicts with running %s, rejecting request.",
+                      name.c_str(), other.name.c_str());
+            break;
+          }
+        }
+      }
+    }
+  }
+  // Report or start outside the lock, since both call out.
+  if (! admitted) {
+    rejectCommand (name, id);
+    return;
   }
-  m_runningOperations.at (name) = IDLE_ID;
-  publish ("Running", false, name);
-  publish ("Finished", true, name);
+  publish (m_operations[index].running, true);
+  markCommandStage (id, CommandStage::Started);
+  start();
+}
+
+void PlexilInterface::rejectCommand (const string& name, int id)
+{
+  handleOperationFinished (name, id, false);
+  if (m_commandStatusCallback) m_commandStatusCallback (id, false);
+  else ROS_ERROR ("rejectCommand: m_commandStatusCallback was null!");
+}
+
+void PlexilInterface::markOperationFinished (const string& name, int id,
+                                             bool success)
+{
+  int index = operationIndex (name);
+  if (index < 0) {
+    ROS_ERROR ("markOperationFinished: unknown operation %s", name.c_str());
+    return;
+  }
+  vector<PendingCommand> admitted;
+  {
+    std::lock_guard<std::mutex> lock (m_operationsMutex);
+    Operation& op = m_operations[index];
+    if (op.id == IDLE_ID) {
+      ROS_WARN ("%s was not running. Should never happen.", name.c_str());
+    }
+    else {
+      m_resourcesInUse &= ~op.resources;
+      op.stats.running = 0;
+      op.stats.completed++;
+      if (!success) op.stats.failed++;
+    }
+    op.id = IDLE_ID;
+    admitted = takeAdmissible();
+  }
+  publish (m_operations[index].running, false);
+  publish (m_operations[index].finished, true);
+  if (!success) ROS_ERROR ("%s failed.", name.c_str());
+  handleOperationFinished (name, id, success);
   if (id != IDLE_ID) {
-    if (m_commandStatusCallback) m_commandStatusCallback (id, true);
+    if (m_commandStatusCallback) m_commandStatusCallback (id, success);
     else ROS_ERROR ("markOperationFinished: m_commandStatusCallback was null!");
   }
   else ROS_WARN ("markOperationFinished: %s was not running.", name.c_str());
+
+  startAdmitted (admitted);
 }
 
-bool PlexilInterface::running (const string& name) const
+vector<PlexilInterface::PendingCommand> PlexilInterface::takeAdmissible ()
 {
-  if (isLanderOperation (name)) {
-    return operationRunning (name);
+  // A command still waiting holds back later ones of its operation or needing
+  // any of its resources, as in startOperation.
+  vector<PendingCommand> admitted;
+  vector<bool> blocked_ops (m_operations.size(), false);
+  unsigned blocked_resources = 0;
+  for (auto it = m_pendingCommands.begin(); it != m_pendingCommands.end(); ) {
+    const Operation& op = m_operations[it->op];
+    if (! blocked_ops[it->op] && ! (op.resources & blocked_resources) &&
+        admit (it->op, it->id)) {
+      m_operations[it->op].stats.queued--;
+      admitted.push_back (std::move (*it));
+      it = m_pendingCommands.erase (it);
+    }
+    else {
+      blocked_ops[it->op] = true;
+      blocked_resources |= op.resources;
+      it++;
+    }
+  }
+  return admitted;
+}
+
+bool PlexilInterface::queuedAhead (size_t index) const
+{
+  unsigned resources = m_operations[index].resources;
+  for (const auto& pending : m_pendingCommands) {
+    if (pending.op == index ||
+        (m_operations[pending.op].resources & resources)) {
+      return true;
+    }
   }
-  else {
+  return false;
+}
+
+void PlexilInterface::startAdmitted (vector<PendingCommand>& admitted)
+{
+  for (auto& command : admitted) {
+    const Operation& op = m_operations[command.op];
+    ROS_INFO ("Starting queued %s.", op.name.c_str());
+    publish (op.running, true);
+    markCommandStage (command.id, CommandStage::Started);
+    command.start();
+  }
+}
+
+void PlexilInterface::admitPendingCommands ()
+{
+  vector<PendingCommand> admitted;
+  {
+    std::lock_guard<std::mutex> lock (m_operationsMutex);
+    admitted = takeAdmissible();
+  }
+  startAdmitted (admitted);
+}
+
+bool PlexilInterface::running (const string& name) const
+{
+  int index = operationIndex (name);
+  if (index < 0) {
     ROS_ERROR("PlexilInterface::running: unsupported operation: %s", name.c_str());
     return false;
   }
+  return runningOperationId (index) != IDLE_ID;
 }
 
-bool PlexilInterface::operationRunning (const string& name) const
+int PlexilInterface::runningOperationId (const string& name) const
 {
-  // Note: check in caller guarantees 'at' to return a valid value.
-  return m_runningOperations.at (name) != IDLE_ID;
+  int index = operationIndex (name);
+  return index < 0 ? IDLE_ID : runningOperationId (index);
+}
+
+int PlexilInterface::runningOperationId (size_t op) const
+{
+  std::lock_guard<std::mutex> lock (m_operationsMutex);
+  return m_operations.at (op).id;
+}
+
+OperationStats PlexilInterface::operationStats (const string& name) const
+{
+  int index = operationIndex (name);
+  if (index < 0) return OperationStats();
+  std::lock_guard<std::mutex> lock (m_operationsMutex);
+  return m_operations[index].stats;
 }
 
 void PlexilInterface::setCommandStatusCallback (void (*callback) (int, bool))
@@ -73,7 +274,261 @@ void PlexilInterface::setCommandStatusCallback (void (*callback) (int, bool))
   m_commandStatusCallback = callback;
 }
 
-void PlexilInterface::registerLanderOperation (const string& name)
+void PlexilInterface::setCommandReturnCallback
+(void (*callback) (int, const std::vector<double>&))
+{
+  m_commandReturnCallback = callback;
+}
+
+void PlexilInterface::returnCommandValue (int id,
+                                          const std::vector<double>& value)
+{
+  if (m_commandReturnCallback) m_commandReturnCallback (id, value);
+  else ROS_ERROR ("returnCommandValue: m_commandReturnCallback was null!");
+}
+
+void PlexilInterface::setCommandStageCallback
+(void (*callback) (int, CommandStage))
 {
-  m_runningOperations[name] = IDLE_ID;
+  m_commandStageCallback = callback;
+}
+
+void PlexilInterface::markCommandStage (int id, CommandStage stage)
+{
+  // Optional, so a missing callback is not an error.
+  if (m_commandStageCallback) m_commandStageCallback (id, stage);
+}
+
+size_t PlexilInterface::actionQueueDepth () const
+{
+  return m_actionWorkers.queueDepth();
+}
+
+size_t PlexilInterface::peakActionQueueDepth () const
+{
+  return m_actionWorkers.peakQueueDepth();
+}
+
+void PlexilInterface::startActionServerConnection ()
+{
+  if (m_connectionThread.joinable()) return;
+  m_stopConnecting = false;
+  {
+    std::lock_guard<std::mutex> lock (m_deferredGoalsMutex);
+    m_connectionEnded = false;
+  }
+  m_connectionThread = std::thread (&PlexilInterface::connectActionServers,
+                                    this);
+}
+
+void PlexilInterface::stopActionServerConnection ()
+{
+  m_stopConnecting = true;
+  if (m_connectionThread.joinable()) m_connectionThread.join();
+}
+
+bool PlexilInterface::deferGoal (std::function<bool()> connected,
+                                 std::function<void(bool)> resume)
+{
+  std::lock_guard<std::mutex> lock (m_deferredGoalsMutex);
+  if (m_connectionEnded) return false;
+  m_deferredGoals.push_back (DeferredGoal { std::move (connected),
+                                            std::move (resume) });
+  return true;
+}
+
+bool PlexilInterface::resumeDeferredGoals (bool end)
+{
+  // Resumes the goals whose servers have connected, or all of them when the
+  // connection ends.  Returns whether any are still waiting.
+  vector<std::pair<std::function<void(bool)>, bool>> ready;
+  bool waiting = false;
+  {
+    std::lock_guard<std::mutex> lock (m_deferredGoalsMutex);
+    if (end) m_connectionEnded = true;
+    for (auto it = m_deferredGoals.begin(); it != m_deferredGoals.end(); ) {
+      bool connected = it->connected();
+      if (connected || end) {
+        ready.emplace_back (std::move (it->resume), connected);
+        it = m_deferredGoals.erase (it);
+      }
+      else {
+        waiting = true;
+        it++;
+      }
+    }
+  }
+  for (auto& goal : ready) {
+    auto resume = std::move (goal.first);
+    bool connected = goal.second;
+    m_actionWorkers.enqueue ([resume, connected] () { resume (connected); });
+  }
+  return waiting;
+}
+
+void PlexilInterface::connectActionServers ()
+{
+  // The clients connect on their own spin threads; this only watches them
+  // until all are connected or the deadline passes.
+  const auto poll_period = std::chrono::milliseconds (50);
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + std::chrono::duration<double>
+    (ACTION_SERVER_TIMEOUT_SECS);
+  vector<bool> connected (m_actionServers.size(), false);
+  size_t remaining = m_actionServers.size();
+  bool waiting = true;
+  while ((remaining > 0 || waiting) && ! m_stopConnecting &&
+         std::chrono::steady_clock::now() < deadline) {
+    for (size_t i = 0; i < m_actionServers.size(); i++) {
+      if (! connected[i] && m_actionServers[i].second()) {
+        connected[i] = true;
+        remaining--;
+      }
+    }
+    waiting = resumeDeferredGoals (false);
+    if (remaining > 0 || waiting) std::this_thread::sleep_for (poll_period);
+  }
+  resumeDeferredGoals (true);
+  if (m_stopConnecting) return;
+
+  for (size_t i = 0; i < m_actionServers.size(); i++) {
+    if (! connected[i]) {
+      ROS_ERROR ("%s action server did not connect!",
+                 m_actionServers[i].first.c_str());
+    }
+  }
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  ROS_INFO ("%zu of %zu action servers connected after %.2f seconds.",
+            m_actionServers.size() - remaining, m_actionServers.size(),
+            elapsed.count());
+}
+
+void PlexilInterface::startActionWorkers ()
+{
+  int workers;
+  private_node_handle().param ("action_worker_threads", workers,
+                               DEFAULT_ACTION_WORKER_THREADS);
+  if (workers < 1) {
+    ROS_WARN ("Invalid ~action_worker_threads %d, using 1.", workers);
+    workers = 1;
+  }
+  m_actionWorkers.start (workers);
+  ROS_INFO ("Dispatching lander operations with %d worker thread(s).", workers);
+}
+
+vector<size_t> PlexilInterface::matchOperations (const string& key) const
+{
+  vector<size_t> matches;
+  for (size_t i = 0; i < m_operations.size(); i++) {
+    const string& name = m_operations[i].name;
+    size_t slash = name.rfind ('/');
+    if (name == key ||
+        (slash != string::npos && name.substr (slash + 1) == key)) {
+      matches.push_back (i);
+    }
+  }
+  return matches;
+}
+
+void PlexilInterface::loadOperationTimeouts ()
+{
+  std::map<string, double> timeouts;
+  if (! private_node_handle().getParam ("operation_timeouts", timeouts)) return;
+
+  for (const auto& entry : timeouts) {
+    vector<size_t> ops = matchOperations (entry.first);
+    if (ops.empty()) {
+      ROS_WARN ("~operation_timeouts: unknown operation %s, ignoring.",
+                entry.first.c_str());
+    }
+    for (size_t op : ops) {
+      setOperationTimeout (m_operations[op].name, entry.second);
+    }
+  }
+}
+
+void PlexilInterface::loadOperationQueueLimits ()
+{
+  std::map<string, int> limits;
+  if (! private_node_handle().getParam ("operation_queue_limits", limits)) {
+    return;
+  }
+
+  for (const auto& entry : limits) {
+    vector<size_t> ops = matchOperations (entry.first);
+    if (ops.empty()) {
+      ROS_WARN ("~operation_queue_limits: unknown operation %s, ignoring.",
+                entry.first.c_str());
+    }
+    if (entry.second < 0) {
+      ROS_WARN ("~operation_queue_limits: invalid limit %d for %s, ignoring.",
+                entry.second, entry.first.c_str());
+      continue;
+    }
+    for (size_t op : ops) {
+      ROS_INFO ("%s will queue up to %d commands.",
+                m_operations[op].name.c_str(), entry.second);
+      m_operations[op].queueLimit = entry.second;
+    }
+  }
+}
+
+void PlexilInterface::setOperationTimeout (const string& name, double seconds)
+{
+  ROS_INFO ("%s will time out after %.1f seconds.", name.c_str(), seconds);
+  m_operationTimeouts[name] = seconds;
+}
+
+double PlexilInterface::operationTimeout (const string& name) const
+{
+  auto it = m_operationTimeouts.find (name);
+  return it == m_operationTimeouts.end() ? 0 : it->second;
+}
+
+void PlexilInterface::startActionTimeout (int id, double seconds,
+                                          std::function<void()> on_timeout)
+{
+  std::lock_guard<std::mutex> lock (m_actionTimersMutex);
+  const bool oneshot = true;
+  m_actionTimers[id] = ros::NodeHandle().createTimer
+    (ros::Duration (seconds),
+     [this, id, on_timeout] (const ros::TimerEvent&) {
+      on_timeout();
+      // A one-shot timer needs no stopping, and stopping it from its own
+      // callback would wait on the thread finishing the goal, if that is
+      // stopping it too.
+      std::lock_guard<std::mutex> lock (m_actionTimersMutex);
+      m_actionTimers.erase (id);
+    },
+     oneshot);
+}
+
+void PlexilInterface::stopActionTimeout (int id)
+{
+  // The timer is stopped outside the lock, since stopping waits for its
+  // callback to return, which takes the lock.
+  ros::Timer timer;
+  {
+    std::lock_guard<std::mutex> lock (m_actionTimersMutex);
+    auto it = m_actionTimers.find (id);
+    if (it == m_actionTimers.end()) return;
+    timer = std::move (it->second);
+    m_actionTimers.erase (it);
+  }
+  timer.stop();
+}
+
+void PlexilInterface::registerLanderOperation (const string& name,
+                                               unsigned resources)
+{
+  if (isLanderOperation (name)) {
+    ROS_ERROR ("Lander operation %s registered twice.", name.c_str());
+    return;
+  }
+  m_operationIndex[name] = m_operations.size();
+  m_operations.push_back (Operation { name, resources, IDLE_ID, 0,
+                                      OperationStats(),
+                                      stateHandle ("Running", name),
+                                      stateHandle ("Finished", name) });
 }
@@ -9,36 +9,179 @@
 // simulators and testbeds.
 
 #include "action_support.h"
+#include "CommandLatency.h"
+#include "FlightRecorder.h"
+#include "ThreadPool.h"
+#include "subscriber.h"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Dummy operation ID that signifies idle lander operation.
+#define IDLE_ID (-1)
+
+// Counts of the instances of a lander operation.
+struct OperationStats
+{
+  size_t queued = 0;     // waiting to be admitted
+  size_t running = 0;    // 0 or 1
+  size_t completed = 0;  // finished, successfully or not
+  size_t failed = 0;     // of the completed, those that failed
+  size_t rejected = 0;   // never admitted
+};
 
 class PlexilInterface
 {
  public:
-  PlexilInterface ();
+  // The lander is named by its ROS namespace, which is empty for the default
+  // lander.
+  explicit PlexilInterface (const std::string& lander = "");
   virtual ~PlexilInterface () = 0;
   PlexilInterface (const PlexilInterface&) = delete;
   PlexilInterface& operator= (const PlexilInterface&) = delete;
 
+  const std::string& lander () const { return m_lander; }
+
   // Is the given operation (as named in the subclass) running?
   bool running (const std::string& name) const;
 
   // Is the given operation name valid?
   bool isLanderOperation (const std::string& name) const;
 
-  bool markOperationRunning (const std::string& name, int id);
-  void markOperationFinished (const std::string& name, int id);
+  void markOperationFinished (const std::string& name, int id,
+                              bool success = true);
+
+  OperationStats operationStats (const std::string& name) const;
 
   // Command feedback
   void setCommandStatusCallback (void (*callback) (int, bool));
+  void setCommandReturnCallback
+    (void (*callback) (int, const std::vector<double>&));
+  void setCommandStageCallback (void (*callback) (int, CommandStage));
+
+  // Action dispatch metrics
+  size_t actionQueueDepth () const;
+  size_t peakActionQueueDepth () const;
 
  protected:
-  bool operationRunning (const std::string& name) const;
-  void registerLanderOperation (const std::string& name);
+  // The given topic or action name, in the lander's namespace.  Names are
+  // unchanged for the default lander; otherwise e.g. /joint_states becomes
+  // /lander2/joint_states.
+  std::string topic (const std::string& name) const;
+
+  // The handle by which to publish a state of the lander (see subscriber.h),
+  // with an optional string parameter.  The state names of a lander other
+  // than the default are qualified by its namespace, e.g.
+  // lander2/StateOfCharge, so that the landers' states are distinct.
+  // Resolve each state once, at setup, not for each publication.
+  StateHandle stateHandle (const std::string& state_name) const;
+  StateHandle stateHandle (const std::string& state_name,
+                           const std::string& arg) const;
+
+  // Add the next operation to the table, needing the given resources (a
+  // bitmask defined by the subclass) exclusively.  Operations are indexed in
+  // order of registration, so that subclasses can refer to them by a dense
+  // enum.  Call only during initialization.
+  void registerLanderOperation (const std::string& name,
+                                unsigned resources = 0);
+
+  // Start the given command's instance of the operation by calling start.  An
+  // operation is admitted only if no instance of it is running, and none of
+  // the resources it needs is held by another running operation.  Otherwise
+  // the command waits in the operation's queue, if it has one with room, and
+  // is started when admissible; or else fails without running.
+  void startOperation (const std::string& name, int id,
+                       std::function<void()> start);
+
+  // As above, starting the operation by running the given action invocation
+  // on an action worker.  Arguments are copied, as with std::thread.
+  template <class F, class... Args>
+    void dispatchOperation (const std::string& name, int id,
+                            F&& f, Args&&... args)
+  {
+    auto action = std::bind (std::forward<F>(f), std::forward<Args>(args)...);
+    startOperation (name, id, [this, action] () {
+      m_actionWorkers.enqueue (action);
+    });
+  }
+
+  // Whether the operation with the given index (in order of registration) may
+  // be admitted now, besides its resources, e.g. given the power budget.  A
+  // command of an operation not permitted waits in its queue, as for a busy
+  // one, or fails.  Called with the operations locked, so must not call back
+  // into this class.
+  virtual bool operationPermitted (size_t op) const { return true; }
+
+  // Start the queued commands that can now be admitted.  Call when an
+  // operation becomes permitted; operations finishing do this themselves.
+  void admitPendingCommands ();
 
-  // Map from operation name to its instance ID if it is running, or to IDLE_ID
-  // otherwise.  The keys of this map do not change after initialization, and
-  // comprise all the valid lander operation names.
-  std::map<std::string, int> m_runningOperations;
+  // Called by markOperationFinished before the command's status is reported,
+  // and for a command that failed without running, so that subclasses can
+  // e.g. return a value for the command.
+  virtual void handleOperationFinished (const std::string& name, int id,
+                                        bool success) { }
 
+  // Send the return value of the given command to the exec.
+  void returnCommandValue (int id, const std::vector<double>& value);
+
+  // Record that the given command reached the given stage, for latency
+  // measurement.
+  void markCommandStage (int id, CommandStage stage);
+
+  // ID of the running instance of the given operation, or IDLE_ID.
+  int runningOperationId (const std::string& name) const;
+  int runningOperationId (size_t op) const;
+
+  // Start the workers that dispatch lander operations, sized by the private
+  // ROS parameter ~action_worker_threads.
+  void startActionWorkers ();
+
+  // Read per-operation action timeouts (seconds) from the private ROS
+  // parameter ~operation_timeouts, a map keyed by operation name or by the last
+  // component of it.  Operations without a timeout wait indefinitely.
+  void loadOperationTimeouts ();
+  void setOperationTimeout (const std::string& name, double seconds);
+
+  // Read per-operation queue limits from the private ROS parameter
+  // ~operation_queue_limits, keyed as above.  Operations without a limit have
+  // no queue, so that a command sent while its operation cannot be admitted
+  // fails.
+  void loadOperationQueueLimits ();
+
+  // Workers that run the action invocations of lander operations.
+  ThreadPool m_actionWorkers;
+
+  // Action servers are connected in the background, so that the exec can
+  // serve lookups and other commands meanwhile.  Add the clients, then start
+  // the connection, which waits for all servers concurrently for at most
+  // ACTION_SERVER_TIMEOUT_SECS overall and logs those that did not connect.
+  // A goal sent before its server connects is deferred until it does, without
+  // holding an action worker, and fails if it has not when the connection
+  // ends.  Subclasses must stop the connection before destroying their
+  // clients.
+  template <class ActionClient>
+    void addActionServer (const std::string& name,
+                          const std::unique_ptr<ActionClient>& ac)
+  {
+    ActionClient* client = ac.get();
+    m_actionServers.emplace_back
+      (name, [client] () { return client->isServerConnected(); });
+  }
+  void startActionServerConnection ();
+  void stopActionServerConnection ();
+
+  // Send the goal and return.  The operation is marked finished from the
+  // action's done callback, so no thread waits on its result.  The command
+  // succeeds only if the goal does; a goal that outlasts the operation's
+  // timeout is canceled and its command fails.
   template <class ActionClient, class Goal, class ResultPtr, class FeedbackPtr>
     void runAction (const std::string& opname,
                     std::unique_ptr<ActionClient>& ac,
@@ -48,24 +191,177 @@ class PlexilInterface
                     t_action_feedback_cb<FeedbackPtr> feedback_cb,
                     t_action_done_cb<ResultPtr> done_cb)
   {
-    if (ac) {
-      ROS_INFO ("Sending goal to action %s", opname.c_str());
-      ac->sendGoal (goal, done_cb, active_cb, feedback_cb);
-      ROS_INFO ("Sent goal to action %s", opname.c_str());
-    }
-    else {
+    if (! ac) {
       ROS_ERROR ("%s action client was null!", opname.c_str());
+      markOperationFinished (opname, id, false);
       return;
     }
 
-    // Wait indefinitely for the action to complete.
-    bool finished_before_timeout = ac->waitForResult (ros::Duration (0));
-    markOperationFinished (opname, id);
+    // Set by whichever of the done callback and the timeout comes first.
+    auto finished = std::make_shared<std::atomic<bool>>(false);
+
+    auto finish_cb = [this, opname, id, done_cb, finished]
+      (const actionlib::SimpleClientGoalState& state, const ResultPtr& result)
+    {
+      if (finished->exchange (true)) return;  // already timed out
+      flight_record (FlightEventType::ActionDone, opname, id,
+                     std::numeric_limits<double>::quiet_NaN(), state.state_);
+      if (done_cb) done_cb (state, result);
+      stopActionTimeout (id);
+      markOperationFinished
+        (opname, id, state == actionlib::SimpleClientGoalState::SUCCEEDED);
+    };
+
+    if (! ac->isServerConnected()) {
+      ActionClient* client = ac.get();
+      auto connected = [client] () { return client->isServerConnected(); };
+      auto resume = [this, opname, &ac, goal, id, active_cb, feedback_cb,
+                     done_cb] (bool connected) {
+        if (connected) {
+          runAction<ActionClient, Goal, ResultPtr, FeedbackPtr>
+            (opname, ac, goal, id, active_cb, feedback_cb, done_cb);
+        }
+        else {
+          ROS_ERROR ("%s action server is not connected!", opname.c_str());
+          markOperationFinished (opname, id, false);
+        }
+      };
+      if (! deferGoal (connected, resume)) resume (false);
+      return;
+    }
+
+    auto stage_active_cb = [this, opname, id, active_cb] () {
+      flight_record (FlightEventType::ActionActive, opname, id);
+      markCommandStage (id, CommandStage::Active);
+      if (active_cb) active_cb();
+    };
+
+    // Goals are in the flight recorder, so are logged only for debugging.
+    ROS_DEBUG ("Sending goal to action %s", opname.c_str());
+    flight_record (FlightEventType::ActionGoalSent, opname, id);
+    markCommandStage (id, CommandStage::GoalSent);
+    ac->sendGoal (goal, finish_cb, stage_active_cb, feedback_cb);
+
+    double timeout = operationTimeout (opname);
+    if (timeout > 0) {
+      ActionClient* client = ac.get();
+      startActionTimeout (id, timeout, [this, opname, id, timeout, finished,
+                                        client] () {
+        if (finished->exchange (true)) return;  // already done
+        flight_record (FlightEventType::ActionTimedOut, opname, id, timeout);
+        ROS_ERROR ("%s timed out after %.1f seconds, canceling goal.",
+                   opname.c_str(), timeout);
+        client->cancelGoal();
+        markOperationFinished (opname, id, false);
+      });
+    }
   }
 
  private:
+  const std::string m_lander;
+  const std::string m_statePrefix;  // e.g. "lander2/", or empty
+
+  struct Operation
+  {
+    std::string name;
+    unsigned resources;
+    int id;  // of the running instance, or IDLE_ID
+    size_t queueLimit;
+    OperationStats stats;
+    StateHandle running, finished;  // of the operation's name
+  };
+
+  // A command waiting for its operation to be admitted.
+  struct PendingCommand
+  {
+    size_t op;
+    int id;
+    std::function<void()> start;
+  };
+
+  // Index of the named operation, or -1 if there is none.
+  int operationIndex (const std::string& name) const;
+
+  // Indices of the operations with the given name or last name component.
+  std::vector<size_t> matchOperations (const std::string& key) const;
+
+  // Admit the command if its operation allows.  Call with the mutex locked.
+  bool admit (size_t op, int id);
+
+  // Whether a queued command is of the operation or needs any of its
+  // resources.  Call with the mutex locked.
+  bool queuedAhead (size_t op) const;
+
+  // Take the queued commands that can now be admitted, in order of arrival.
+  // Call with the mutex locked.
+  std::vector<PendingCommand> takeAdmissible ();
+
+  // Start the commands taken above.  Call with the mutex unlocked.
+  void startAdmitted (std::vector<PendingCommand>& admitted);
+
+  // Report a command that failed without running.
+  void rejectCommand (const std::string& name, int id);
+
+  // The lander operations, by index.  The table and index do not change after
+  // initialization.  The operation state is updated from the exec, action and
+  // subscriber threads, so is guarded by the mutex.
+  std::vector<Operation> m_operations;
+  std::unordered_map<std::string, size_t> m_operationIndex;
+  unsigned m_resourcesInUse;
+  mutable std::mutex m_operationsMutex;
+
+  // Queued commands of all operations, in order of arrival, guarded by
+  // m_operationsMutex.  A command is admitted only after all earlier ones of
+  // its operation or needing any of its resources, so each operation's
+  // commands, and those contending for each resource, form a FIFO.
+  std::deque<PendingCommand> m_pendingCommands;
+
+  void connectActionServers ();
+
+  // Have the connection call resume on an action worker, with true once the
+  // server is connected, or false if the connection ends first.  False, with
+  // resume not called, if the connection has ended already.
+  bool deferGoal (std::function<bool()> connected,
+                  std::function<void(bool)> resume);
+  bool resumeDeferredGoals (bool end);
+
+  struct DeferredGoal
+  {
+    std::function<bool()> connected;
+    std::function<void(bool)> resume;
+  };
+
+  // Goals waiting for their servers, guarded by m_deferredGoalsMutex, as is
+  // whether the connection has ended (or not started).
+  std::vector<DeferredGoal> m_deferredGoals;
+  bool m_connectionEnded;
+  std::mutex m_deferredGoalsMutex;
+
+  // Names of the action servers to connect, and whether they are.
+  std::vector<std::pair<std::string, std::function<bool()>>> m_actionServers;
+  std::thread m_connectionThread;
+  std::atomic<bool> m_stopConnecting;
+
+  double operationTimeout (const std::string& name) const;
+  void startActionTimeout (int id, double seconds,
+                           std::function<void()> on_timeout);
+  void stopActionTimeout (int id);
+
+  // Action timeouts in seconds, by operation name.
+  std::map<std::string, double> m_operationTimeouts;
+
+  // Pending timeout timers of running actions, by command ID.
+  std::map<int, ros::Timer> m_actionTimers;
+  std::mutex m_actionTimersMutex;
+
   // Callback function in PLEXIL adapter for success/failure of given command.
   std::function<void(int, bool)> m_commandStatusCallback;
+
+  // Callback function in PLEXIL adapter for the return value of given command.
+  std::function<void(int, const std::vector<double>&)> m_commandReturnCallback;
+
+  // Callback function in PLEXIL adapter for the stages of given command.
+  std::function<void(int, CommandStage)> m_commandStageCallback;
 };
 
 #endif
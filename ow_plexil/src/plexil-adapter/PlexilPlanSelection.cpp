@@ -4,134 +4,232 @@
 
 #include "PlexilPlanSelection.h"
 #include "OwExecutive.h"
+#include "adapter_support.h"
+#include "CheckpointJournal.h"
+#include <chrono>
+#include <sstream>
 #include <string>
 #include <std_msgs/String.h>
 
+using Clock = std::chrono::steady_clock;
+
+// How long to wait for a new plan to be registered as running.
+static const auto PlanStartTimeout = std::chrono::seconds(3);
+
+// How often waits check whether the node is shutting down.
+static const auto ShutdownCheckPeriod = std::chrono::seconds(1);
+
+PlexilPlanSelection::~PlexilPlanSelection()
+{
+  OwExecutive::instance()->setStepCallback(nullptr);
+}
+
 void PlexilPlanSelection::initialize(std::string initial_plan)
 {
   ROS_INFO("Starting PLEXIL executive node...");
   m_genericNodeHandle = std::make_unique<ros::NodeHandle>();
 
-  // wait for the first proper clock message before running the plan
+  // wait for the first proper clock message before running the plan.  The
+  // clock is received by the node's global spinner.
   ros::Rate warmup_rate(0.1);
   ros::Time begin = ros::Time::now();
   while (ros::Time::now() - begin == ros::Duration(0.0))
   {
-    ros::spinOnce();
     warmup_rate.sleep();
   }
 
   // if launch argument plan is given we add it
   if(initial_plan.compare("None") != 0) {
-    plan_array.push_back(initial_plan);
+    m_plans.push_back(initial_plan);
   }
-  //workaround for the getPlanState not returning correctly for first plan
-  m_first_plan = true;
+
+  //wake the scheduler after every exec step, so it sees plans start and
+  //finish as soon as they do
+  OwExecutive::instance()->setStepCallback([this]() {
+    { std::lock_guard<std::mutex> lock(m_planMutex); }
+    m_planCondition.notify_all();
+  });
 
   //initialize service
+  m_serviceCallbacks = std::make_unique<CallbackGroup>("plan selection");
   m_planSelectionService = std::make_unique<ros::ServiceServer>
-      (m_genericNodeHandle->
+      (m_serviceCallbacks->nodeHandle().
        advertiseService("/plexil_plan_selection",
        &PlexilPlanSelection::planSelectionServiceCallback, this));
+  m_serviceCallbacks->start();
 
   //initialize publisher
   m_planSelectionStatusPublisher = std::make_unique<ros::Publisher>
       (m_genericNodeHandle->advertise<std_msgs::String>
        ("/plexil_plan_selection_status", 20));
+  m_planStatisticsPublisher = std::make_unique<ros::Publisher>
+      (m_genericNodeHandle->advertise<std_msgs::String>
+       ("/plexil_plan_statistics", 20));
 
   ROS_INFO("Executive node started, ready for PLEXIL plans.");
 }
 
 void PlexilPlanSelection::start()
 {
-  ros::Rate rate(10); // 10 Hz for overall rate we are spinning
-  int length = 0;
-  while(ros::ok()){
-    //if we have plans in our plan array we begin the control loop
-    if(plan_array.size() > 0){
-      length = plan_array.size();
-      for(int i = 0; i < length; i++){
-        //trys to run the current plan
-        runCurrentPlan();
-        //waits until plan finishes running
-        waitForPlan();
-        //checks if plan_array has been cleared
-        if(plan_array.size() == 0){
-          break;
-        }
-      }
+  std::string plan;
+  //runs plans one at a time until shutdown
+  while(nextPlan(plan)){
+    //trys to run the current plan, and waits until it finishes
+    ExecCounters start = execCounters();
+    g_checkpoints.planStarted(plan);
+    bool ran = runCurrentPlan(plan);
+    if(ran){
+      waitForPlan(plan);
     }
-    //if no plans we spinonce and sleep before checking again
-    ros::spinOnce();
-    rate.sleep();
+    g_checkpoints.planFinished(plan, ran);
+    publishStatistics(plan, ran, start);
+    //set status to complete for GUI, whether or not the plan ran
+    publishStatus("COMPLETE");
   }
 }
 
-void PlexilPlanSelection::waitForPlan(){
-  std_msgs::String status;
-  ros::Rate rate(10); // 10 Hz for overall rate we are spinning
-  //wait for current plan to finish before running next plan
-  while(!OwExecutive::instance()->getPlanState() && m_first_plan == false){
-    ros::spinOnce();
-    rate.sleep();
+void PlexilPlanSelection::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_planMutex);
+    m_stopping = true;
   }
+  m_planCondition.notify_all();
+}
 
-  //Once plan is finished set status to complete for GUI
-  status.data = "COMPLETE";
-  m_planSelectionStatusPublisher->publish(status);
+bool PlexilPlanSelection::running() const
+{
+  return ros::ok() && !m_stopping;
 }
 
-void PlexilPlanSelection::runCurrentPlan(){
-  std_msgs::String status;
-  ros::Rate rate(10); // 10 Hz for overall rate we are spinning
-  //try to run the plan
-  if(OwExecutive::instance()->runPlan(plan_array[0].c_str())){
-    //workaround for getPlanState not working on first plan
-    if(m_first_plan == true){
-      m_first_plan = false;
+bool PlexilPlanSelection::nextPlan(std::string& plan)
+{
+  //removes the next plan from the queue, waiting for one if needed; returns
+  //false on shutdown or stop
+  std::unique_lock<std::mutex> lock(m_planMutex);
+  while(m_plans.empty() || m_stopping){
+    if(!running()){
+      return false;
     }
-    // Times out after 3 seconds or the plan is registered as running.
-    int timeout = 0;
-    while(OwExecutive::instance()->getPlanState() && timeout < 30){
-      ros::spinOnce();
-      rate.sleep();
-      timeout+=1;
-      if(timeout % 10 == 0){
-        ROS_ERROR("Plan not responding, timing out in %i seconds", (3 - timeout/10));
-      }
+    m_planCondition.wait_for(lock, ShutdownCheckPeriod);
+  }
+  plan = m_plans.front();
+  m_plans.pop_front();
+  return true;
+}
+
+bool PlexilPlanSelection::waitForStep(unsigned long seen,
+                                      Clock::time_point deadline)
+{
+  //returns false if no exec step completed after the one counted in seen
+  //before the deadline
+  OwExecutive* exec = OwExecutive::instance();
+  std::unique_lock<std::mutex> lock(m_planMutex);
+  return m_planCondition.wait_until(lock, deadline, [exec, seen]() {
+    return exec->stepCount() != seen;
+  });
+}
+
+void PlexilPlanSelection::waitForPlan(const std::string& plan)
+{
+  //wait for current plan to finish before running next plan.  The step count
+  //is read before the plan state, so that a step in between is not missed.
+  OwExecutive* exec = OwExecutive::instance();
+  while(running()){
+    unsigned long seen = exec->stepCount();
+    if(exec->getPlanState()){
+      ROS_INFO("Plan %s finished.", plan.c_str());
+      return;
+    }
+    waitForStep(seen, Clock::now() + ShutdownCheckPeriod);
+  }
+}
+
+bool PlexilPlanSelection::runCurrentPlan(const std::string& plan)
+{
+  OwExecutive* exec = OwExecutive::instance();
+  //try to run the plan; if error from run() we set as failed for GUI
+  if(!exec->runPlan(plan.c_str())){
+    publishStatus("FAILED:" + plan);
+    return false;
+  }
+
+  //wait until the plan is registered as running.  Adding the plan is
+  //serialized with exec steps, so any step counted after this point has seen
+  //it; if the plan is finished after such a step, it ran within the step.
+  unsigned long submitted = exec->stepCount();
+  Clock::time_point deadline = Clock::now() + PlanStartTimeout;
+  while(true){
+    unsigned long seen = exec->stepCount();
+    if(!exec->getPlanState() || seen != submitted){
+      publishStatus("SUCCESS:" + plan);
+      return true;
     }
+    if(!waitForStep(seen, deadline)){
       //if timed out we set plan as failed for GUI
-      if(timeout == 30){
-        ROS_INFO ("Plan timed out, try again.");
-        status.data = "FAILED:" + plan_array[0];
-        m_planSelectionStatusPublisher->publish(status);
-      }
-      //otherwise we set it as running
-      else{
-          status.data = "SUCCESS:" + plan_array[0];
-          m_planSelectionStatusPublisher->publish(status);
-      }
+      ROS_INFO ("Plan timed out, try again.");
+      publishStatus("FAILED:" + plan);
+      return false;
+    }
   }
-  //if error from run() we set as failed for GUI
-  else{
-      status.data = "FAILED:" + plan_array[0];
-      m_planSelectionStatusPublisher->publish(status);
+}
+
+void PlexilPlanSelection::publishStatus(const std::string& status)
+{
+  std_msgs::String msg;
+  msg.data = status;
+  m_planSelectionStatusPublisher->publish(msg);
+}
+
+PlexilPlanSelection::ExecCounters PlexilPlanSelection::execCounters() const
+{
+  ExecCounters counters;
+  counters.time = Clock::now();
+  counters.steps = OwExecutive::instance()->stepCount();
+  counters.commands = g_commandRegistry.totalCount();
+  counters.lookups = 0;
+  counters.notifications = 0;
+  for (const CommonAdapter* adapter : CommonAdapter::adapters()) {
+    counters.lookups += adapter->lookupsPerformed();
+    counters.notifications += adapter->notificationsSent();
   }
-  //delete the plan we just ran from plan array
-  plan_array.erase(plan_array.begin());
+  return counters;
+}
+
+void PlexilPlanSelection::publishStatistics(const std::string& plan, bool ran,
+                                            const ExecCounters& start)
+{
+  //one line of key=value pairs per plan, e.g. for scripts/plan_benchmark.py.
+  //Counts include whatever else the exec did while the plan ran.
+  ExecCounters end = execCounters();
+  std::ostringstream out;
+  out << "plan=" << plan
+      << " ran=" << (ran ? 1 : 0)
+      << " wall=" << std::chrono::duration<double>(end.time - start.time).count()
+      << " steps=" << end.steps - start.steps
+      << " commands=" << end.commands - start.commands
+      << " lookups=" << end.lookups - start.lookups
+      << " notifications=" << end.notifications - start.notifications;
+  ROS_INFO("Plan statistics: %s", out.str().c_str());
+  std_msgs::String msg;
+  msg.data = out.str();
+  m_planStatisticsPublisher->publish(msg);
 }
 
 bool PlexilPlanSelection::planSelectionServiceCallback(ow_plexil::PlanSelection::Request &req,
                                                        ow_plexil::PlanSelection::Response &res)
 {
-  //if command is ADD we add given plans to the plan_array
+  std::unique_lock<std::mutex> lock(m_planMutex);
+  //if command is ADD we add given plans to the queue, and wake the scheduler
   if(req.command.compare("ADD") == 0){
-    plan_array.insert(plan_array.end(), req.plans.begin(), req.plans.end());
+    m_plans.insert(m_plans.end(), req.plans.begin(), req.plans.end());
     res.success = true;
+    lock.unlock();
+    m_planCondition.notify_all();
   }
-  //if command is RESET  delete all plans in the plan_array
+  //if command is RESET  delete all plans in the queue
   else if(req.command.compare("RESET") == 0){
-    plan_array.clear();
+    m_plans.clear();
     ROS_INFO ("Plan list cleared, current plan will finish execution before stopping");
     res.success = true;
   }
@@ -7,13 +7,24 @@
 
 #include <ros/ros.h>
 #include <ow_plexil/PlanSelection.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include "CallbackGroup.h"
 
 class PlexilPlanSelection{
   public:
     PlexilPlanSelection() = default;
-    ~PlexilPlanSelection() = default;
+    ~PlexilPlanSelection();
     void initialize(std::string initial_plan);
     void start();
+    //make start() return after the current plan, e.g. when a nodelet is
+    //unloaded; may be called from any thread
+    void stop();
 
 
   private:
@@ -21,14 +32,37 @@ class PlexilPlanSelection{
     PlexilPlanSelection& operator = (const PlexilPlanSelection&) = delete;
     bool planSelectionServiceCallback(ow_plexil::PlanSelection::Request&,
                                       ow_plexil::PlanSelection::Response&);
-    void runCurrentPlan();
-    void waitForPlan();
+    bool running() const;
+    bool nextPlan(std::string& plan);
+    bool runCurrentPlan(const std::string& plan);
+    void waitForPlan(const std::string& plan);
+    bool waitForStep(unsigned long seen,
+                     std::chrono::steady_clock::time_point deadline);
+    void publishStatus(const std::string& status);
+
+    //counts of exec activity, for the statistics of each plan
+    struct ExecCounters{
+      std::chrono::steady_clock::time_point time;
+      unsigned long steps;
+      uint64_t commands, lookups, notifications;
+    };
+    ExecCounters execCounters() const;
+    void publishStatistics(const std::string& plan, bool ran,
+                           const ExecCounters& start);
 
     std::unique_ptr<ros::NodeHandle> m_genericNodeHandle;
+    // The selection service has its own spinner, so plans can be added or
+    // cleared from the GUI while start() is waiting on the current plan.
+    std::unique_ptr<CallbackGroup> m_serviceCallbacks;
     std::unique_ptr<ros::ServiceServer> m_planSelectionService;
     std::unique_ptr<ros::Publisher> m_planSelectionStatusPublisher;
-    std::vector<std::string> plan_array;
-    bool m_first_plan;
+    std::unique_ptr<ros::Publisher> m_planStatisticsPublisher;
+    // Plans waiting to run.  start() waits on the condition, which is
+    // signaled when plans are added and after every exec step.
+    std::deque<std::string> m_plans; // guarded by m_planMutex
+    std::mutex m_planMutex;
+    std::condition_variable m_planCondition;
+    std::atomic<bool> m_stopping{false};
  
 };
 
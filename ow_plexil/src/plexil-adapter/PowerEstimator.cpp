@@ -0,0 +1,173 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "PowerEstimator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+WindowedTrend::WindowedTrend (size_t window)
+  : m_samples (std::max<size_t> (window, 2))
+{ }
+
+void WindowedTrend::add (double time, double value)
+{
+  if (! std::isfinite (time) || ! std::isfinite (value)) return;
+  if (m_count == 0) m_origin = time;
+
+  if (m_count == m_samples.size()) {
+    const Sample& oldest = m_samples[m_next];
+    double t = oldest.time - m_origin;
+    m_sumT -= t;
+    m_sumV -= oldest.value;
+    m_sumTT -= t * t;
+    m_sumTV -= t * oldest.value;
+    m_count--;
+  }
+  m_samples[m_next] = { time, value };
+  m_next = (m_next + 1) % m_samples.size();
+  m_count++;
+  double t = time - m_origin;
+  m_sumT += t;
+  m_sumV += value;
+  m_sumTT += t * t;
+  m_sumTV += t * value;
+
+  if (++m_sinceResum >= m_samples.size()) resum();
+}
+
+void WindowedTrend::resum ()
+{
+  size_t size = m_samples.size();
+  size_t oldest = (m_next + size - m_count) % size;
+  m_origin = m_samples[oldest].time;
+  m_sumT = m_sumV = m_sumTT = m_sumTV = 0;
+  for (size_t i = 0; i < m_count; i++) {
+    const Sample& s = m_samples[(oldest + i) % size];
+    double t = s.time - m_origin;
+    m_sumT += t;
+    m_sumV += s.value;
+    m_sumTT += t * t;
+    m_sumTV += t * s.value;
+  }
+  m_sinceResum = 0;
+}
+
+double WindowedTrend::latest () const
+{
+  if (m_count == 0) return NAN;
+  return m_samples[(m_next + m_samples.size() - 1) % m_samples.size()].value;
+}
+
+double WindowedTrend::slope () const
+{
+  double n = m_count;
+  double spread = n * m_sumTT - m_sumT * m_sumT;
+  // Zero, give or take rounding, if all the samples have the same time.
+  if (m_count < 2 || spread <= 1e-12 * n * m_sumTT) return NAN;
+  return (n * m_sumTV - m_sumT * m_sumV) / spread;
+}
+
+double WindowedTrend::valueAt (double time) const
+{
+  double rate = slope();
+  if (std::isnan (rate)) return latest();
+  double n = m_count;
+  return m_sumV / n + rate * (time - m_origin - m_sumT / n);
+}
+
+PowerEstimator::PowerEstimator (const PowerBudgetLimits& limits)
+  : m_lastTemperatureTime (NAN),
+    m_reportedLife (NAN),
+    m_ok (true),
+    m_shortfall (nullptr),
+    m_clearSince (NAN)
+{
+  setLimits (limits);
+}
+
+void PowerEstimator::setLimits (const PowerBudgetLimits& limits)
+{
+  m_limits = limits;
+  m_stateOfCharge = WindowedTrend (limits.window);
+  m_temperature = WindowedTrend (limits.window);
+}
+
+void PowerEstimator::addStateOfCharge (double time, double fraction)
+{
+  m_stateOfCharge.add (time, fraction);
+}
+
+void PowerEstimator::addTemperature (double time, double celsius)
+{
+  m_temperature.add (time, celsius);
+  if (std::isfinite (time)) m_lastTemperatureTime = time;
+}
+
+void PowerEstimator::setRemainingUsefulLife (double seconds)
+{
+  m_reportedLife = seconds;
+}
+
+double PowerEstimator::projectedRemainingUsefulLife () const
+{
+  double projected = NAN;
+  if (m_stateOfCharge.count() > 0) {
+    double charge = m_stateOfCharge.latest();
+    double rate = m_stateOfCharge.slope();
+    if (charge <= m_limits.minStateOfCharge) projected = 0;
+    else if (rate < 0) projected = (charge - m_limits.minStateOfCharge) / -rate;
+    else projected = std::numeric_limits<double>::infinity();
+  }
+  if (std::isnan (m_reportedLife)) return projected;
+  if (std::isnan (projected)) return m_reportedLife;
+  return std::min (projected, m_reportedLife);
+}
+
+const char* PowerEstimator::check (bool recovering) const
+{
+  double charge_margin = recovering ? m_limits.chargeHysteresis : 0;
+  double temperature_margin = recovering ? m_limits.temperatureHysteresis : 0;
+  double life_margin = recovering ? m_limits.lifeHysteresis : 0;
+
+  if (m_stateOfCharge.count() > 0 &&
+      m_stateOfCharge.latest() < m_limits.minStateOfCharge + charge_margin) {
+    return "state of charge below minimum";
+  }
+  double max_temperature = m_limits.maxTemperature - temperature_margin;
+  if (m_temperature.count() > 0 &&
+      (m_temperature.latest() >= max_temperature ||
+       m_temperature.valueAt (m_lastTemperatureTime +
+                              m_limits.temperatureHorizon) >=
+       max_temperature)) {
+    return "battery temperature at or soon above maximum";
+  }
+  double life = projectedRemainingUsefulLife();
+  if (! std::isnan (life) && life < m_limits.minRemainingLife + life_margin) {
+    return "remaining useful life below reserve";
+  }
+  return nullptr;
+}
+
+bool PowerEstimator::update (double time)
+{
+  const char* shortfall = check (! m_ok);
+  if (m_ok) {
+    if (! shortfall) return false;
+    m_ok = false;
+    m_shortfall = shortfall;
+    m_clearSince = NAN;
+    return true;
+  }
+  if (shortfall) {
+    m_shortfall = shortfall;
+    m_clearSince = NAN;
+    return false;
+  }
+  if (std::isnan (m_clearSince)) m_clearSince = time;
+  if (time - m_clearSince < m_limits.recoveryTime) return false;
+  m_ok = true;
+  m_shortfall = nullptr;
+  return true;
+}
@@ -0,0 +1,117 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Power_Estimator_H
+#define Power_Estimator_H
+
+// Streaming estimate of the lander's power budget from its battery telemetry.
+// The state of charge and battery temperature are each fitted with a line by
+// least squares over a window of their latest samples, updated in constant
+// time per sample, from which the remaining useful life (RUL) is projected as
+// the time until the charge falls to its minimum.  The budget is OK unless
+// the charge is below its minimum, the temperature is headed above its
+// maximum within the horizon, or the RUL is below its reserve.  Once
+// exceeded, the budget is OK again only when each value clears its limit by
+// its hysteresis margin, and has for the recovery time, so that values
+// hovering about a limit do not toggle it.  Values not yet known do not count
+// against the budget, so that a lander without power telemetry is not held
+// back.
+
+#include <cstddef>
+#include <vector>
+
+// Limits of the power budget, from the ROS parameters ~power_budget/*.
+struct PowerBudgetLimits
+{
+  size_t window = 32;              // samples in each trend
+  double minStateOfCharge = 0.10;  // as in MonitorPower.plp
+  double maxTemperature = 30;      // celsius, as in MonitorPower.plp
+  double temperatureHorizon = 60;  // seconds; made up
+  double minRemainingLife = 600;   // seconds; made up
+
+  // Margins past the limits for recovery, and how long recovery must last.
+  double chargeHysteresis = 0.02;       // made up
+  double temperatureHysteresis = 1.0;   // celsius; made up
+  double lifeHysteresis = 60;           // seconds; made up
+  double recoveryTime = 10;             // seconds; made up
+};
+
+// Least-squares line through the latest samples of a signal.  Sums are kept
+// relative to a time origin that is moved, and the sums recomputed, once per
+// window of samples, so that rounding error does not accumulate.
+class WindowedTrend
+{
+ public:
+  explicit WindowedTrend (size_t window = 2);
+
+  // Add a sample, replacing the oldest if the window is full.  Samples that
+  // are not finite are ignored.
+  void add (double time, double value);
+
+  size_t count () const { return m_count; }
+  double latest () const;  // NAN if there is no sample
+  double slope () const;   // per second; NAN if fewer than two sample times
+
+  // The fitted value at the given time.
+  double valueAt (double time) const;
+
+ private:
+  struct Sample
+  {
+    double time, value;
+  };
+  void resum ();
+
+  std::vector<Sample> m_samples;  // ring of m_count samples
+  size_t m_next = 0;              // where the next sample goes
+  size_t m_count = 0;
+  size_t m_sinceResum = 0;
+  double m_origin = 0;
+  double m_sumT = 0, m_sumV = 0, m_sumTT = 0, m_sumTV = 0;
+};
+
+// Not thread-safe; fed by the power telemetry callbacks, which are serialized.
+class PowerEstimator
+{
+ public:
+  explicit PowerEstimator (const PowerBudgetLimits& limits = {});
+  void setLimits (const PowerBudgetLimits&);
+  const PowerBudgetLimits& limits () const { return m_limits; }
+
+  void addStateOfCharge (double time, double fraction);
+  void addTemperature (double time, double celsius);
+
+  // As reported by the power system, in seconds.
+  void setRemainingUsefulLife (double seconds);
+
+  // Seconds until the charge falls to its minimum, at its current trend or as
+  // reported, whichever is sooner.  Infinite if the charge is not falling and
+  // no RUL has been reported; NAN if nothing is known.
+  double projectedRemainingUsefulLife () const;
+
+  // Update the state of the budget as of the given time, in seconds.  True
+  // if it changed.
+  bool update (double time);
+
+  bool budgetOK () const { return m_ok; }
+
+  // Why the budget is, or was last, exceeded; null if it is OK.
+  const char* shortfall () const { return m_shortfall; }
+
+ private:
+  // Why the values exceed the limits, tightened by the margins when
+  // recovering; null if they do not.
+  const char* check (bool recovering) const;
+
+  PowerBudgetLimits m_limits;
+  WindowedTrend m_stateOfCharge;
+  WindowedTrend m_temperature;
+  double m_lastTemperatureTime;
+  double m_reportedLife;
+  bool m_ok;
+  const char* m_shortfall;
+  double m_clearSince;  // when the values last cleared the margins, or NAN
+};
+
+#endif
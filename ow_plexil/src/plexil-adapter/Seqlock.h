@@ -0,0 +1,88 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Seqlock_H
+#define Seqlock_H
+
+// A value published by one writer and read by any number of threads without
+// locks.  Used for telemetry snapshots, which the callbacks write at high rate
+// and the exec reads in lookups.  A reader never sees a partly written value:
+// it retries if a store overlapped its read.
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+template <class T>
+class Seqlock
+{
+  static_assert (std::is_trivially_copyable<T>::value,
+                 "Seqlock value must be trivially copyable");
+
+ public:
+  explicit Seqlock (const T& initial = T())
+  {
+    Words words {};
+    std::memcpy (words.data(), &initial, sizeof (T));
+    for (size_t i = 0; i < NumWords; i++) m_words[i] = words[i];
+  }
+  Seqlock (const Seqlock&) = delete;
+  Seqlock& operator= (const Seqlock&) = delete;
+
+  // Publish a new value.  Stores must not be concurrent with each other.
+  void store (const T& value)
+  {
+    Words words {};
+    std::memcpy (words.data(), &value, sizeof (T));
+    uint64_t seq = m_sequence.load (std::memory_order_relaxed);
+    m_sequence.store (seq + 1, std::memory_order_relaxed);  // odd: writing
+    std::atomic_thread_fence (std::memory_order_release);
+    for (size_t i = 0; i < NumWords; i++) {
+      m_words[i].store (words[i], std::memory_order_relaxed);
+    }
+    m_sequence.store (seq + 2, std::memory_order_release);
+  }
+
+  // The last value published.
+  T load () const
+  {
+    Words words;
+    while (true) {
+      uint64_t before = m_sequence.load (std::memory_order_acquire);
+      if (before & 1) {
+        std::this_thread::yield();
+        continue;
+      }
+      for (size_t i = 0; i < NumWords; i++) {
+        words[i] = m_words[i].load (std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence (std::memory_order_acquire);
+      if (m_sequence.load (std::memory_order_relaxed) == before) break;
+    }
+    T value;
+    std::memcpy (static_cast<void*>(&value), words.data(), sizeof (T));
+    return value;
+  }
+
+  // Number of values stored since construction.
+  uint64_t version () const
+  {
+    return m_sequence.load (std::memory_order_acquire) / 2;
+  }
+
+ private:
+  // The value is held in atomic words, so that reading it while it is being
+  // written is not a data race.
+  static const size_t NumWords = (sizeof (T) + sizeof (uint64_t) - 1) /
+    sizeof (uint64_t);
+  using Words = std::array<uint64_t, NumWords>;
+
+  std::atomic<uint64_t> m_sequence { 0 };
+  std::array<std::atomic<uint64_t>, NumWords> m_words;
+};
+
+#endif
@@ -0,0 +1,151 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "StateRegistry.h"
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+using PLEXIL::State;
+using PLEXIL::Value;
+using std::string;
+
+static bool matches (const string& pattern, const string& name)
+{
+  size_t star = pattern.find ('*');
+  if (star == string::npos) return pattern == name;
+  size_t suffix = pattern.size() - star - 1;
+  return name.size() >= star + suffix &&
+    name.compare (0, star, pattern, 0, star) == 0 &&
+    name.compare (name.size() - suffix, suffix, pattern, star + 1, suffix) == 0;
+}
+
+StateRegistry::Entry::Entry (const string& name)
+  : state (name, 0),
+    subscribed (false),
+    filtered (false),
+    m_interval (0),
+    m_sent (false),
+    m_holding (false)
+{ }
+
+StateRegistry::Entry::Entry (const string& name, const string& arg)
+  : state (name, Value (arg)),
+    subscribed (false),
+    filtered (false),
+    m_interval (0),
+    m_sent (false),
+    m_holding (false)
+{ }
+
+Admission StateRegistry::Entry::admit (const Value& value)
+{
+  if (! filtered) return Admission::Send;
+
+  auto now = Clock::now();
+  std::lock_guard<std::mutex> lock (m_filterMutex);
+  if (m_sent) {
+    double current, last;
+    bool same = value.getValue (current) && m_lastValue.getValue (last) ?
+      std::fabs (current - last) <= filter.deadband : value == m_lastValue;
+    if (same) {
+      // Back where it was sent, so nothing held is worth sending.
+      m_holding = false;
+      return Admission::Drop;
+    }
+    if (now - m_lastSent < m_interval) {
+      m_holding = true;
+      m_heldValue = value;
+      return Admission::Hold;
+    }
+  }
+  m_sent = true;
+  m_holding = false;
+  m_lastValue = value;
+  m_lastSent = now;
+  return Admission::Send;
+}
+
+bool StateRegistry::Entry::takeHeld (Clock::time_point now, Value& value,
+                                     Clock::time_point& due)
+{
+  std::lock_guard<std::mutex> lock (m_filterMutex);
+  if (! m_holding) return false;
+  Clock::time_point end = m_lastSent + m_interval;
+  if (now < end) {
+    due = std::min (due, end);
+    return false;
+  }
+  m_holding = false;
+  m_lastValue = m_heldValue;
+  m_lastSent = now;
+  value = m_heldValue;
+  return true;
+}
+
+StateRegistry::StateRegistry ()
+{
+  for (auto& chunk : m_chunks) chunk.store (nullptr);
+}
+
+StateRegistry::Entry& StateRegistry::insert (const StateHandle& handle)
+{
+  // Another thread may have inserted the entry since entry() looked.
+  std::lock_guard<std::mutex> lock (m_mutex);
+  size_t index = handle.index();
+  Slot* chunk = m_chunks[index / ChunkSize].load (std::memory_order_relaxed);
+  if (! chunk) {
+    m_chunkStore.push_back (std::make_unique<Slot[]> (ChunkSize));
+    chunk = m_chunkStore.back().get();
+    for (size_t i = 0; i < ChunkSize; i++) chunk[i].store (nullptr);
+    m_chunks[index / ChunkSize].store (chunk, std::memory_order_release);
+  }
+  Slot& slot = chunk[index % ChunkSize];
+  if (Entry* found = slot.load (std::memory_order_relaxed)) return *found;
+
+  const string& name = handle.name();
+  const string* arg = handle.arg();
+  m_entries.push_back (arg ? std::make_unique<Entry> (name, *arg)
+                           : std::make_unique<Entry> (name));
+  Entry& entry = *m_entries.back();
+  for (const auto& f : m_filters) {
+    if (matches (f.first, name)) {
+      entry.filtered = true;
+      entry.filter = f.second;
+      entry.m_interval = std::chrono::duration_cast<Clock::duration>
+        (std::chrono::duration<double> (f.second.minInterval));
+      if (f.second.minInterval > 0) m_rated.push_back (&entry);
+      break;
+    }
+  }
+  slot.store (&entry, std::memory_order_release);
+  return entry;
+}
+
+StateRegistry::Entry* StateRegistry::intern (const State& state)
+{
+  const auto& params = state.parameters();
+  if (params.empty()) return &entry (StateHandle (state.name()));
+
+  const string* arg = nullptr;
+  if (params.size() == 1 && params[0].getValuePointer (arg) && arg) {
+    return &entry (StateHandle (state.name(), *arg));
+  }
+  return nullptr;
+}
+
+void StateRegistry::addFilter (const string& pattern, const ChangeFilter& filter)
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  m_filters.emplace_back (pattern, filter);
+}
+
+bool StateRegistry::holdsValues () const
+{
+  for (const auto& f : m_filters) {
+    if (f.second.minInterval > 0) return true;
+  }
+  return false;
+}
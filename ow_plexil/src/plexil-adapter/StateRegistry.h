@@ -0,0 +1,152 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef State_Registry_H
+#define State_Registry_H
+
+// Interned PLEXIL states for the telemetry published to the executive.  Each
+// state is built once, the first time it is published or subscribed to, and
+// then found by its handle (see subscriber.h) in a table indexed by handle,
+// without hashing, locking or allocating.  The entry also caches whether the
+// executive is subscribed to the state, and can filter out redundant or
+// too-frequent changes of its value.
+
+#include "subscriber.h"
+
+// PLEXIL API
+#include <State.hh>
+#include <Value.hh>
+
+// C++
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Suppression of value changes of a state.  A change is sent to the exec only
+// if it differs from the last value sent by more than the deadband (or at all,
+// for non-Real values), and not sooner than the minimum interval after it.  A
+// change held back only by the interval is sent when the interval is over,
+// unless a later value replaces it first, so that the exec is not left with a
+// stale value when the telemetry stops changing.
+struct ChangeFilter
+{
+  double deadband = 0;    // minimum change of a Real value
+  double minInterval = 0; // seconds between changes sent
+};
+
+// What to do with a value change of a filtered state.
+enum class Admission
+{
+  Send,  // now
+  Drop,  // the exec has it, to within the deadband
+  Hold   // until the interval is over (see StateRegistry::flushHeld)
+};
+
+class StateRegistry
+{
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry
+  {
+    Entry (const std::string& name);
+    Entry (const std::string& name, const std::string& arg);
+    Entry (const Entry&) = delete;
+    Entry& operator= (const Entry&) = delete;
+
+    // Should this value be sent to the exec?  If so, records it as sent; if
+    // it is held, it replaces any value held before.
+    Admission admit (const PLEXIL::Value& value);
+
+    // The held value, if its interval is over at the given time, recorded as
+    // sent.  Otherwise false, and due is lowered to when it will be.
+    bool takeHeld (Clock::time_point now, PLEXIL::Value& value,
+                   Clock::time_point& due);
+
+    const PLEXIL::State state;
+    std::atomic<bool> subscribed;  // read by publishers without a lock
+
+    bool filtered;
+    ChangeFilter filter;
+
+   private:
+    friend class StateRegistry;
+    std::mutex m_filterMutex;
+    Clock::duration m_interval;
+    bool m_sent;
+    bool m_holding;
+    PLEXIL::Value m_lastValue;
+    PLEXIL::Value m_heldValue;
+    Clock::time_point m_lastSent;
+  };
+
+  StateRegistry ();
+  StateRegistry (const StateRegistry&) = delete;
+  StateRegistry& operator= (const StateRegistry&) = delete;
+
+  // The entry for the given valid handle, created the first time.  Entries
+  // are never removed, so the references remain valid for the life of the
+  // registry.  Takes no lock once the entry exists.
+  Entry& entry (const StateHandle& handle)
+  {
+    size_t index = handle.index();
+    const Slot* chunk = m_chunks[index / ChunkSize].load
+      (std::memory_order_acquire);
+    if (chunk) {
+      Entry* found = chunk[index % ChunkSize].load (std::memory_order_acquire);
+      if (found) return *found;
+    }
+    return insert (handle);
+  }
+
+  // As above, for a state the exec subscribes to, which is resolved to its
+  // handle, and so takes a lock.  Returns null for states with parameters
+  // other than a single string, since they are never published.
+  Entry* intern (const PLEXIL::State& state);
+
+  // Filter the states matching the given name pattern, which may contain one
+  // '*' wildcard (e.g. "*Position").  Applies to states interned afterwards,
+  // so call before publishing starts.  The first matching pattern is used.
+  void addFilter (const std::string& pattern, const ChangeFilter& filter);
+
+  // Whether any filter limits the rate, so that values may be held.
+  bool holdsValues () const;
+
+  // Give the held values whose intervals are over at the given time to send,
+  // with the entry.  Returns when the next held value will be due, or
+  // Clock::time_point::max() if none is held.
+  template <class Send>
+  Clock::time_point flushHeld (Clock::time_point now, Send send)
+  {
+    Clock::time_point due = Clock::time_point::max();
+    PLEXIL::Value value;
+    std::lock_guard<std::mutex> lock (m_mutex);
+    for (Entry* entry : m_rated) {
+      if (entry->takeHeld (now, value, due)) send (*entry, value);
+    }
+    return due;
+  }
+
+ private:
+  Entry& insert (const StateHandle& handle);
+
+  // Entries by handle index, in chunks allocated as needed, so that finding
+  // one is two loads.  Slots and chunks are set once, under m_mutex.
+  using Slot = std::atomic<Entry*>;
+  static const size_t ChunkSize = 256;
+  static const size_t Chunks = StateHandle::MaxStates / ChunkSize;
+  std::atomic<Slot*> m_chunks[Chunks];
+
+  // All below guarded by m_mutex.
+  std::mutex m_mutex;
+  std::vector<std::unique_ptr<Slot[]>> m_chunkStore;
+  std::vector<std::unique_ptr<Entry>> m_entries;
+  std::vector<std::pair<std::string, ChangeFilter>> m_filters;
+  std::vector<Entry*> m_rated;  // entries whose filters limit the rate
+};
+
+#endif
@@ -0,0 +1,104 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "ThreadPool.h"
+
+using std::function;
+using std::lock_guard;
+using std::mutex;
+using std::unique_lock;
+
+ThreadPool::~ThreadPool ()
+{
+  stop();
+}
+
+void ThreadPool::start (size_t num_workers)
+{
+  lock_guard<mutex> lock (m_mutex);
+  if (! m_workers.empty()) return;
+  if (num_workers == 0) num_workers = 1;
+  m_stopping = false;
+  for (size_t i = 0; i < num_workers; i++) {
+    m_workers.emplace_back (&ThreadPool::workerLoop, this);
+  }
+}
+
+void ThreadPool::stop ()
+{
+  {
+    lock_guard<mutex> lock (m_mutex);
+    m_stopping = true;
+  }
+  m_condition.notify_all();
+  for (auto& worker : m_workers) {
+    if (worker.joinable()) worker.join();
+  }
+  lock_guard<mutex> lock (m_mutex);
+  m_workers.clear();
+}
+
+void ThreadPool::enqueueTask (function<void()>&& task)
+{
+  {
+    lock_guard<mutex> lock (m_mutex);
+    if (! m_workers.empty() && ! m_stopping) {
+      m_queue.push_back (std::move (task));
+      if (m_queue.size() > m_peakQueueDepth) m_peakQueueDepth = m_queue.size();
+      m_condition.notify_one();
+      return;
+    }
+  }
+  // No workers to hand the task to.
+  task();
+}
+
+void ThreadPool::workerLoop ()
+{
+  while (true) {
+    function<void()> task;
+    {
+      unique_lock<mutex> lock (m_mutex);
+      m_condition.wait (lock, [this] { return m_stopping || ! m_queue.empty(); });
+      if (m_queue.empty()) return;  // stopping, and nothing left to do
+      task = std::move (m_queue.front());
+      m_queue.pop_front();
+      m_busyWorkers++;
+    }
+    task();
+    lock_guard<mutex> lock (m_mutex);
+    m_busyWorkers--;
+    m_tasksCompleted++;
+  }
+}
+
+size_t ThreadPool::size () const
+{
+  lock_guard<mutex> lock (m_mutex);
+  return m_workers.size();
+}
+
+size_t ThreadPool::queueDepth () const
+{
+  lock_guard<mutex> lock (m_mutex);
+  return m_queue.size();
+}
+
+size_t ThreadPool::peakQueueDepth () const
+{
+  lock_guard<mutex> lock (m_mutex);
+  return m_peakQueueDepth;
+}
+
+size_t ThreadPool::busyWorkers () const
+{
+  lock_guard<mutex> lock (m_mutex);
+  return m_busyWorkers;
+}
+
+size_t ThreadPool::tasksCompleted () const
+{
+  lock_guard<mutex> lock (m_mutex);
+  return m_tasksCompleted;
+}
@@ -0,0 +1,63 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Thread_Pool_H
+#define Thread_Pool_H
+
+// A small, fixed-size pool of worker threads that run tasks taken from a FIFO
+// queue.  Used by the testbed interfaces to dispatch lander operations without
+// creating a thread per command.
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+ public:
+  ThreadPool () = default;
+  ~ThreadPool ();
+  ThreadPool (const ThreadPool&) = delete;
+  ThreadPool& operator= (const ThreadPool&) = delete;
+
+  // Start the given number of workers (at least one).  Has no effect if the
+  // pool is already running.
+  void start (size_t num_workers);
+
+  // Finish the queued tasks and join all workers.
+  void stop ();
+
+  // Queue a task.  Arguments are copied, as with std::thread.  If the pool was
+  // never started, the task is run in the calling thread.
+  template <class F, class... Args>
+    void enqueue (F&& f, Args&&... args)
+  {
+    enqueueTask (std::bind (std::forward<F>(f), std::forward<Args>(args)...));
+  }
+
+  // Metrics
+  size_t size () const;            // number of workers
+  size_t queueDepth () const;      // tasks waiting for a worker
+  size_t peakQueueDepth () const;  // high-water mark of queueDepth()
+  size_t busyWorkers () const;     // workers currently running a task
+  size_t tasksCompleted () const;
+
+ private:
+  void enqueueTask (std::function<void()>&& task);
+  void workerLoop ();
+
+  std::vector<std::thread> m_workers;
+  std::deque<std::function<void()>> m_queue;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stopping = false;
+  size_t m_peakQueueDepth = 0;
+  size_t m_busyWorkers = 0;
+  size_t m_tasksCompleted = 0;
+};
+
+#endif
@@ -8,5 +8,5 @@
 
 t_action_active_cb default_action_active_cb (const std::string& operation_name)
 {
-  return [&] () { ROS_INFO ("%s started...", operation_name.c_str()); };
+  return [operation_name] () { ROS_INFO ("%s started...", operation_name.c_str()); };
 }
@@ -18,9 +18,15 @@
 //
 const auto ACTION_SERVER_TIMEOUT_SECS = 10.0;
 
+// Default number of worker threads used to dispatch action goals; can be
+// overridden with the node's private parameter ~action_worker_threads.
+//
+const int DEFAULT_ACTION_WORKER_THREADS = 2;
+
 // The following action callbacks are essentially stubs that do nothing more
 // than print a short status.  They are used as defaults; any action invocation
-// can substitute another callback.
+// can substitute another callback.  Since they are invoked after the function
+// that sent the goal has returned, they capture the operation name by value.
 
 using t_action_active_cb = std::function<void ()>;
 
@@ -34,7 +40,7 @@ t_action_feedback_cb<T>
 default_action_feedback_cb (const std::string& operation_name_unused)
 {
   // Since feedback is verbose, do nothing by default.
-  return [&] (const T& feedback_unused) { };
+  return [] (const T& feedback_unused) { };
 }
 
 template<typename T>
@@ -45,8 +51,8 @@ using t_action_done_cb =
 template<typename T>
 t_action_done_cb<T> default_action_done_cb (const std::string& operation_name)
 {
-  return [&] (const actionlib::SimpleClientGoalState& state,
-              const T& result_ignored) {
+  return [operation_name] (const actionlib::SimpleClientGoalState& state,
+                           const T& result_ignored) {
     ROS_INFO ("%s finished in state %s", operation_name.c_str(),
               state.toString().c_str());
   };
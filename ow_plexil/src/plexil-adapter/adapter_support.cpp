@@ -4,6 +4,8 @@
 
 // ow_plexil
 #include "adapter_support.h"
+#include "CheckpointJournal.h"
+#include "FlightRecorder.h"
 
 // ROS
 #include <ros/ros.h>
@@ -13,31 +15,36 @@
 using namespace PLEXIL;
 
 // C++
-#include <map>
+#include <limits>
+#include <memory>
 #include <mutex>
 using std::string;
 using std::vector;
-using std::unique_ptr;
-using std::get;
+using std::shared_ptr;
 using std::mutex;
 
-// An empty argument vector, for convenience.
-const vector<Value> EmptyArgs;
-
-CommonAdapter* g_adapter;
-
-static mutex g_shared_mutex;
+void notify_exec ()
+{
+  std::vector<CommonAdapter*> adapters = CommonAdapter::adapters();
+  if (! adapters.empty()) adapters.front()->notifyExecNow();
+}
 
 int CommandId = 0;
 
-std::map<int, unique_ptr<CommandRecord>> CommandRegistry;
+CommandRegistry g_commandRegistry;
 
-unique_ptr<CommandRecord>&
+CommandLatencyStats g_commandLatency;
+
+shared_ptr<CommandRecord>
 new_command_record(Command* cmd, AdapterExecInterface* intf)
 {
-  auto cr = std::make_tuple(cmd, intf, false);
-  CommandRegistry[++CommandId] = std::make_unique<CommandRecord>(cr);
-  return CommandRegistry[CommandId];
+  int id = ++CommandId;
+  auto cr = std::make_shared<CommandRecord>(id, cmd, intf);
+  cr->markStage (CommandStage::Dispatched);
+  g_commandRegistry.insert (id, cr);
+  g_checkpoints.commandIssued (id, cmd->getName());
+  flight_record (FlightEventType::CommandDispatched, cmd->getName(), id);
+  return cr;
 }
 
 static void ack_command (Command* cmd,
@@ -45,7 +52,7 @@ static void ack_command (Command* cmd,
                          AdapterExecInterface* intf)
 {
   intf->handleCommandAck(cmd, handle);
-  intf->notifyOfExternalEvent();
+  notify_exec();
 }
 
 static void ack_success (Command* cmd, AdapterExecInterface* intf)
@@ -66,91 +73,106 @@ static void ack_sent (Command* cmd, AdapterExecInterface* intf)
 
 void send_ack_once(CommandRecord& cr, bool skip)
 {
-  std::lock_guard<mutex> g(g_shared_mutex);
-  bool& sent_flag = get<CR_ACK_SENT>(cr);
-  if (!sent_flag)
+  std::lock_guard<mutex> g(cr.ackMutex);
+  if (!cr.ackSent)
   {
     if (!skip) {
-      ack_sent(get<CR_COMMAND>(cr), get<CR_ADAPTER>(cr));
+      cr.markStage (CommandStage::Acknowledged);
+      ack_sent(cr.command, cr.adapter);
+      g_checkpoints.commandAcked (cr.id);
+      flight_record (FlightEventType::CommandAcked, cr.command->getName(),
+                     cr.id);
     }
-    sent_flag = true;
+    cr.ackSent = true;
   }
 }
 
 void command_status_callback (int id, bool success)
 {
-  auto it = CommandRegistry.find(id);
-  if (it == CommandRegistry.end())
+  // This is the command's final acknowledgment, so its record is reclaimed.
+  shared_ptr<CommandRecord> cr = g_commandRegistry.remove (id);
+  if (!cr)
   {
     ROS_ERROR_STREAM("command_status_callback: no command registered under id"
                      << id);
     return;
   }
 
-  unique_ptr<CommandRecord>& cr = it->second;
-  Command* cmd = get<CR_COMMAND>(*cr);
-  AdapterExecInterface* intf = get<CR_ADAPTER>(*cr);
+  // The command may be deleted once its final ack is handled, so take what
+  // is needed from it first.
+  string name = cr->command->getName();
   send_ack_once(*cr, true);
-  if (success) ack_success (cmd, intf);
-  else ack_failure (cmd, intf);
-}
-
-static State create_state (const string& state_name, const vector<Value>& value)
-{
-  State state(state_name, value.size());
-  if (value.size() > 0)
-  {
-    for(size_t i=0; i<value.size();i++)
-    {
-      state.setParameter(i, value[i]);
-    }
-  }
-  return state;
-}
-
-static void propagate (const State& state, const vector<Value>& value)
-{
-  // For efficiency, assumes initialization of g_adapter!
-  g_adapter->propagateValueChange (state, value);
+  cr->markStage (CommandStage::Finished);
+  if (success) ack_success (cr->command, cr->adapter);
+  else ack_failure (cr->command, cr->adapter);
+  g_commandLatency.record (name, cr->timestamps());
+  g_checkpoints.commandFinished (id, success);
+  flight_record (FlightEventType::CommandFinished, name, id,
+                 std::numeric_limits<double>::quiet_NaN(), success);
 }
 
-// To do: templatize the following few
-
-void receiveBool (const string& state_name, bool val)
+void command_stage_callback (int id, CommandStage stage)
 {
-  debugMsg("OwAdapter:receiveBool", " propagating " << state_name
-           << " with value " << (val ? "true" : "false"));
-  propagate (create_state(state_name, EmptyArgs),
-             vector<Value> (1, val));
+  // Stages are informational, so a command that already finished is ignored.
+  shared_ptr<CommandRecord> cr = g_commandRegistry.find (id);
+  if (cr) cr->markStage (stage);
 }
 
-void receiveDouble (const string& state_name, double val)
+void command_return_callback (int id, const vector<double>& value)
 {
-  propagate (create_state(state_name, EmptyArgs),
-             vector<Value> (1, val));
-}
+  shared_ptr<CommandRecord> cr = g_commandRegistry.find (id);
+  if (!cr)
+  {
+    ROS_ERROR_STREAM("command_return_callback: no command registered under id"
+                     << id);
+    return;
+  }
 
-void receiveString (const string& state_name, const string& val)
-{
-  propagate (create_state(state_name, EmptyArgs),
-             vector<Value> (1, val));
+  flight_record (FlightEventType::CommandReturned, cr->command->getName(), id,
+                 value.empty() ? std::numeric_limits<double>::quiet_NaN()
+                               : value[0]);
+  cr->adapter->handleCommandReturn(cr->command, Value(value));
+  notify_exec();
+}
+
+void set_checkpoint (Command* cmd, AdapterExecInterface* intf)
+{
+  // set_checkpoint (name [, state [, info]]), set true with no info by default.
+  const vector<Value>& args = cmd->getArgValues();
+  string name, info;
+  bool state = true;
+  if (args.empty() || args.size() > 3 || ! args[0].getValue (name) ||
+      (args.size() > 1 && ! args[1].getValue (state)) ||
+      (args.size() > 2 && ! args[2].getValue (info))) {
+    ROS_ERROR("set_checkpoint: expected a String, optionally followed by a "
+              "Boolean and a String.");
+    ack_failure (cmd, intf);
+    return;
+  }
+  g_checkpoints.setCheckpoint (name, state, info);
+  ack_success (cmd, intf);
 }
 
-void receiveBoolString (const string& state_name, bool val, const string& arg)
+void set_boot_ok (Command* cmd, AdapterExecInterface* intf)
 {
-  propagate (create_state(state_name, vector<Value> (1, arg)),
-             vector<Value> (1, val));
+  // set_boot_ok ([boot]), the current boot by default.
+  const vector<Value>& args = cmd->getArgValues();
+  int32_t boot = 0;
+  if (args.size() > 1 || (args.size() == 1 && ! args[0].getValue (boot)) ||
+      ! g_checkpoints.setBootOK (boot)) {
+    ROS_ERROR("set_boot_ok: no boot %d is kept.", boot);
+    ack_failure (cmd, intf);
+    return;
+  }
+  ack_success (cmd, intf);
 }
 
-void receiveDoubleVector (const string& state_name, vector<double> vals)
+void flush_checkpoints (Command* cmd, AdapterExecInterface* intf)
 {
-  vector<Value> vector_values;
-  for(int i = 0; i < vals.size(); i++){
-    Value temp = Value(vals[i]);
-    vector_values.push_back(temp);
-  }
-  propagate (create_state(state_name, EmptyArgs),
-             vector_values);
+  shared_ptr<CommandRecord> cr = new_command_record (cmd, intf);
+  send_ack_once (*cr);
+  int id = cr->id;
+  g_checkpoints.flush ([id] (bool ok) { command_status_callback (id, ok); });
 }
 
 static string log_string (const vector<Value>& args)
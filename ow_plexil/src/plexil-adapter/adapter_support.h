@@ -11,6 +11,7 @@
 // but the effort and result could be complicated in several ways.
 
 #include "CommonAdapter.h"
+#include "CommandRegistry.h"
 
 // PLEXIL
 #include <Value.hh>
@@ -18,7 +19,7 @@
 #include <AdapterExecInterface.hh>
 
 // C++
-#include <map>
+#include <memory>
 #include <string>
 using std::vector;
 
@@ -28,10 +29,10 @@ using std::vector;
 // A prettier name for the "unknown" value.
 const PLEXIL::Value Unknown;
 
-// A pointer to the interface adapter, so that it can be accessed from static
-// functions.  WARNING: this allows only one adapter instance to be usable at a
-// time; multiple testbeds cannot operate concurrently.
-extern CommonAdapter* g_adapter;
+// Signal the exec, at once, that a command ack, status or return value has been
+// handed to it.  All adapters serve the one exec, so this goes through the
+// first adapter initialized (see CommonAdapter::adapters()), if there is one.
+void notify_exec ();
 
 
 //////////////////////////// Command Handling //////////////////////////////
@@ -39,18 +40,14 @@ extern CommonAdapter* g_adapter;
 // Unique ID for every instance of a command from a Plexil plan.
 extern int CommandId;
 
-// Record that combines a Plexil command instance with its executive interface
-// and a flag indicating whether the command has been acknowledged.
-using CommandRecord =
-  std::tuple<PLEXIL::Command*, PLEXIL::AdapterExecInterface*, bool /* ack_sent */>;
-
-enum CommandRecordFields {CR_COMMAND, CR_ADAPTER, CR_ACK_SENT};
-
-std::unique_ptr<CommandRecord>&
+// Create and register the record of a new command instance, under a new
+// CommandId.
+std::shared_ptr<CommandRecord>
 new_command_record(PLEXIL::Command*, PLEXIL::AdapterExecInterface*);
 
-// Registry of all commands currently in execution by testbed.
-extern std::map<int, std::unique_ptr<CommandRecord>> CommandRegistry;
+// Registry of all commands currently in execution by testbed.  A command's
+// record is removed when its final acknowledgment is sent.
+extern CommandRegistry g_commandRegistry;
 
 // Acknowledge a command issued by a Plexil plan, in a way that guarantees only
 // one acknowledgment (acks are not idempotent).
@@ -59,14 +56,25 @@ void send_ack_once(CommandRecord&, bool skip=false);
 // Function to call when a command finishes execution in testbed.
 void command_status_callback (int id, bool success);
 
-// "Receivers" for the pub/sub mechanism in subscriber.h
-void receiveBool (const std::string& state_name, bool val);
-void receiveDouble (const std::string& state_name, double val);
-void receiveString (const std::string& state_name, const std::string& val);
-void receiveBoolString (const std::string& state_name,
-                        bool val,
-                        const std::string& arg);
-void receiveDoubleVector (const std::string& state_name, vector<double> vals);
+// Function to call when a command reaches an intermediate stage in testbed.
+void command_stage_callback (int id, CommandStage stage);
+
+// Latencies of the commands that finished, logged when the adapter stops.
+extern CommandLatencyStats g_commandLatency;
+
+// Function to call when a command produces its return value in testbed, before
+// it finishes.
+void command_return_callback (int id, const vector<double>& value);
+
+
+/////////////////////////////// Checkpoints ///////////////////////////////////
+
+// Handlers for the plans' checkpoint commands, kept by g_checkpoints (see
+// CheckpointJournal.h).  flush_checkpoints is acknowledged once the
+// checkpoints are on disk.
+void set_checkpoint (PLEXIL::Command*, PLEXIL::AdapterExecInterface*);
+void set_boot_ok (PLEXIL::Command*, PLEXIL::AdapterExecInterface*);
+void flush_checkpoints (PLEXIL::Command*, PLEXIL::AdapterExecInterface*);
 
 
 /////////////////////////////// ROS Logging ///////////////////////////////////
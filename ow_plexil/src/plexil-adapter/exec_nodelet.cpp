@@ -0,0 +1,121 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+// Plan executive nodelets for OceanWATERS and OWLAT.  Loaded in the same
+// nodelet manager as the simulator's publishers, telemetry, images and point
+// clouds reach the interface without being serialized.  They are equivalent to
+// ow_exec_node and owlat_exec_node, with the initial plan as the nodelet's
+// argument, and read the same private parameters.
+//
+// Because only one PLEXIL executive can run in one process, only one of these
+// can be loaded in a manager, and only once: the executive and interface are
+// not reinitialized if the nodelet is unloaded and loaded again.
+
+#include "PlexilPlanSelection.h"
+#include "OwExecutive.h"
+#include "OwInterface.h"
+#include "node_support.h"
+#ifdef OWLAT
+#include "OwlatInterface.h"
+#endif
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Set by the first executive nodelet loaded in the process.
+static std::atomic<bool> ExecLoaded { false };
+
+class ExecNodelet : public nodelet::Nodelet
+{
+ public:
+  ExecNodelet (const std::string& config_file)
+    : m_configFile (config_file) { }
+  ~ExecNodelet ();
+  ExecNodelet (const ExecNodelet&) = delete;
+  ExecNodelet& operator= (const ExecNodelet&) = delete;
+
+ protected:
+  virtual void initializeInterface () = 0;
+
+ private:
+  void onInit () override;
+  void run (const std::string& initial_plan);
+
+  const std::string m_configFile;
+  std::unique_ptr<PlexilPlanSelection> m_planSelection;
+
+  // Runs the executive's initialization and plan loop, which block, so that
+  // onInit returns to the manager.
+  std::thread m_thread;
+};
+
+ExecNodelet::~ExecNodelet ()
+{
+  if (m_planSelection) m_planSelection->stop();
+  if (m_thread.joinable()) m_thread.join();
+}
+
+void ExecNodelet::onInit ()
+{
+  if (ExecLoaded.exchange (true)) {
+    NODELET_ERROR ("A PLEXIL executive was already loaded in this process, "
+                   "not loading another.");
+    return;
+  }
+
+  std::string initial_plan = "None";
+  const std::vector<std::string>& args = getMyArgv();
+  if (! args.empty()) initial_plan = args[0];
+
+  set_private_namespace (getPrivateNodeHandle().getNamespace());
+  m_planSelection = std::make_unique<PlexilPlanSelection>();
+  m_thread = std::thread (&ExecNodelet::run, this, initial_plan);
+}
+
+void ExecNodelet::run (const std::string& initial_plan)
+{
+  if (! OwExecutive::instance()->initialize (m_configFile)) {
+    NODELET_ERROR ("Could not initialize Plexil executive.");
+    return;
+  }
+  initializeInterface();
+  m_planSelection->initialize (initial_plan);
+  m_planSelection->start();
+}
+
+class OwExecNodelet : public ExecNodelet
+{
+ public:
+  OwExecNodelet () : ExecNodelet ("ow-config.xml") { }
+
+ protected:
+  void initializeInterface () override
+  {
+    for (const std::string& lander : OwInterface::landers()) {
+      OwInterface::instance (lander)->initialize();
+    }
+  }
+};
+
+PLUGINLIB_EXPORT_CLASS (OwExecNodelet, nodelet::Nodelet)
+
+#ifdef OWLAT
+class OwlatExecNodelet : public ExecNodelet
+{
+ public:
+  OwlatExecNodelet () : ExecNodelet ("owlat_plans/owlat-config.xml") { }
+
+ protected:
+  void initializeInterface () override
+  {
+    OwlatInterface::instance()->initialize();
+  }
+};
+
+PLUGINLIB_EXPORT_CLASS (OwlatExecNodelet, nodelet::Nodelet)
+#endif
@@ -0,0 +1,57 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "fault_support.h"
+#include <ros/ros.h>
+
+FaultTracker::FaultTracker (const char* component,
+                            std::initializer_list<FaultDefinition> faults)
+  : m_component (component),
+    m_faults (faults),
+    m_relevantBits (0),
+    m_lastValue (0),
+    m_active (0)
+{
+  if (m_faults.size() > 32) {
+    ROS_ERROR ("Too many faults defined for %s, ignoring all but 32.",
+               component);
+    m_faults.resize (32);
+  }
+  for (const auto& fault : m_faults) m_relevantBits |= fault.value;
+}
+
+bool FaultTracker::update (uint64_t msg_value)
+{
+  msg_value &= m_relevantBits;
+  uint64_t changed_bits = msg_value ^ m_lastValue;
+  if (changed_bits == 0) return false;
+  m_lastValue = msg_value;
+
+  // Only faults that share a changed bit need to be re-evaluated.
+  uint32_t previous = m_active.load();
+  uint32_t current = previous;
+  for (size_t i = 0; i < m_faults.size(); i++) {
+    uint64_t value = m_faults[i].value;
+    if ((value & changed_bits) == 0) continue;
+    uint32_t bit = uint32_t(1) << i;
+    if ((msg_value & value) == value) current |= bit;
+    else current &= ~bit;
+  }
+  if (current == previous) return false;
+  m_active.store (current);
+
+  uint32_t transitions = previous ^ current;
+  for (size_t i = 0; i < m_faults.size(); i++) {
+    uint32_t bit = uint32_t(1) << i;
+    if (transitions & bit) {
+      if (current & bit) {
+        ROS_WARN ("Fault in %s: %s", m_component, m_faults[i].name);
+      }
+      else {
+        ROS_WARN ("Resolved fault in %s: %s", m_component, m_faults[i].name);
+      }
+    }
+  }
+  return (previous == 0) != (current == 0);
+}
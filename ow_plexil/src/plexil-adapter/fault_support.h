@@ -0,0 +1,49 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef OW_AUTONOMY_FAULT_SUPPORT_H
+#define OW_AUTONOMY_FAULT_SUPPORT_H
+
+// Support for the fault status messages published by ow_faults_detection.
+// Each message carries a bitmask for one component (system, arm, power,
+// pan/tilt); a fault is active when all of its bits are set.
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+struct FaultDefinition
+{
+  const char* name;  // for logging only
+  uint64_t value;
+};
+
+class FaultTracker
+{
+ public:
+  // At most 32 faults per component.
+  FaultTracker (const char* component,
+                std::initializer_list<FaultDefinition> faults);
+  FaultTracker (const FaultTracker&) = delete;
+  FaultTracker& operator= (const FaultTracker&) = delete;
+
+  // Record a new status message, logging each fault that started or was
+  // resolved.  Returns true when the component went from no active faults to
+  // some, or back.  Not reentrant: call from one thread (the fault callback
+  // queue) only.
+  bool update (uint64_t msg_value);
+
+  // Whether any fault of this component is active.  Safe from any thread.
+  bool active () const { return m_active.load() != 0; }
+
+ private:
+  const char* m_component;
+  std::vector<FaultDefinition> m_faults;
+  uint64_t m_relevantBits;           // union of all fault values
+  uint64_t m_lastValue;              // last message, masked by m_relevantBits
+  std::atomic<uint32_t> m_active;    // bit i set when m_faults[i] is active
+};
+
+#endif
@@ -0,0 +1,198 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+// Decoder of the flight recorder's files (see FlightRecorder.h).  Prints the
+// events kept in a file, oldest first, or a summary of them: the events of
+// each type and name, and the latency of each command from dispatch to
+// acknowledgment and to its final status.  Needs neither ROS nor PLEXIL.
+//
+// Usage: flight_recorder_decode [--csv | --summary] FILE
+//
+// Times are in seconds since the file was made.  By default the events are
+// printed in columns, with --csv as comma-separated values.
+//
+// The recorder is off unless the adapter's configuration has a FlightRecorder
+// element, e.g. in ow-config.xml or owlat-config.xml
+//
+//   <FlightRecorder File="ow_flight.rec" Events="1048576"/>
+//
+// with File relative to ~/.ros.  The shipped ones have it commented out.
+
+#include "FlightRecorder.h"
+
+// C++
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+static bool read_file (const char* path, FlightFileHeader& header,
+                       vector<FlightEvent>& events)
+{
+  FILE* file = fopen (path, "rb");
+  if (! file) {
+    fprintf (stderr, "Cannot open %s: %s\n", path, strerror (errno));
+    return false;
+  }
+  bool ok = fread (&header, sizeof (header), 1, file) == 1;
+  if (! ok || std::memcmp (header.magic, FlightMagic, sizeof (FlightMagic)) ||
+      header.version != FlightVersion ||
+      header.eventSize != sizeof (FlightEvent) || header.capacity == 0) {
+    fprintf (stderr, "%s is not a flight recorder file of this version.\n",
+             path);
+    fclose (file);
+    return false;
+  }
+
+  // The latest events, oldest first.
+  uint64_t count = std::min (header.written, header.capacity);
+  vector<FlightEvent> ring (header.capacity);
+  if (fread (ring.data(), sizeof (FlightEvent), ring.size(), file) !=
+      ring.size()) {
+    fprintf (stderr, "%s is cut short.\n", path);
+    fclose (file);
+    return false;
+  }
+  fclose (file);
+  events.reserve (count);
+  for (uint64_t n = header.written - count; n < header.written; n++) {
+    events.push_back (ring[n % header.capacity]);
+  }
+  return true;
+}
+
+static string event_name (const FlightEvent& event)
+{
+  return string (event.name, strnlen (event.name, FlightNameSize));
+}
+
+static void print_events (const FlightFileHeader& header,
+                          const vector<FlightEvent>& events, bool csv)
+{
+  const char* format = csv ? "%.9f,%u,%s,%s,%d,%.9g,%u\n"
+                           : "%14.6f %4u %-18s %-32s %6d %14.6g %3u\n";
+  if (csv) printf ("time,thread,type,name,id,value,status\n");
+  for (const FlightEvent& event : events) {
+    printf (format, (event.time - header.startTime) * 1e-9, event.thread,
+            flight_event_name (event.type), event_name (event).c_str(),
+            event.id, event.value, event.status);
+  }
+}
+
+// Durations in seconds, reported as count, mean and maximum.
+struct Durations
+{
+  void add (double seconds)
+  {
+    count++;
+    total += seconds;
+    max = std::max (max, seconds);
+  }
+  size_t count = 0;
+  double total = 0;
+  double max = 0;
+};
+
+static void print_durations (const char* what, const Durations& d)
+{
+  if (d.count == 0) return;
+  printf ("    %-16s %8zu  mean %10.6f s  max %10.6f s\n", what, d.count,
+          d.total / d.count, d.max);
+}
+
+static void print_summary (const FlightFileHeader& header,
+                           const vector<FlightEvent>& events)
+{
+  printf ("%llu events recorded, %zu kept, %llu dropped.\n",
+          (unsigned long long) header.written, events.size(),
+          (unsigned long long) header.dropped);
+  if (events.empty()) return;
+  printf ("From %.6f to %.6f s.\n", (events.front().time - header.startTime)
+          * 1e-9, (events.back().time - header.startTime) * 1e-9);
+
+  // Events by type and name.
+  std::map<std::pair<uint16_t, string>, size_t> counts;
+  for (const FlightEvent& event : events) {
+    counts[std::make_pair (event.type, event_name (event))]++;
+  }
+  printf ("\nEvents:\n");
+  for (const auto& entry : counts) {
+    printf ("  %-18s %-32s %8zu\n", flight_event_name (entry.first.first),
+            entry.first.second.c_str(), entry.second);
+  }
+
+  // Command latencies by name, from the commands dispatched within the file.
+  struct Command
+  {
+    string name;
+    int64_t dispatched;
+  };
+  struct CommandStats
+  {
+    Durations acked, finished;
+    size_t failed = 0;
+  };
+  std::map<int, Command> running;
+  std::map<string, CommandStats> stats;
+  for (const FlightEvent& event : events) {
+    auto type = static_cast<FlightEventType>(event.type);
+    if (type == FlightEventType::CommandDispatched) {
+      running[event.id] = { event_name (event), event.time };
+      continue;
+    }
+    auto it = running.find (event.id);
+    if (it == running.end()) continue;
+    CommandStats& s = stats[it->second.name];
+    double elapsed = (event.time - it->second.dispatched) * 1e-9;
+    if (type == FlightEventType::CommandAcked) s.acked.add (elapsed);
+    else if (type == FlightEventType::CommandFinished) {
+      s.finished.add (elapsed);
+      if (! event.status) s.failed++;
+      running.erase (it);
+    }
+  }
+  if (! stats.empty()) printf ("\nCommands, from dispatch:\n");
+  for (const auto& entry : stats) {
+    printf ("  %s (%zu failed)\n", entry.first.c_str(), entry.second.failed);
+    print_durations ("acknowledged", entry.second.acked);
+    print_durations ("finished", entry.second.finished);
+  }
+  for (const auto& entry : running) {
+    printf ("  %s (%d) did not finish.\n", entry.second.name.c_str(),
+            entry.first);
+  }
+}
+
+int main (int argc, char* argv[])
+{
+  bool csv = false, summary = false;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (! strcmp (argv[i], "--csv")) csv = true;
+    else if (! strcmp (argv[i], "--summary")) summary = true;
+    else if (! path && argv[i][0] != '-') path = argv[i];
+    else {
+      path = nullptr;
+      break;
+    }
+  }
+  if (! path || (csv && summary)) {
+    fprintf (stderr, "Usage: %s [--csv | --summary] FILE\n", argv[0]);
+    return 2;
+  }
+
+  FlightFileHeader header;
+  vector<FlightEvent> events;
+  if (! read_file (path, header, events)) return 1;
+  if (summary) print_summary (header, events);
+  else print_events (header, events, csv);
+  return 0;
+}
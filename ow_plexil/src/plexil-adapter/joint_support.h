@@ -7,8 +7,12 @@
 
 // Support for lander joints, based on ROS /joint_states message.
 
+#include <cstddef>
 #include <string>
 
+// NOTE: Joint is used as an index into per-joint arrays; keep NumJoints in
+// sync with the last enumerator.
+
 enum class Joint {
   shoulder_yaw,
   shoulder_pitch,
@@ -21,6 +25,13 @@ enum class Joint {
   grinder
 };
 
+const size_t NumJoints = static_cast<size_t>(Joint::grinder) + 1;
+
+inline size_t joint_index (Joint joint)
+{
+  return static_cast<size_t>(joint);
+}
+
 struct JointProperties
 {
   // Use compiler's default methods.
@@ -28,6 +39,11 @@ struct JointProperties
   std::string plexilName; // human-readable, no spaces
   double softTorqueLimit;
   double hardTorqueLimit;
+
+  // PLEXIL state names of the joint's telemetry, e.g. "HandYawPosition".
+  std::string positionState () const { return plexilName + "Position"; }
+  std::string velocityState () const { return plexilName + "Velocity"; }
+  std::string effortState () const { return plexilName + "Effort"; }
 };
 
 struct JointTelemetry
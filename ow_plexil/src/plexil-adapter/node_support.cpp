@@ -0,0 +1,18 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "node_support.h"
+
+// Empty for the node's private namespace.
+static std::string PrivateNamespace;
+
+ros::NodeHandle private_node_handle ()
+{
+  return ros::NodeHandle (PrivateNamespace.empty() ? "~" : PrivateNamespace);
+}
+
+void set_private_namespace (const std::string& ns)
+{
+  PrivateNamespace = ns;
+}
@@ -0,0 +1,21 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Ow_Node_Support_H
+#define Ow_Node_Support_H
+
+// Support for running the executive either as a ROS node or as a nodelet.
+
+#include <ros/ros.h>
+#include <string>
+
+// Node handle in the namespace of the executive's private parameters.  This is
+// the node's private namespace ("~"), unless set_private_namespace was called,
+// since a nodelet's private namespace is not that of its process.
+ros::NodeHandle private_node_handle ();
+
+// Call before initializing the executive and its interface.
+void set_private_namespace (const std::string& ns);
+
+#endif
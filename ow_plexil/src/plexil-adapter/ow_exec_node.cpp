@@ -16,6 +16,12 @@ int main(int argc, char* argv[])
 {
   // Initializations
   ros::init(argc, argv, "ow_exec_node");
+
+  // The global callback queue (clock, action clients, action timeouts) is
+  // serviced in the background; subsystem callbacks have their own queues.
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
   std::string initial_plan = "None";
 
   //checking if there is a plan given
@@ -27,11 +33,13 @@ int main(int argc, char* argv[])
     ROS_ERROR("Could not initialize Plexil executive, shutting down.");
     return 1;
   }
-  OwInterface::instance()->initialize();
+  for (const std::string& lander : OwInterface::landers()) {
+    OwInterface::instance (lander)->initialize();
+  }
   PlexilPlanSelection plan_selection;
   plan_selection.initialize(initial_plan); //initialize pubs, subs, etc
   plan_selection.start(); //begin control loop
-  ros::spin();
+  ros::waitForShutdown();
 
   // Never reached, because killing the process is the only way to terminate
   // this program.
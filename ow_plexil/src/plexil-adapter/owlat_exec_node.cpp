@@ -16,6 +16,12 @@ int main(int argc, char* argv[])
 {
   // Initializations
   ros::init(argc, argv, "owlat_exec_node");
+
+  // The global callback queue (clock, action clients, action timeouts) is
+  // serviced in the background; subsystem callbacks have their own queues.
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
   std::string initial_plan = "None";
 
   //checking if there is a plan given
@@ -31,7 +37,7 @@ int main(int argc, char* argv[])
   PlexilPlanSelection plan_selection;
   plan_selection.initialize(initial_plan); //initialize pubs, subs, etc
   plan_selection.start(); //begin control loop
-  ros::spin();
+  ros::waitForShutdown();
 
   // Never reached, because killing the process is the only way to terminate
   // this program.
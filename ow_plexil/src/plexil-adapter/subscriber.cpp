@@ -3,47 +3,107 @@
 // this repository.
 
 #include "subscriber.h"
-using std::vector;
 
-// The subscribers.  Their naming convention is:
-//   Subscribe<value-type><param-type>...
+// C++
+#include <deque>
+#include <map>
+#include <stdexcept>
+#include <tuple>
 
-static SubscribeBool SubscriberBool = nullptr;
-static SubscribeDouble SubscriberDouble = nullptr;
-static SubscribeString SubscriberString = nullptr;
-static SubscribeBoolString SubscriberBoolString = nullptr;
-static SubscribeDoubleVector SubscriberDoubleVector = nullptr;
+// The states resolved so far, by name and parameter, and by index.  The deque
+// keeps references to its elements valid as it grows.
+struct ResolvedState
+{
+  std::string name;
+  bool hasArg;
+  std::string arg;
+};
 
-void setSubscriber (SubscribeBool s) { SubscriberBool = s; }
-void setSubscriber (SubscribeDouble s) { SubscriberDouble = s; }
-void setSubscriber (SubscribeString s) { SubscriberString = s; }
-void setSubscriber (SubscribeBoolString s) { SubscriberBoolString = s; }
-void setSubscriber (SubscribeDoubleVector s) { SubscriberDoubleVector = s; }
+struct StateTable
+{
+  std::mutex mutex;
+  std::map<std::tuple<std::string, bool, std::string>, uint32_t> indices;
+  std::deque<ResolvedState> states;
+};
 
-// The overloaded publish function, one for each value/parameter combination
-// found in this application.
+static StateTable& state_table ()
+{
+  static StateTable table;
+  return table;
+}
 
-void publish (const string& state_name, bool val)
+StateHandle::StateHandle (const std::string& name)
 {
-  SubscriberBool (state_name, val);
+  resolve (name, nullptr);
 }
 
-void publish (const string& state_name, double val)
+StateHandle::StateHandle (const std::string& name, const std::string& arg)
+{
+  resolve (name, &arg);
+}
+
+void StateHandle::resolve (const std::string& name, const std::string* arg)
+{
+  StateTable& table = state_table();
+  std::lock_guard<std::mutex> lock (table.mutex);
+  auto key = std::make_tuple (name, arg != nullptr, arg ? *arg : std::string());
+  auto it = table.indices.find (key);
+  if (it != table.indices.end()) {
+    m_index = it->second;
+    return;
+  }
+  if (table.states.size() >= MaxStates) {
+    throw std::length_error ("too many published states");
+  }
+  m_index = table.states.size();
+  table.states.push_back ({ name, arg != nullptr, std::get<2> (key) });
+  table.indices.emplace (std::move (key), m_index);
+}
+
+const std::string& StateHandle::name () const
+{
+  StateTable& table = state_table();
+  std::lock_guard<std::mutex> lock (table.mutex);
+  return table.states.at (m_index).name;
+}
+
+const std::string* StateHandle::arg () const
+{
+  StateTable& table = state_table();
+  std::lock_guard<std::mutex> lock (table.mutex);
+  const ResolvedState& state = table.states.at (m_index);
+  return state.hasArg ? &state.arg : nullptr;
+}
+
+Subscription::Subscription (std::function<void()> cancel)
+  : m_cancel (std::move (cancel))
+{ }
+
+Subscription::Subscription (Subscription&& other)
+  : m_cancel (std::move (other.m_cancel))
 {
-  SubscriberDouble (state_name, val);
+  other.m_cancel = nullptr;
 }
 
-void publish (const string& state_name, const string& val)
+Subscription& Subscription::operator= (Subscription&& other)
 {
-  SubscriberString (state_name, val);
+  if (this != &other) {
+    cancel();
+    m_cancel = std::move (other.m_cancel);
+    other.m_cancel = nullptr;
+  }
+  return *this;
 }
 
-void publish (const std::string& state_name, bool val, const std::string& arg)
+Subscription::~Subscription ()
 {
-  SubscriberBoolString (state_name, val, arg);
+  cancel();
 }
 
-void publish (const std::string& state_name, vector<double> vals)
+void Subscription::cancel ()
 {
-  SubscriberDoubleVector (state_name, vals);
+  if (m_cancel) {
+    m_cancel();
+    m_cancel = nullptr;
+  }
 }
@@ -5,42 +5,260 @@
 #ifndef Ow_Plexil_Subscriber
 #define Ow_Plexil_Subscriber
 
-// This is a barebones publish-subscribe facility for PLEXIL.  It provides a set
-// of subscription functions specific to various combinations of return type and
-// parameters.
-
-// To do: incorporate the new template-based version of this pattern developed
-// in the summer of 2020 by Albert Kutsyy.
+// This is a barebones publish-subscribe facility for PLEXIL.  Each combination
+// of value and parameter types published has its own channel, chosen at
+// compile time from the types, to which any number of subscribers may be
+// attached.  Publishing to a channel without subscribers does nothing.
+//
+// Values are passed to subscribers by const reference; none are copied.
+// Subscribers are called on the publishing thread, in the order they
+// subscribed.  Once unsubscribed, a subscriber is not called again: ending a
+// subscription waits for publications under way to the channel.
+//
+// States are published by handle (see StateHandle), resolved from the state's
+// name once, when the publisher is set up, so that publishing neither hashes
+// the name nor takes a lock.
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
-using std::string;
-using std::vector;
-
-// Subscriber types
-typedef void (* SubscribeBool) (const string& state_name, bool val);
-typedef void (* SubscribeDouble) (const string& state_name, double val);
-typedef void (* SubscribeString) (const string& state_name,
-                                  const string& val);
-typedef void (* SubscribeBoolString) (const string& state_name,
-                                      bool val, const string& arg);
-typedef void (* SubscribeDoubleVector) (const string& state_name,
-                                      vector<double> vals);
-
-
-// Setters for subscribers of each supported type signature
-void setSubscriber (SubscribeBool);
-void setSubscriber (SubscribeDouble);
-void setSubscriber (SubscribeString);
-void setSubscriber (SubscribeBoolString);
-void setSubscriber (SubscribeDoubleVector);
-
-// Publish a state name, which notifies the subscriber.
-void publish (const string& state_name, bool val);
-void publish (const string& state_name, double val);
-void publish (const string& state_name, const string& val);
-void publish (const string& state_name, bool val, const string& arg);
-void publish (const string& state_name, vector<double> vals);
-using std::vector;
+
+// PLEXIL API
+#include <ArrayImpl.hh>
+
+// A published state: a name and optional string parameter, e.g. Running of
+// an operation, numbered by their first resolution.  Resolving a handle takes
+// a lock; use it once, at setup, and publish by the handle.  Handles are
+// never released, so the numbers stay dense and index subscribers' tables.
+class StateHandle
+{
+ public:
+  StateHandle () = default;  // of no state; not to be published
+  explicit StateHandle (const std::string& name);
+  StateHandle (const std::string& name, const std::string& arg);
+
+  bool valid () const { return m_index != None; }
+  size_t index () const { return m_index; }
+
+  // The state's name, and its parameter, or null if it has none.
+  const std::string& name () const;
+  const std::string* arg () const;
+
+  // More states than subscribers are expected to index.
+  static const size_t MaxStates = 1 << 16;
+
+ private:
+  void resolve (const std::string& name, const std::string* arg);
+
+  static const uint32_t None = UINT32_MAX;
+  uint32_t m_index = None;
+};
+
+// Ends a subscription when destroyed.  Movable, not copyable.
+class Subscription
+{
+ public:
+  Subscription () = default;
+  explicit Subscription (std::function<void()> cancel);
+  Subscription (Subscription&&);
+  Subscription& operator= (Subscription&&);
+  ~Subscription ();
+  Subscription (const Subscription&) = delete;
+  Subscription& operator= (const Subscription&) = delete;
+
+  // Unsubscribe now, waiting for publications under way (see Channel).
+  void cancel ();
+
+ private:
+  std::function<void()> m_cancel;
+};
+
+template <class... Args>
+class Channel
+{
+ public:
+  using Subscriber = std::function<void (const Args&...)>;
+
+  static Subscription subscribe (Subscriber subscriber)
+  {
+    std::lock_guard<std::mutex> lock (state().mutex);
+    uint64_t id = ++state().lastId;
+    auto next = std::make_unique<List> (current() ? *current() : List());
+    next->emplace_back (id, std::move (subscriber));
+    install (std::move (next));
+    return Subscription ([id] () { unsubscribe (id); });
+  }
+
+  static void publish (const Args&... args)
+  {
+    Reading reading;
+    const List* subscribers = s_current.load();
+    if (! subscribers) return;
+    for (const auto& subscriber : *subscribers) subscriber.second (args...);
+  }
+
+ private:
+  using List = std::vector<std::pair<uint64_t, Subscriber>>;
+
+  // Subscriber lists are replaced rather than changed, so that publishing
+  // takes no lock.  A replaced list is retired, and freed once no publication
+  // can be going through it.  Publications count themselves in one of two
+  // epochs; a replacement moves new publications to the other epoch and
+  // waits for those of the old one, which alone can hold a retired list.
+  // Replacing a list from a subscriber of the channel cannot wait for its own
+  // publication, so then the retired lists are kept for the next replacement,
+  // and a subscriber it removes may still be called by publications under way
+  // on other threads.
+  struct State
+  {
+    std::mutex mutex;
+    uint64_t lastId = 0;
+    std::unique_ptr<const List> list;  // the current one
+    std::vector<std::unique_ptr<const List>> retired;
+  };
+
+  static State& state ()
+  {
+    static State s;
+    return s;
+  }
+
+  // A publication, counted in the current epoch from before it loads the
+  // list until it is done with it, even if a subscriber throws; see reclaim.
+  struct Reading
+  {
+    Reading () : epoch (s_epoch.load())
+    {
+      s_readers[epoch].fetch_add (1);
+      s_publishing++;
+    }
+    ~Reading ()
+    {
+      s_publishing--;
+      s_readers[epoch].fetch_sub (1);
+    }
+    const unsigned epoch;
+  };
+
+  static const List* current ()
+  {
+    return state().list.get();
+  }
+
+  static void install (std::unique_ptr<const List> list)
+  {
+    // Call with the state's mutex held.
+    State& st = state();
+    s_current.store (list->empty() ? nullptr : list.get());
+    if (st.list) st.retired.push_back (std::move (st.list));
+    st.list = std::move (list);
+    reclaim();
+  }
+
+  static void reclaim ()
+  {
+    // Call with the state's mutex held, after s_current is replaced.
+    // Publications counted in the epoch ended here may hold a retired list;
+    // those of the new one load s_current after the replacement.
+    State& st = state();
+    if (st.retired.empty() || s_publishing > 0) return;
+    unsigned old = s_epoch.load();
+    s_epoch.store (old ^ 1);
+    while (s_readers[old].load() != 0) std::this_thread::yield();
+    st.retired.clear();
+  }
+
+  static void unsubscribe (uint64_t id)
+  {
+    std::lock_guard<std::mutex> lock (state().mutex);
+    if (! current()) return;
+    auto next = std::make_unique<List>();
+    for (const auto& subscriber : *current()) {
+      if (subscriber.first != id) next->push_back (subscriber);
+    }
+    install (std::move (next));
+  }
+
+  // Accessed sequentially consistently, on which reclaim relies.
+  static std::atomic<const List*> s_current;
+  static std::atomic<unsigned> s_epoch;
+  static std::atomic<size_t> s_readers[2];  // publications by epoch
+
+  // Publications to the channel under way on the calling thread.
+  static thread_local int s_publishing;
+};
+
+template <class... Args>
+std::atomic<const typename Channel<Args...>::List*>
+Channel<Args...>::s_current { nullptr };
+
+template <class... Args>
+std::atomic<unsigned> Channel<Args...>::s_epoch { 0 };
+
+template <class... Args>
+std::atomic<size_t> Channel<Args...>::s_readers[2] = { {0}, {0} };
+
+template <class... Args>
+thread_local int Channel<Args...>::s_publishing = 0;
+
+// The channels of the states published in this application, by value type.
+// Their subscribers receive the state's handle first.
+using BoolStates = Channel<StateHandle, bool>;
+using DoubleStates = Channel<StateHandle, double>;
+using StringStates = Channel<StateHandle, std::string>;
+using DoubleVectorStates = Channel<StateHandle, std::vector<double>>;
+using RealArrayStates = Channel<StateHandle, PLEXIL::RealArray>;
+
+// Publications made by a thread while a PublishBatch exists may be delivered
+// together when the outermost batch is destroyed.  Batches nest; subscribers
+// to the Batches channel receive Begin and End for each of them.
+enum class BatchEvent { Begin, End };
+using Batches = Channel<BatchEvent>;
+
+class PublishBatch
+{
+ public:
+  PublishBatch () { Batches::publish (BatchEvent::Begin); }
+  ~PublishBatch () { Batches::publish (BatchEvent::End); }
+  PublishBatch (const PublishBatch&) = delete;
+  PublishBatch& operator= (const PublishBatch&) = delete;
+};
+
+// Publish a state, which notifies its channel's subscribers.  These overloads
+// fix the channel of each call, so that e.g. a float is published as a double
+// rather than to a channel of its own.
+
+inline void publish (const StateHandle& state, bool val)
+{
+  BoolStates::publish (state, val);
+}
+
+inline void publish (const StateHandle& state, double val)
+{
+  DoubleStates::publish (state, val);
+}
+
+inline void publish (const StateHandle& state, const std::string& val)
+{
+  StringStates::publish (state, val);
+}
+
+inline void publish (const StateHandle& state, const std::vector<double>& vals)
+{
+  DoubleVectorStates::publish (state, vals);
+}
+
+// As above, for telemetry kept in a RealArray, which the subscriber may copy
+// into the value it sends without converting it.
+inline void publish (const StateHandle& state, const PLEXIL::RealArray& vals)
+{
+  RealArrayStates::publish (state, vals);
+}
 
 #endif
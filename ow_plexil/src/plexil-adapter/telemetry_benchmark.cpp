@@ -0,0 +1,375 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+// Throughput benchmark of the telemetry path from ROS messages to the PLEXIL
+// executive.  Publishes synthetic joint state, power and fault messages to the
+// testbed interface's subscribers at a given rate, and reports the rate at
+// which telemetry reaches the exec, the heap allocations made per message, and
+// the latency from publication of a message to the exec notification that
+// delivers it.
+//
+// Needs a ROS master, but neither the simulator nor the PLEXIL executive: the
+// interface's publications are received by stand-ins for the adapter's
+// receivers (see CommonAdapter.cpp), which find the state's entry and build
+// its value as those do, and then count it as delivered.
+//
+// Private parameters:
+//   ~rate        messages per second of each topic (default 100; 0 for as
+//                fast as possible)
+//   ~duration    seconds to publish (default 10)
+//   ~fault_period  messages between changes of the fault messages (default 50)
+//   ~synthetic   publish synthetic telemetry (default true).  If false, only
+//                receives, e.g. from 'rosbag play' of a recorded run; latency
+//                is then not measured.
+//   ~lander      "ow" (default), or "owlat" if built with OWLAT support
+
+#include "CommandLatency.h"
+#include "OwInterface.h"
+#include "StateRegistry.h"
+#include "subscriber.h"
+#ifdef OWLAT_BENCHMARK
+#include "OwlatInterface.h"
+#endif
+
+// ROS
+#include <ros/ros.h>
+#include <std_msgs/Float64.h>
+
+// PLEXIL API
+#include <Value.hh>
+
+// C++
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+
+using std::string;
+using std::vector;
+
+//////////////////////////// Allocation counting ////////////////////////////
+
+// Heap allocations made by every thread but the publisher, i.e. by the
+// delivery and handling of the messages.
+static std::atomic<uint64_t> Allocations { 0 };
+static thread_local bool CountAllocations = true;
+
+void* operator new (size_t size)
+{
+  if (CountAllocations) Allocations.fetch_add (1, std::memory_order_relaxed);
+  void* p = std::malloc (size ? size : 1);
+  if (! p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete (void* p) noexcept
+{
+  std::free (p);
+}
+
+void operator delete (void* p, size_t) noexcept
+{
+  std::free (p);
+}
+
+/////////////////////////////// Mock executive ///////////////////////////////
+
+// Each synthetic sample carries its sequence number as the (first) value of
+// the tracer state, by which the receivers find its publication time.
+static const StateHandle Tracer ("ShoulderYawPosition");
+
+static const size_t SequenceRing = 4096;
+static std::array<std::atomic<int64_t>, SequenceRing> PublishTimes;
+
+static StateRegistry States;
+static std::atomic<uint64_t> ValuesDelivered { 0 };
+static std::atomic<uint64_t> Notifications { 0 };
+
+static std::mutex LatencyMutex;
+static LatencyHistogram Latency;
+
+// Per-thread state of the batch being received, as in CommonAdapter.
+static thread_local int BatchDepth = 0;
+static thread_local int64_t BatchTracer = -1;
+
+static void notify_exec ()
+{
+  Notifications++;
+  if (BatchTracer < 0) return;
+  int64_t published = PublishTimes[BatchTracer % SequenceRing];
+  BatchTracer = -1;
+  if (published == 0) return;
+  std::lock_guard<std::mutex> lock (LatencyMutex);
+  Latency.add (command_timestamp() - published);
+}
+
+static void deliver (const StateRegistry::Entry&, const PLEXIL::Value&)
+{
+  ValuesDelivered++;
+  if (BatchDepth == 0) notify_exec();
+}
+
+static void trace (const StateHandle& state, double val)
+{
+  if (state.index() == Tracer.index() && val >= 0) BatchTracer = int64_t (val);
+}
+
+static void receive_bool (const StateHandle& state, bool val)
+{
+  deliver (States.entry (state), PLEXIL::Value (val));
+}
+
+static void receive_double (const StateHandle& state, double val)
+{
+  trace (state, val);
+  deliver (States.entry (state), PLEXIL::Value (val));
+}
+
+static void receive_string (const StateHandle& state, const string& val)
+{
+  deliver (States.entry (state), PLEXIL::Value (val));
+}
+
+static void receive_double_vector (const StateHandle& state,
+                                   const vector<double>& vals)
+{
+  if (! vals.empty()) trace (state, vals[0]);
+  deliver (States.entry (state), PLEXIL::Value (vals));
+}
+
+static void receive_real_array (const StateHandle& state,
+                                const PLEXIL::RealArray& vals)
+{
+  double first;
+  if (vals.getElement (0, first)) trace (state, first);
+  deliver (States.entry (state), PLEXIL::Value (vals));
+}
+
+static void receive_batch (BatchEvent event)
+{
+  if (event == BatchEvent::Begin) BatchDepth++;
+  else if (BatchDepth > 0 && --BatchDepth == 0) notify_exec();
+}
+
+/////////////////////////////// Synthetic telemetry ///////////////////////////
+
+// Publishes one of each message per call, with the given sequence number.
+class TelemetrySource
+{
+ public:
+  virtual ~TelemetrySource () = default;
+  virtual void publish (uint64_t seq, bool fault) = 0;
+  virtual size_t messagesPerSample () const = 0;
+};
+
+class OwTelemetrySource : public TelemetrySource
+{
+ public:
+  OwTelemetrySource (ros::NodeHandle& nh)
+    : m_jointStates (nh.advertise<sensor_msgs::JointState>
+                     ("/joint_states", 3)),
+      m_soc (nh.advertise<std_msgs::Float64>
+             ("/power_system_node/state_of_charge", 3)),
+      m_temperature (nh.advertise<std_msgs::Float64>
+                     ("/power_system_node/battery_temperature", 3)),
+      m_armFaults (nh.advertise<ow_faults_detection::ArmFaults>
+                   ("/faults/arm_faults_status", 3)),
+      m_powerFaults (nh.advertise<ow_faults_detection::PowerFaults>
+                     ("/faults/power_faults_status", 3))
+  {
+    m_template.name = { "j_shou_yaw", "j_shou_pitch", "j_prox_pitch",
+                        "j_dist_pitch", "j_hand_yaw", "j_scoop_yaw",
+                        "j_ant_pan", "j_ant_tilt", "j_grinder" };
+    m_template.position.assign (m_template.name.size(), 0.1);
+    m_template.velocity.assign (m_template.name.size(), 0.01);
+    m_template.effort.assign (m_template.name.size(), 1.0);
+  }
+
+  void publish (uint64_t seq, bool fault) override
+  {
+    // Messages are published by pointer, so that delivery within the process
+    // does not serialize them.
+    auto joints = boost::make_shared<sensor_msgs::JointState>(m_template);
+    joints->header.seq = seq;
+    joints->position[0] = seq;  // j_shou_yaw, the tracer
+    m_jointStates.publish (joints);
+
+    auto soc = boost::make_shared<std_msgs::Float64>();
+    soc->data = 0.9;
+    m_soc.publish (soc);
+    auto temperature = boost::make_shared<std_msgs::Float64>();
+    temperature->data = 20.0;
+    m_temperature.publish (temperature);
+
+    auto arm_faults = boost::make_shared<ow_faults_detection::ArmFaults>();
+    arm_faults->value = fault ? 2 : 0;  // TRAJECTORY_GENERATION_ERROR
+    m_armFaults.publish (arm_faults);
+    auto power_faults = boost::make_shared<ow_faults_detection::PowerFaults>();
+    power_faults->value = fault ? 1 : 0;  // HARDWARE_ERROR
+    m_powerFaults.publish (power_faults);
+  }
+
+  size_t messagesPerSample () const override { return 5; }
+
+ private:
+  sensor_msgs::JointState m_template;
+  ros::Publisher m_jointStates;
+  ros::Publisher m_soc;
+  ros::Publisher m_temperature;
+  ros::Publisher m_armFaults;
+  ros::Publisher m_powerFaults;
+};
+
+#ifdef OWLAT_BENCHMARK
+class OwlatTelemetrySource : public TelemetrySource
+{
+ public:
+  OwlatTelemetrySource (ros::NodeHandle& nh)
+    : m_angles (nh.advertise<owlat_sim_msgs::ARM_JOINT_ANGLES>
+                ("/owlat_sim/ARM_JOINT_ANGLES", 3)),
+      m_torques (nh.advertise<owlat_sim_msgs::ARM_JOINT_TORQUES>
+                 ("/owlat_sim/ARM_JOINT_TORQUES", 3)),
+      m_force (nh.advertise<owlat_sim_msgs::ARM_FT_FORCE>
+               ("/owlat_sim/ARM_FT_FORCE", 3))
+  { }
+
+  void publish (uint64_t seq, bool fault) override
+  {
+    auto angles = boost::make_shared<owlat_sim_msgs::ARM_JOINT_ANGLES>();
+    angles->value.fill (0.1);
+    angles->value[0] = seq;  // the tracer
+    m_angles.publish (angles);
+
+    auto torques = boost::make_shared<owlat_sim_msgs::ARM_JOINT_TORQUES>();
+    torques->value.fill (fault ? 100.0 : 1.0);
+    m_torques.publish (torques);
+    auto force = boost::make_shared<owlat_sim_msgs::ARM_FT_FORCE>();
+    force->value.fill (1.0);
+    m_force.publish (force);
+  }
+
+  size_t messagesPerSample () const override { return 3; }
+
+ private:
+  ros::Publisher m_angles;
+  ros::Publisher m_torques;
+  ros::Publisher m_force;
+};
+#endif
+
+/////////////////////////////////// Main ///////////////////////////////////
+
+int main (int argc, char* argv[])
+{
+  ros::init (argc, argv, "telemetry_benchmark");
+  ros::AsyncSpinner spinner (1);
+  spinner.start();
+
+  ros::NodeHandle private_nh ("~");
+  double rate, duration;
+  int fault_period;
+  bool synthetic;
+  string lander;
+  private_nh.param ("rate", rate, 100.0);
+  private_nh.param ("duration", duration, 10.0);
+  private_nh.param ("fault_period", fault_period, 50);
+  private_nh.param ("synthetic", synthetic, true);
+  private_nh.param<string> ("lander", lander, "ow");
+
+  Subscription subscriptions[] = {
+    BoolStates::subscribe (receive_bool),
+    DoubleStates::subscribe (receive_double),
+    StringStates::subscribe (receive_string),
+    DoubleVectorStates::subscribe (receive_double_vector),
+    RealArrayStates::subscribe (receive_real_array),
+    Batches::subscribe (receive_batch)
+  };
+
+  ros::NodeHandle nh;
+  std::unique_ptr<TelemetrySource> source;
+  if (lander == "ow") {
+    OwInterface::instance()->initialize();
+    source = std::make_unique<OwTelemetrySource>(nh);
+  }
+#ifdef OWLAT_BENCHMARK
+  else if (lander == "owlat") {
+    Tracer = "ArmJointAngles";
+    OwlatInterface::instance()->initialize();
+    source = std::make_unique<OwlatTelemetrySource>(nh);
+  }
+#endif
+  else {
+    ROS_ERROR ("telemetry_benchmark: unsupported lander %s", lander.c_str());
+    return 1;
+  }
+
+  // Let the subscribers connect before measuring.
+  ros::WallDuration(1.0).sleep();
+
+  ROS_INFO ("telemetry_benchmark: %s telemetry for %.1f s at %.1f Hz",
+            synthetic ? "publishing" : "receiving", duration, rate);
+
+  CountAllocations = false;  // the publisher's own allocations
+  uint64_t allocations_start = Allocations;
+  uint64_t values_start = ValuesDelivered;
+  uint64_t notifications_start = Notifications;
+  uint64_t samples = 0;
+
+  using std::chrono::steady_clock;
+  auto start = steady_clock::now();
+  auto end = start + std::chrono::duration<double>(duration);
+  auto period = std::chrono::duration_cast<steady_clock::duration>
+    (std::chrono::duration<double>(rate > 0 ? 1.0 / rate : 0));
+  auto next = start;
+  while (ros::ok() && steady_clock::now() < end) {
+    if (! synthetic) {
+      std::this_thread::sleep_for (std::chrono::milliseconds (100));
+      continue;
+    }
+    bool fault = fault_period > 0 && (samples / fault_period) % 2 == 1;
+    PublishTimes[samples % SequenceRing] = command_timestamp();
+    source->publish (samples, fault);
+    samples++;
+    if (rate > 0) {
+      next += period;
+      std::this_thread::sleep_until (next);
+    }
+  }
+
+  // Let the last messages drain.
+  ros::WallDuration(0.5).sleep();
+
+  double elapsed =
+    std::chrono::duration<double>(steady_clock::now() - start).count();
+  uint64_t allocations = Allocations - allocations_start;
+  uint64_t values = ValuesDelivered - values_start;
+  uint64_t notifications = Notifications - notifications_start;
+  uint64_t messages = samples * source->messagesPerSample();
+
+  ROS_INFO ("telemetry_benchmark: %.1f s, %lu values (%.0f/s), "
+            "%lu exec notifications (%.0f/s)", elapsed,
+            (unsigned long) values, values / elapsed,
+            (unsigned long) notifications, notifications / elapsed);
+  if (synthetic) {
+    ROS_INFO ("telemetry_benchmark: %lu messages published (%.0f/s), "
+              "%.1f allocations per message", (unsigned long) messages,
+              messages / elapsed,
+              messages ? double (allocations) / messages : 0.0);
+    std::lock_guard<std::mutex> lock (LatencyMutex);
+    ROS_INFO ("telemetry_benchmark: publish to exec notification, "
+              "%zu of %lu samples: p50 %.6f s, p90 %.6f s, p99 %.6f s, "
+              "max %.6f s", Latency.count(), (unsigned long) samples,
+              Latency.percentile (0.5), Latency.percentile (0.9),
+              Latency.percentile (0.99), Latency.max());
+  }
+  else {
+    ROS_INFO ("telemetry_benchmark: %.1f allocations per exec notification",
+              notifications ? double (allocations) / notifications : 0.0);
+  }
+
+  ros::shutdown();
+  return 0;
+}
@@ -0,0 +1,213 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "IdentifySampleLocation.h"
+#include <pluginlib/class_list_macros.h>
+#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+#include <geometry_msgs/PointStamped.h>
+#include <visualization_msgs/Marker.h>
+#include <algorithm>
+#include <thread>
+
+using std::lock_guard;
+using std::make_pair;
+using std::mutex;
+using std::shared_future;
+using std::vector;
+
+// Made up, as in the Python server this replaces.
+const int DefaultHistorySize = 50;
+const int SynchronizerQueueSize = 10;
+const double TransformTimeout = 5.0;  // seconds
+
+const char* CameraFrame = "StereoCameraLeft_optical_frame";
+const char* BaseFrame = "base_link";
+
+void IdentifySampleLocation::onInit ()
+{
+  ros::NodeHandle& nh = getNodeHandle();
+  ros::NodeHandle& private_nh = getPrivateNodeHandle();
+
+  int history_size, threads;
+  private_nh.param ("history_size", history_size, DefaultHistorySize);
+  private_nh.param ("worker_threads", threads,
+                    static_cast<int>(std::thread::hardware_concurrency()));
+  m_historySize = std::max (history_size, 1);
+  m_workers.start (std::max (threads, 1));
+
+  m_tfListener = std::make_unique<tf2_ros::TransformListener> (m_tfBuffer);
+
+  // Publishes the chosen image with its contours and sample location drawn
+  // on, and a marker at the sample location.
+  const int qsize = 10;
+  m_imagePublisher = nh.advertise<sensor_msgs::Image> ("sample_location", qsize);
+  m_markerPublisher = nh.advertise<visualization_msgs::Marker>
+    ("sample_point_visualization", qsize);
+
+  m_imageSubscriber = std::make_unique<ImageSubscriber>
+    (nh, "/StereoCamera/left/image_rect_color", SynchronizerQueueSize);
+  m_cloudSubscriber = std::make_unique<CloudSubscriber>
+    (nh, "/StereoCamera/points2", SynchronizerQueueSize);
+  m_synchronizer = std::make_unique<Synchronizer>
+    (*m_imageSubscriber, *m_cloudSubscriber, SynchronizerQueueSize);
+  m_synchronizer->registerCallback
+    (boost::bind (&IdentifySampleLocation::frameCallback, this, _1, _2));
+
+  const bool auto_start = false;
+  m_server = std::make_unique<ActionServer>
+    (nh, "IdentifySampleLocation",
+     boost::bind (&IdentifySampleLocation::execute, this, _1), auto_start);
+  m_server->start();
+
+  NODELET_INFO ("IdentifySampleLocation ready, %d worker threads",
+                static_cast<int>(m_workers.size()));
+}
+
+void IdentifySampleLocation::frameCallback
+(const sensor_msgs::Image::ConstPtr& image,
+ const sensor_msgs::PointCloud2::ConstPtr& cloud)
+{
+  lock_guard<mutex> lock (m_historyMutex);
+  m_history.push_back ({ image, cloud });
+  if (m_history.size() <= m_historySize) return;
+
+  // Drop the oldest frame and its results.
+  ros::Time stamp = m_history.front().image->header.stamp;
+  m_history.pop_front();
+  lock_guard<mutex> results_lock (m_resultsMutex);
+  auto first = m_results.lower_bound (make_pair (stamp, SampleFilter::Dark));
+  auto last = first;
+  while (last != m_results.end() && last->first.first == stamp) ++last;
+  m_results.erase (first, last);
+}
+
+shared_future<FrameResult>
+IdentifySampleLocation::resultFor (const Frame& frame, SampleFilter filter)
+{
+  auto task = [frame, filter] () {
+    return process_frame (frame.image, frame.cloud, filter);
+  };
+
+  // Unstamped frames cannot be told apart, so are not cached.
+  ros::Time stamp = frame.image->header.stamp;
+  lock_guard<mutex> lock (m_resultsMutex);
+  if (! stamp.isZero()) {
+    auto it = m_results.find (make_pair (stamp, filter));
+    if (it != m_results.end()) return it->second;
+  }
+  auto job = std::make_shared<std::packaged_task<FrameResult()>> (task);
+  shared_future<FrameResult> result = job->get_future().share();
+  if (! stamp.isZero()) m_results.emplace (make_pair (stamp, filter), result);
+  m_workers.enqueue ([job] () { (*job)(); });
+  return result;
+}
+
+void IdentifySampleLocation::execute
+(const ow_plexil::IdentifyLocationGoalConstPtr& goal)
+{
+  SampleFilter filter = sample_filter (goal->filter_type);
+  if (filter == SampleFilter::Unknown) {
+    NODELET_ERROR ("Unknown/Unsupported filter type specified!");
+    finish (false);
+    return;
+  }
+
+  vector<Frame> frames;
+  {
+    lock_guard<mutex> lock (m_historyMutex);
+    if (m_history.empty() || goal->num_images <= 0) {
+      NODELET_INFO ("No images have been recorded");
+      finish (false);
+      return;
+    }
+    size_t count = static_cast<size_t>(goal->num_images);
+    if (count > m_history.size()) {
+      NODELET_WARN ("Goal is larger than total images recorded, only %zu "
+                    "images will be processed.", m_history.size());
+      count = m_history.size();
+    }
+    frames.assign (m_history.end() - count, m_history.end());
+  }
+
+  // Queue all frames before waiting on any.
+  vector<shared_future<FrameResult>> results;
+  for (const Frame& frame : frames) {
+    results.push_back (resultFor (frame, filter));
+  }
+
+  // The frame whose candidate has the largest contour, earliest on ties.
+  int best = -1;
+  for (size_t i = 0; i < results.size(); i++) {
+    const FrameResult& result = results[i].get();
+    if (result.valid && (best < 0 || result.area > results[best].get().area)) {
+      best = i;
+    }
+  }
+
+  geometry_msgs::Point location;
+  if (best < 0 ||
+      ! toBaseFrame (*frames[best].cloud, results[best].get().point, location)) {
+    NODELET_INFO ("Could not find valid sample location");
+    finish (false);
+    return;
+  }
+
+  auto image = annotate_frame (frames[best].image, results[best].get());
+  if (image) m_imagePublisher.publish (image);
+  visualize (location);
+  finish (true, location);
+}
+
+void IdentifySampleLocation::finish (bool success,
+                                     const geometry_msgs::Point& location)
+{
+  ow_plexil::IdentifyLocationResult result;
+  result.success = success;
+  result.sample_location = location;
+  m_server->setSucceeded (result);
+}
+
+bool IdentifySampleLocation::toBaseFrame (const sensor_msgs::PointCloud2& cloud,
+                                          const cv::Point3d& point,
+                                          geometry_msgs::Point& out)
+{
+  // The latest transform is used, as the camera does not move between taking
+  // the pictures and identifying the sample.
+  geometry_msgs::PointStamped camera_point, base_point;
+  camera_point.header.frame_id = cloud.header.frame_id.empty() ?
+    CameraFrame : cloud.header.frame_id;
+  camera_point.point.x = point.x;
+  camera_point.point.y = point.y;
+  camera_point.point.z = point.z;
+  try {
+    geometry_msgs::TransformStamped transform = m_tfBuffer.lookupTransform
+      (BaseFrame, camera_point.header.frame_id, ros::Time (0),
+       ros::Duration (TransformTimeout));
+    tf2::doTransform (camera_point, base_point, transform);
+  }
+  catch (const tf2::TransformException& e) {
+    NODELET_INFO ("Could not transform point to %s frame: %s", BaseFrame,
+                  e.what());
+    return false;
+  }
+  out = base_point.point;
+  return true;
+}
+
+void IdentifySampleLocation::visualize (const geometry_msgs::Point& location)
+{
+  visualization_msgs::Marker marker;
+  marker.id = 0;
+  marker.header.frame_id = BaseFrame;
+  marker.type = visualization_msgs::Marker::SPHERE;
+  marker.action = visualization_msgs::Marker::ADD;
+  marker.scale.x = marker.scale.y = marker.scale.z = 0.1;
+  marker.color.g = 1.0;
+  marker.color.a = 1.0;
+  marker.pose.position = location;
+  marker.pose.orientation.w = 1.0;
+  m_markerPublisher.publish (marker);
+}
+
+PLUGINLIB_EXPORT_CLASS (IdentifySampleLocation, nodelet::Nodelet)
@@ -0,0 +1,99 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Identify_Sample_Location_H
+#define Identify_Sample_Location_H
+
+// The IdentifySampleLocation action server, as a nodelet.  It keeps a history
+// of synchronized rectified images and point clouds from the stereo camera,
+// and for each goal finds the candidate sample spot with the largest contour
+// in the most recent frames, returning its location in the base_link frame.
+//
+// Frames are processed on a pool of worker threads, and the result for each
+// frame and filter is kept while the frame is in the history, so that goals
+// over overlapping frames reuse it.  Loaded in the same manager as the camera
+// pipeline, the messages are passed without copying.
+
+#include "SampleLocator.h"
+#include "ThreadPool.h"
+
+#include <nodelet/nodelet.h>
+#include <actionlib/server/simple_action_server.h>
+#include <message_filters/subscriber.h>
+#include <message_filters/time_synchronizer.h>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+#include <geometry_msgs/Point.h>
+#include <ow_plexil/IdentifyLocationAction.h>
+
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+class IdentifySampleLocation : public nodelet::Nodelet
+{
+ public:
+  IdentifySampleLocation () = default;
+  IdentifySampleLocation (const IdentifySampleLocation&) = delete;
+  IdentifySampleLocation& operator= (const IdentifySampleLocation&) = delete;
+
+ private:
+  void onInit () override;
+
+  struct Frame
+  {
+    sensor_msgs::Image::ConstPtr image;
+    sensor_msgs::PointCloud2::ConstPtr cloud;
+  };
+
+  void frameCallback (const sensor_msgs::Image::ConstPtr&,
+                      const sensor_msgs::PointCloud2::ConstPtr&);
+  void execute (const ow_plexil::IdentifyLocationGoalConstPtr&);
+  void finish (bool success, const geometry_msgs::Point& location = {});
+
+  // The frame's result with the given filter, taken from the cache or queued
+  // for processing.
+  std::shared_future<FrameResult> resultFor (const Frame&, SampleFilter);
+
+  bool toBaseFrame (const sensor_msgs::PointCloud2& cloud,
+                    const cv::Point3d& point, geometry_msgs::Point& out);
+  void visualize (const geometry_msgs::Point& location);
+
+  // The most recent frames, oldest first, guarded by m_historyMutex.
+  std::deque<Frame> m_history;
+  size_t m_historySize;
+  std::mutex m_historyMutex;
+
+  // Results by image stamp and filter, for the frames in the history.  Guarded
+  // by m_resultsMutex, which is taken after m_historyMutex.
+  std::map<std::pair<ros::Time, SampleFilter>,
+           std::shared_future<FrameResult>> m_results;
+  std::mutex m_resultsMutex;
+
+  ThreadPool m_workers;
+
+  tf2_ros::Buffer m_tfBuffer;
+  std::unique_ptr<tf2_ros::TransformListener> m_tfListener;
+
+  ros::Publisher m_imagePublisher;
+  ros::Publisher m_markerPublisher;
+
+  using ImageSubscriber = message_filters::Subscriber<sensor_msgs::Image>;
+  using CloudSubscriber = message_filters::Subscriber<sensor_msgs::PointCloud2>;
+  using Synchronizer =
+    message_filters::TimeSynchronizer<sensor_msgs::Image,
+                                      sensor_msgs::PointCloud2>;
+  std::unique_ptr<ImageSubscriber> m_imageSubscriber;
+  std::unique_ptr<CloudSubscriber> m_cloudSubscriber;
+  std::unique_ptr<Synchronizer> m_synchronizer;
+
+  using ActionServer =
+    actionlib::SimpleActionServer<ow_plexil::IdentifyLocationAction>;
+  std::unique_ptr<ActionServer> m_server;
+};
+
+#endif
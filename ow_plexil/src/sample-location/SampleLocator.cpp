@@ -0,0 +1,159 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "SampleLocator.h"
+#include <ros/ros.h>
+#include <cv_bridge/cv_bridge.h>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+using std::string;
+using std::vector;
+
+// Contours outside this range of area (pixels) are not candidates.  5000 seems
+// good for now.
+const double MinContourArea = 5000;
+const double MaxContourArea = 1000000;
+const size_t MaxCandidates = 5;
+
+// Filter thresholds
+const cv::Scalar BrownLower (0, 16, 32);     // HSV
+const cv::Scalar BrownUpper (19, 255, 255);
+const double DarkThreshold = 15;             // gray level
+
+SampleFilter sample_filter (const string& name)
+{
+  string lower = name;
+  std::transform (lower.begin(), lower.end(), lower.begin(),
+                  [] (unsigned char c) { return std::tolower (c); });
+  if (lower == "dark") return SampleFilter::Dark;
+  if (lower == "brown") return SampleFilter::Brown;
+  return SampleFilter::Unknown;
+}
+
+// Offsets of the x, y and z fields of the cloud's points, assumed to be
+// FLOAT32.  False if the cloud lacks any of them.
+static bool xyz_offsets (const sensor_msgs::PointCloud2& cloud,
+                         uint32_t offsets[3])
+{
+  const char* names[3] = { "x", "y", "z" };
+  for (int i = 0; i < 3; i++) {
+    auto field = std::find_if (cloud.fields.begin(), cloud.fields.end(),
+                               [&] (const sensor_msgs::PointField& f) {
+                                 return f.name == names[i];
+                               });
+    if (field == cloud.fields.end() ||
+        field->datatype != sensor_msgs::PointField::FLOAT32) {
+      return false;
+    }
+    offsets[i] = field->offset;
+  }
+  return true;
+}
+
+// The cloud's point at the given pixel, read in place.  False if the pixel is
+// outside the cloud or has no valid point.
+static bool point_at (const sensor_msgs::PointCloud2& cloud,
+                      const uint32_t offsets[3], const cv::Point& uv,
+                      cv::Point3d& point)
+{
+  if (uv.x < 0 || uv.y < 0 || static_cast<uint32_t>(uv.x) >= cloud.width ||
+      static_cast<uint32_t>(uv.y) >= cloud.height) {
+    return false;
+  }
+  size_t base = uv.y * cloud.row_step + uv.x * cloud.point_step;
+  if (base + cloud.point_step > cloud.data.size()) return false;
+  float xyz[3];
+  for (int i = 0; i < 3; i++) {
+    std::memcpy (&xyz[i], &cloud.data[base + offsets[i]], sizeof (float));
+    if (std::isnan (xyz[i])) return false;
+  }
+  point = cv::Point3d (xyz[0], xyz[1], xyz[2]);
+  return true;
+}
+
+FrameResult process_frame (const sensor_msgs::Image::ConstPtr& image,
+                           const sensor_msgs::PointCloud2::ConstPtr& cloud,
+                           SampleFilter filter)
+{
+  FrameResult result;
+
+  // Shares the message's data when it is already BGR.
+  cv_bridge::CvImageConstPtr cv_image;
+  try {
+    cv_image = cv_bridge::toCvShare (image, "bgr8");
+  }
+  catch (const cv_bridge::Exception& e) {
+    ROS_ERROR ("CV Bridge error: %s", e.what());
+    return result;
+  }
+
+  cv::Mat thresh;
+  if (filter == SampleFilter::Brown) {
+    cv::Mat hsv;
+    cv::cvtColor (cv_image->image, hsv, cv::COLOR_BGR2HSV);
+    cv::inRange (hsv, BrownLower, BrownUpper, thresh);
+  }
+  else {
+    cv::Mat gray;
+    cv::cvtColor (cv_image->image, gray, cv::COLOR_BGR2GRAY);
+    cv::threshold (gray, thresh, DarkThreshold, 255, cv::THRESH_BINARY_INV);
+  }
+
+  // Candidates are the largest contours in range, largest first.
+  vector<vector<cv::Point>> contours;
+  cv::findContours (thresh, contours, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
+  vector<std::pair<double, size_t>> by_area;
+  by_area.reserve (contours.size());
+  for (size_t i = 0; i < contours.size(); i++) {
+    by_area.emplace_back (cv::contourArea (contours[i]), i);
+  }
+  std::sort (by_area.begin(), by_area.end(),
+             [] (const std::pair<double, size_t>& a,
+                 const std::pair<double, size_t>& b) {
+               return a.first > b.first;
+             });
+
+  uint32_t offsets[3];
+  bool have_cloud = xyz_offsets (*cloud, offsets);
+  if (! have_cloud) ROS_ERROR ("Point cloud has no x, y and z fields");
+
+  for (const auto& entry : by_area) {
+    if (result.contours.size() >= MaxCandidates) break;
+    double area = entry.first;
+    if (area < MinContourArea || area > MaxContourArea) continue;
+    const vector<cv::Point>& contour = contours[entry.second];
+    cv::Moments moment = cv::moments (contour);
+    cv::Point uv (static_cast<int>(moment.m10 / moment.m00),
+                  static_cast<int>(moment.m01 / moment.m00));
+    result.contours.push_back (contour);
+    if (! result.valid && have_cloud &&
+        point_at (*cloud, offsets, uv, result.point)) {
+      result.valid = true;
+      result.area = area;
+      result.uv = uv;
+    }
+  }
+  return result;
+}
+
+sensor_msgs::Image::Ptr annotate_frame (const sensor_msgs::Image::ConstPtr& image,
+                                        const FrameResult& result)
+{
+  cv_bridge::CvImagePtr cv_image;
+  try {
+    cv_image = cv_bridge::toCvCopy (image, "bgr8");
+  }
+  catch (const cv_bridge::Exception& e) {
+    ROS_ERROR ("CV Bridge error: %s", e.what());
+    return nullptr;
+  }
+  cv::drawContours (cv_image->image, result.contours, -1,
+                    cv::Scalar (255, 0, 0), 3);
+  cv::circle (cv_image->image, result.uv, 7, cv::Scalar (0, 255, 0), -1);
+  return cv_image->toImageMsg();
+}
@@ -0,0 +1,46 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#ifndef Sample_Locator_H
+#define Sample_Locator_H
+
+// Image processing for IdentifySampleLocation: finds candidate sample spots in
+// a camera image and projects them into its point cloud.  These functions keep
+// no state, so frames can be processed concurrently.
+
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+enum class SampleFilter { Dark, Brown, Unknown };
+
+// The filter named by an IdentifyLocation goal, ignoring case.
+SampleFilter sample_filter (const std::string& name);
+
+// The outcome of processing one frame.
+struct FrameResult
+{
+  bool valid = false;      // a candidate projected to a point
+  double area = 0;         // of the chosen candidate's contour, in pixels
+  cv::Point uv;            // image location of the chosen candidate
+  cv::Point3d point;       // in the point cloud's (camera) frame
+
+  // Contours of the candidates, largest first, for visualization.
+  std::vector<std::vector<cv::Point>> contours;
+};
+
+// Find the candidates in the image, largest first, and take the first one
+// that has a valid point in the cloud.
+FrameResult process_frame (const sensor_msgs::Image::ConstPtr& image,
+                           const sensor_msgs::PointCloud2::ConstPtr& cloud,
+                           SampleFilter filter);
+
+// Copy of the image with the frame's contours and chosen location drawn on,
+// or null if the image cannot be converted.
+sensor_msgs::Image::Ptr annotate_frame (const sensor_msgs::Image::ConstPtr&,
+                                        const FrameResult&);
+
+#endif
@@ -0,0 +1,63 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "CommandBinder.h"
+#include <gtest/gtest.h>
+
+// The arguments of e.g. a command taking a distance, a count and a frame.
+using Arguments = CommandArguments<double, int, std::string>;
+
+static std::vector<PLEXIL::Value> arguments (const PLEXIL::Value& count)
+{
+  return { PLEXIL::Value (1.5), count, PLEXIL::Value (std::string ("BASE")) };
+}
+
+TEST (CommandArguments, UnpacksArgumentsOfTheParameterTypes)
+{
+  // Strings and arrays are unpacked in place, so the arguments must outlive
+  // the values.
+  std::vector<PLEXIL::Value> args = arguments (PLEXIL::Value (int32_t (3)));
+  Arguments::Values values;
+  ASSERT_TRUE (Arguments::unpack ("test", args, values));
+  EXPECT_DOUBLE_EQ (std::get<0> (values), 1.5);
+  EXPECT_EQ (std::get<1> (values), 3);
+  ASSERT_NE (std::get<2> (values), nullptr);
+  EXPECT_EQ (*std::get<2> (values), "BASE");
+}
+
+TEST (CommandArguments, RejectsAnArgumentOfAnotherType)
+{
+  Arguments::Values values;
+  EXPECT_FALSE (Arguments::unpack
+                ("test", arguments (PLEXIL::Value (std::string ("3"))), values));
+}
+
+TEST (CommandArguments, RejectsAnUnknownArgument)
+{
+  Arguments::Values values;
+  EXPECT_FALSE (Arguments::unpack ("test", arguments (PLEXIL::Value()), values));
+}
+
+TEST (CommandArguments, RejectsTheWrongNumberOfArguments)
+{
+  Arguments::Values values;
+  std::vector<PLEXIL::Value> args = arguments (PLEXIL::Value (int32_t (3)));
+  args.pop_back();
+  EXPECT_FALSE (Arguments::unpack ("test", args, values));
+  args = arguments (PLEXIL::Value (int32_t (3)));
+  args.push_back (PLEXIL::Value (2.0));
+  EXPECT_FALSE (Arguments::unpack ("test", args, values));
+}
+
+TEST (CommandArguments, UnpacksARealArray)
+{
+  using ArrayArguments = CommandArguments<std::vector<double>>;
+  ArrayArguments::Values values;
+  std::vector<double> points { 1, 2, 3 };
+  std::vector<PLEXIL::Value> args { PLEXIL::Value (points) };
+  ASSERT_TRUE (ArrayArguments::unpack ("test", args, values));
+  EXPECT_EQ (*std::get<0> (values), points);
+  args = { PLEXIL::Value (1.0) };
+  EXPECT_FALSE (ArrayArguments::unpack ("test", args, values));
+}
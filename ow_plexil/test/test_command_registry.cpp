@@ -0,0 +1,66 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "CommandRegistry.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static std::shared_ptr<CommandRecord> make_record (int id)
+{
+  return std::make_shared<CommandRecord> (id, nullptr, nullptr);
+}
+
+TEST (CommandRegistry, FindsUntilRemoved)
+{
+  CommandRegistry registry;
+  registry.insert (1, make_record (1));
+  registry.insert (17, make_record (17));  // in the same shard
+  ASSERT_NE (registry.find (1), nullptr);
+  EXPECT_EQ (registry.find (17)->id, 17);
+  EXPECT_EQ (registry.find (2), nullptr);
+
+  std::shared_ptr<CommandRecord> removed = registry.remove (1);
+  ASSERT_NE (removed, nullptr);
+  EXPECT_EQ (removed->id, 1);  // still usable by its holder
+  EXPECT_EQ (registry.find (1), nullptr);
+  EXPECT_EQ (registry.remove (1), nullptr);
+  EXPECT_EQ (registry.liveCount(), 1u);
+  EXPECT_EQ (registry.peakCount(), 2u);
+  EXPECT_EQ (registry.totalCount(), 2u);
+}
+
+TEST (CommandRegistry, ReplacingARecordKeepsTheCounts)
+{
+  CommandRegistry registry;
+  registry.insert (5, make_record (5));
+  registry.insert (5, make_record (5));
+  EXPECT_EQ (registry.liveCount(), 1u);
+  EXPECT_EQ (registry.totalCount(), 1u);
+}
+
+TEST (CommandRegistry, ConcurrentInsertFindRemove)
+{
+  CommandRegistry registry;
+  const int threads = 4, per_thread = 5000;
+  std::atomic<int> lost { 0 };
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back ([&, t] {
+      for (int i = 0; i < per_thread; i++) {
+        int id = t * per_thread + i;
+        registry.insert (id, make_record (id));
+        std::shared_ptr<CommandRecord> found = registry.find (id);
+        if (! found || found->id != id) lost++;
+        if (i % 2 == 0 && registry.remove (id) != found) lost++;
+      }
+    });
+  }
+  for (auto& worker : workers) worker.join();
+  EXPECT_EQ (lost, 0);
+  EXPECT_EQ (registry.liveCount(), size_t (threads * per_thread / 2));
+  EXPECT_EQ (registry.totalCount(), size_t (threads * per_thread));
+  EXPECT_GE (registry.peakCount(), registry.liveCount());
+}
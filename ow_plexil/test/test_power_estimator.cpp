@@ -0,0 +1,139 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "PowerEstimator.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+TEST (WindowedTrend, UnknownUntilTwoSampleTimes)
+{
+  WindowedTrend trend (4);
+  EXPECT_TRUE (std::isnan (trend.latest()));
+  trend.add (1, 5);
+  EXPECT_TRUE (std::isnan (trend.slope()));
+  trend.add (1, 6);
+  EXPECT_TRUE (std::isnan (trend.slope()));
+  EXPECT_DOUBLE_EQ (trend.valueAt (10), 6);  // the latest, given no slope
+  trend.add (NAN, 7);
+  EXPECT_EQ (trend.count(), 2u);
+}
+
+TEST (WindowedTrend, SlopeOfTheWindowAfterWraparound)
+{
+  // The window holds four samples, so after eight only those of the second
+  // line count.
+  WindowedTrend trend (4);
+  for (int t = 0; t < 4; t++) trend.add (t, t);
+  EXPECT_NEAR (trend.slope(), 1, 1e-12);
+  for (int t = 4; t < 8; t++) trend.add (t, 100 - 3 * t);
+  EXPECT_EQ (trend.count(), 4u);
+  EXPECT_NEAR (trend.slope(), -3, 1e-12);
+  EXPECT_NEAR (trend.valueAt (10), 70, 1e-9);
+  EXPECT_DOUBLE_EQ (trend.latest(), 79);
+}
+
+TEST (WindowedTrend, ResumKeepsTheFitExact)
+{
+  // Times far from zero and many windows' worth of samples, so that sums kept
+  // without moving their origin would lose the slope to rounding.
+  WindowedTrend trend (8);
+  double start = 1.7e9;
+  for (int i = 0; i < 10000; i++) {
+    double t = start + 0.1 * i;
+    trend.add (t, 0.5 * (t - start));
+  }
+  EXPECT_NEAR (trend.slope(), 0.5, 1e-6);
+  double end = start + 0.1 * 9999;
+  EXPECT_NEAR (trend.valueAt (end + 10), 0.5 * (end + 10 - start), 1e-3);
+}
+
+// Limits that only the state of charge can exceed.
+static PowerBudgetLimits charge_limits ()
+{
+  PowerBudgetLimits limits;
+  limits.minStateOfCharge = 0.1;
+  limits.chargeHysteresis = 0.02;
+  limits.minRemainingLife = 0;
+  limits.lifeHysteresis = 0;
+  limits.recoveryTime = 10;
+  return limits;
+}
+
+TEST (PowerEstimator, OKWithoutTelemetry)
+{
+  PowerEstimator estimator;
+  EXPECT_FALSE (estimator.update (0));
+  EXPECT_TRUE (estimator.budgetOK());
+  EXPECT_EQ (estimator.shortfall(), nullptr);
+}
+
+TEST (PowerEstimator, RecoversPastTheMarginAfterTheRecoveryTime)
+{
+  PowerEstimator estimator (charge_limits());
+  estimator.addStateOfCharge (0, 0.5);
+  EXPECT_FALSE (estimator.update (0));
+
+  estimator.addStateOfCharge (1, 0.09);
+  EXPECT_TRUE (estimator.update (1));
+  EXPECT_FALSE (estimator.budgetOK());
+  EXPECT_NE (estimator.shortfall(), nullptr);
+
+  // Above the minimum, but not past the margin: still exceeded.
+  estimator.addStateOfCharge (2, 0.11);
+  EXPECT_FALSE (estimator.update (2));
+  EXPECT_FALSE (estimator.budgetOK());
+
+  // Past the margin, but not yet for the recovery time.
+  estimator.addStateOfCharge (3, 0.13);
+  EXPECT_FALSE (estimator.update (3));
+  estimator.addStateOfCharge (12, 0.13);
+  EXPECT_FALSE (estimator.update (12));
+  EXPECT_FALSE (estimator.budgetOK());
+
+  estimator.addStateOfCharge (13, 0.13);
+  EXPECT_TRUE (estimator.update (13));
+  EXPECT_TRUE (estimator.budgetOK());
+  EXPECT_EQ (estimator.shortfall(), nullptr);
+}
+
+TEST (PowerEstimator, RecoveryRestartsWhenTheMarginIsLost)
+{
+  PowerEstimator estimator (charge_limits());
+  estimator.addStateOfCharge (0, 0.09);
+  EXPECT_TRUE (estimator.update (0));
+
+  estimator.addStateOfCharge (1, 0.13);
+  EXPECT_FALSE (estimator.update (1));
+  estimator.addStateOfCharge (8, 0.115);  // within the margin again
+  EXPECT_FALSE (estimator.update (8));
+  estimator.addStateOfCharge (9, 0.13);
+  EXPECT_FALSE (estimator.update (9));
+  EXPECT_FALSE (estimator.update (11));  // past 10 s from the first clearing
+  EXPECT_FALSE (estimator.budgetOK());
+  EXPECT_TRUE (estimator.update (19));
+  EXPECT_TRUE (estimator.budgetOK());
+}
+
+TEST (PowerEstimator, HoveringAtTheMinimumDoesNotToggle)
+{
+  PowerEstimator estimator (charge_limits());
+  int changes = 0;
+  for (int t = 0; t < 100; t++) {
+    estimator.addStateOfCharge (t, (t % 2) ? 0.099 : 0.101);
+    if (estimator.update (t)) changes++;
+  }
+  EXPECT_EQ (changes, 1);
+  EXPECT_FALSE (estimator.budgetOK());
+}
+
+TEST (PowerEstimator, TemperatureHeadedAboveTheMaximum)
+{
+  PowerBudgetLimits limits;
+  limits.maxTemperature = 30;
+  limits.temperatureHorizon = 60;
+  PowerEstimator estimator (limits);
+  for (int t = 0; t < 5; t++) estimator.addTemperature (t, 20 + 0.2 * t);
+  EXPECT_TRUE (estimator.update (4));  // 20.8 now, 32.8 in a minute
+  EXPECT_FALSE (estimator.budgetOK());
+}
@@ -0,0 +1,70 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "Seqlock.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Every word of a sample holds the same number, so a torn read shows as
+// words that differ.
+struct Sample
+{
+  uint64_t words[16];
+};
+
+static Sample make_sample (uint64_t n)
+{
+  Sample sample;
+  for (auto& word : sample.words) word = n;
+  return sample;
+}
+
+TEST (Seqlock, LoadsTheLastStore)
+{
+  Seqlock<Sample> seqlock (make_sample (7));
+  EXPECT_EQ (seqlock.load().words[15], 7u);
+  EXPECT_EQ (seqlock.version(), 0u);
+  seqlock.store (make_sample (8));
+  EXPECT_EQ (seqlock.load().words[0], 8u);
+  EXPECT_EQ (seqlock.version(), 1u);
+}
+
+TEST (Seqlock, ReadersRetryRatherThanSeeTornValues)
+{
+  const uint64_t stores = 200000;
+  Seqlock<Sample> seqlock (make_sample (0));
+  std::atomic<bool> done { false };
+  std::atomic<uint64_t> torn { 0 }, backwards { 0 }, reads { 0 };
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 3; r++) {
+    readers.emplace_back ([&] {
+      uint64_t last = 0;
+      while (! done) {
+        Sample sample = seqlock.load();
+        for (uint64_t word : sample.words) {
+          if (word != sample.words[0]) {
+            torn++;
+            break;
+          }
+        }
+        if (sample.words[0] < last) backwards++;
+        last = sample.words[0];
+        reads++;
+      }
+    });
+  }
+  for (uint64_t n = 1; n <= stores; n++) seqlock.store (make_sample (n));
+  done = true;
+  for (auto& reader : readers) reader.join();
+
+  EXPECT_EQ (torn, 0u);
+  EXPECT_EQ (backwards, 0u);
+  EXPECT_GT (reads, 0u);
+  EXPECT_EQ (seqlock.version(), stores);
+  EXPECT_EQ (seqlock.load().words[0], stores);
+}
@@ -0,0 +1,135 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "subscriber.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Each test has a channel of its own, so that subscribers left by one cannot
+// receive the publications of another.
+template <int N> struct Tag { };
+
+TEST (Channel, CallsSubscribersInOrder)
+{
+  using Numbers = Channel<Tag<0>, int>;
+  std::vector<int> calls;
+  Subscription first = Numbers::subscribe ([&] (const Tag<0>&, int n) {
+    calls.push_back (n);
+  });
+  Subscription second = Numbers::subscribe ([&] (const Tag<0>&, int n) {
+    calls.push_back (-n);
+  });
+  Numbers::publish (Tag<0>(), 3);
+  first.cancel();
+  Numbers::publish (Tag<0>(), 4);
+  EXPECT_EQ (calls, (std::vector<int> { 3, -3, -4 }));
+}
+
+TEST (Channel, UnsubscribeWaitsForPublicationInFlight)
+{
+  using Numbers = Channel<Tag<1>, int>;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool entered = false, release = false;
+  std::atomic<int> calls { 0 };
+  std::atomic<bool> returned { false };
+
+  Subscription subscription =
+    Numbers::subscribe ([&] (const Tag<1>&, int) {
+      std::unique_lock<std::mutex> lock (mutex);
+      entered = true;
+      condition.notify_all();
+      condition.wait (lock, [&] { return release; });
+      calls++;
+      returned = true;
+    });
+
+  std::thread publisher ([&] { Numbers::publish (Tag<1>(), 1); });
+  {
+    std::unique_lock<std::mutex> lock (mutex);
+    condition.wait (lock, [&] { return entered; });
+  }
+
+  std::atomic<bool> cancelled { false };
+  std::thread canceller ([&] {
+    subscription.cancel();
+    cancelled = true;
+  });
+  std::this_thread::sleep_for (std::chrono::milliseconds (50));
+  EXPECT_FALSE (cancelled);  // the subscriber is still running
+
+  {
+    std::lock_guard<std::mutex> lock (mutex);
+    release = true;
+  }
+  condition.notify_all();
+  canceller.join();
+  publisher.join();
+
+  EXPECT_TRUE (returned);
+  Numbers::publish (Tag<1>(), 2);
+  EXPECT_EQ (calls, 1);
+}
+
+TEST (Channel, SubscriberMayUnsubscribeItself)
+{
+  using Numbers = Channel<Tag<2>, int>;
+  int calls = 0;
+  Subscription subscription;
+  subscription = Numbers::subscribe ([&] (const Tag<2>&, int) {
+    calls++;
+    subscription.cancel();
+  });
+  Numbers::publish (Tag<2>(), 1);
+  Numbers::publish (Tag<2>(), 2);
+  EXPECT_EQ (calls, 1);
+}
+
+TEST (Channel, ChurnWhilePublishing)
+{
+  using Numbers = Channel<Tag<3>, int>;
+  std::atomic<bool> done { false };
+  std::atomic<long> sum { 0 };
+  Subscription steady = Numbers::subscribe ([&] (const Tag<3>&, int n) {
+    sum += n;
+  });
+
+  std::thread publisher ([&] {
+    while (! done) Numbers::publish (Tag<3>(), 1);
+  });
+  for (int i = 0; i < 200; i++) {
+    std::atomic<int> extra { 0 };
+    Subscription churn = Numbers::subscribe ([&] (const Tag<3>&, int) {
+      extra++;
+    });
+    churn.cancel();
+    int after = extra;
+    std::this_thread::yield();
+    EXPECT_EQ (extra, after);  // not called once unsubscribed
+  }
+  done = true;
+  publisher.join();
+  EXPECT_GT (sum, 0);
+}
+
+TEST (StateHandle, ResolvesEachStateOnce)
+{
+  StateHandle running ("Running", "Stow");
+  StateHandle again ("Running", "Stow");
+  StateHandle other ("Running", "Unstow");
+  StateHandle bare ("Running");
+  EXPECT_TRUE (running.valid());
+  EXPECT_FALSE (StateHandle().valid());
+  EXPECT_EQ (running.index(), again.index());
+  EXPECT_NE (running.index(), other.index());
+  EXPECT_NE (running.index(), bare.index());
+  EXPECT_EQ (running.name(), "Running");
+  ASSERT_NE (running.arg(), nullptr);
+  EXPECT_EQ (*running.arg(), "Stow");
+  EXPECT_EQ (bare.arg(), nullptr);
+}
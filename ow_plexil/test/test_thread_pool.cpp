@@ -0,0 +1,62 @@
+// The Notices and Disclaimers for Ocean Worlds Autonomy Testbed for Exploration
+// Research and Simulation can be found in README.md in the root directory of
+// this repository.
+
+#include "ThreadPool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+TEST (ThreadPool, RunsTasksInCallerWhenNotStarted)
+{
+  ThreadPool pool;
+  std::thread::id ran_on;
+  pool.enqueue ([&] { ran_on = std::this_thread::get_id(); });
+  EXPECT_EQ (ran_on, std::this_thread::get_id());
+  EXPECT_EQ (pool.size(), 0u);
+}
+
+TEST (ThreadPool, StopFinishesQueuedTasks)
+{
+  ThreadPool pool;
+  pool.start (1);
+  std::mutex gate;
+  std::atomic<int> ran { 0 };
+
+  // Hold the only worker in the first task, so that the rest queue up.
+  gate.lock();
+  pool.enqueue ([&] {
+    std::lock_guard<std::mutex> lock (gate);
+    ran++;
+  });
+  for (int i = 0; i < 10; i++) pool.enqueue ([&] { ran++; });
+  EXPECT_GE (pool.queueDepth(), 10u);
+
+  std::atomic<bool> stopped { false };
+  std::thread stopper ([&] {
+    pool.stop();
+    stopped = true;
+  });
+  std::this_thread::sleep_for (std::chrono::milliseconds (50));
+  EXPECT_FALSE (stopped);  // waits for the work queued before it
+  gate.unlock();
+  stopper.join();
+
+  EXPECT_EQ (ran, 11);
+  EXPECT_EQ (pool.tasksCompleted(), 11u);
+  EXPECT_EQ (pool.queueDepth(), 0u);
+  EXPECT_EQ (pool.size(), 0u);
+  EXPECT_GE (pool.peakQueueDepth(), 10u);
+}
+
+TEST (ThreadPool, RunsTasksInCallerOnceStopped)
+{
+  ThreadPool pool;
+  pool.start (2);
+  pool.stop();
+  int ran = 0;
+  pool.enqueue ([&] { ran++; });
+  EXPECT_EQ (ran, 1);
+}